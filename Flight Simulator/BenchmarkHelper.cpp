@@ -6,6 +6,8 @@
 #include <windows.h>
 #include <mmsystem.h>
 #include <iostream>
+#include <fstream>
+#include <iomanip>
 
 using namespace std;
 using namespace std::chrono;
@@ -38,6 +40,10 @@ void BenchmarkHelper::Update()
 {
     m_count++;
 
+    steady_clock::time_point currentFrameTime = Now();
+    AddTimeSample("Frame", m_previousFrameTime, currentFrameTime);
+    m_previousFrameTime = currentFrameTime;
+
     unsigned long currentTime = timeGetTime();
 
     unsigned long ms = currentTime - m_previousMsTime;
@@ -80,45 +86,40 @@ void BenchmarkHelper::Update()
 
         cout << "Average MS: " << averageMs << endl;
 
+        PrintReport();
+
         m_recordedSecondsCount = 0;
     }
 }
 
 void BenchmarkHelper::AddTimeSample(const string& key, const steady_clock::time_point& beginTime, const steady_clock::time_point& endTime)
 {
-    long long value = duration_cast<nanoseconds>(endTime - beginTime).count();
+    AddTimeSample(key, duration_cast<nanoseconds>(endTime - beginTime).count());
+}
 
-    if (m_info.find(key) == m_info.end())
-    {
-        m_info[key] = TimeStats();
-        m_info[key].Nanoseconds.push_back(value);
-        m_info[key].MustUpdate         = false;
-        m_info[key].MinNanoseconds     = value;
-        m_info[key].MaxNanoseconds     = value;
-        m_info[key].AverageNanoseconds = value;
-
-        return;
-    }
+void BenchmarkHelper::AddTimeSample(const string& key, long long value)
+{
+    m_info[key].AddValue(value);
+}
 
-    m_info[key].Nanoseconds.push_back(value);
-    m_info[key].MustUpdate     = true;
-    m_info[key].MinNanoseconds = min(m_info[key].MinNanoseconds, value);
-    m_info[key].MaxNanoseconds = max(m_info[key].MaxNanoseconds, value);
+const Histogram& BenchmarkHelper::GetTimeInfo(const string& key)
+{
+    return m_info[key];
 }
 
-const BenchmarkHelper::TimeStats& BenchmarkHelper::GetTimeInfo(const string& key)
+bool BenchmarkHelper::ExportReport(const string& filename)
 {
-    if (m_info[key].MustUpdate)
-    {
-        unsigned long long totalSum = 0;
-        for (auto& nanoseconds : m_info[key].Nanoseconds)
-            totalSum += nanoseconds;
+    string extension = filename.substr(min(filename.find_last_of('.'), filename.size()));
+    transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
 
-        m_info[key].AverageNanoseconds = totalSum / m_info[key].Nanoseconds.size();
-        m_info[key].MustUpdate = false;
-    }
+    if (extension == ".csv")
+        return ExportCSV(filename);
 
-    return m_info[key];
+    if (extension == ".json")
+        return ExportJSON(filename);
+
+    cout << "ERROR::BENCHMARK_HELPER::UNKNOWN_REPORT_FORMAT: " << filename << endl;
+    return false;
 }
 
 BenchmarkHelper::BenchmarkHelper() :
@@ -126,6 +127,106 @@ BenchmarkHelper::BenchmarkHelper() :
     m_fps(0),
     m_startTime(timeGetTime()),
     m_previousMsTime(timeGetTime()),
+    m_previousFrameTime(steady_clock::now()),
     m_recordedSecondsCount(0)
 {
+}
+
+void BenchmarkHelper::PrintReport()
+{
+    // The averages hide the hitches, the high percentiles and the max are what matter.
+    cout << fixed << setprecision(3);
+
+    for (auto& key : GetSortedKeys())
+    {
+        const Histogram& histogram = m_info[key];
+
+        cout << key << " (ms):"
+             << " p50 "   << histogram.GetPercentile(50.0) / 1000000.0
+             << " p90 "   << histogram.GetPercentile(90.0) / 1000000.0
+             << " p99 "   << histogram.GetPercentile(99.0) / 1000000.0
+             << " p99.9 " << histogram.GetPercentile(99.9) / 1000000.0
+             << " max "   << histogram.GetMax()            / 1000000.0 << endl;
+    }
+
+    cout.unsetf(ios_base::floatfield);
+}
+
+vector<string> BenchmarkHelper::GetSortedKeys() const
+{
+    vector<string> result;
+
+    for (auto& keyVal : m_info)
+        result.push_back(keyVal.first);
+
+    sort(result.begin(), result.end());
+
+    return result;
+}
+
+bool BenchmarkHelper::ExportCSV(const string& filename)
+{
+    ofstream report(filename);
+
+    if (!report.is_open())
+    {
+        cout << "ERROR::BENCHMARK_HELPER::REPORT_NOT_WRITTEN: " << filename << endl;
+        return false;
+    }
+
+    report << "metric,count,min_ms,average_ms,p50_ms,p90_ms,p99_ms,p99.9_ms,max_ms" << endl;
+    report << fixed << setprecision(6);
+
+    for (auto& key : GetSortedKeys())
+    {
+        const Histogram& histogram = m_info[key];
+
+        report << "\"" << key << "\","
+               << histogram.GetCount()                      << ","
+               << histogram.GetMin()            / 1000000.0 << ","
+               << histogram.GetAverage()        / 1000000.0 << ","
+               << histogram.GetPercentile(50.0) / 1000000.0 << ","
+               << histogram.GetPercentile(90.0) / 1000000.0 << ","
+               << histogram.GetPercentile(99.0) / 1000000.0 << ","
+               << histogram.GetPercentile(99.9) / 1000000.0 << ","
+               << histogram.GetMax()            / 1000000.0 << endl;
+    }
+
+    return true;
+}
+
+bool BenchmarkHelper::ExportJSON(const string& filename)
+{
+    ofstream report(filename);
+
+    if (!report.is_open())
+    {
+        cout << "ERROR::BENCHMARK_HELPER::REPORT_NOT_WRITTEN: " << filename << endl;
+        return false;
+    }
+
+    report << fixed << setprecision(6);
+    report << "{" << endl;
+
+    vector<string> keys = GetSortedKeys();
+
+    for (int i = 0; i < keys.size(); i++)
+    {
+        const Histogram& histogram = m_info[keys[i]];
+
+        report << "    \"" << keys[i] << "\": { "
+               << "\"count\": "      << histogram.GetCount()                      << ", "
+               << "\"min_ms\": "     << histogram.GetMin()            / 1000000.0 << ", "
+               << "\"average_ms\": " << histogram.GetAverage()        / 1000000.0 << ", "
+               << "\"p50_ms\": "     << histogram.GetPercentile(50.0) / 1000000.0 << ", "
+               << "\"p90_ms\": "     << histogram.GetPercentile(90.0) / 1000000.0 << ", "
+               << "\"p99_ms\": "     << histogram.GetPercentile(99.0) / 1000000.0 << ", "
+               << "\"p99.9_ms\": "   << histogram.GetPercentile(99.9) / 1000000.0 << ", "
+               << "\"max_ms\": "     << histogram.GetMax()            / 1000000.0 << " }"
+               << (i + 1 < keys.size() ? "," : "") << endl;
+    }
+
+    report << "}" << endl;
+
+    return true;
 }
\ No newline at end of file
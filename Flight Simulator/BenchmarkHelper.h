@@ -1,29 +1,19 @@
 #pragma once
 
 #include <chrono>
+#include <list>
+#include <string>
 #include <vector>
 #include <unordered_map>
 
+#include "Histogram.h"
+
 class BenchmarkHelper
 {
 private:
 
 	const int AVERAGE_SAMPLES = 10;
 
-private:
-
-	struct TimeStats
-	{
-	public:
-
-		std::vector<long long> Nanoseconds;
-		bool                   MustUpdate;
-
-		long long              AverageNanoseconds;
-		long long              MinNanoseconds;
-		long long              MaxNanoseconds;
-	};
-
 public:
 
 	BenchmarkHelper(const BenchmarkHelper&) = delete;
@@ -37,17 +27,26 @@ public:
 	       void                                  Update();
 							                     
 	       void                                  AddTimeSample(const std::string&, const std::chrono::steady_clock::time_point&, const std::chrono::steady_clock::time_point&);
-	const  TimeStats&                            GetTimeInfo(const std::string&);
+	       void                                  AddTimeSample(const std::string&, long long);
+	const  Histogram&                            GetTimeInfo(const std::string&);
 
-	inline std::chrono::steady_clock::time_point Now() const { return std::chrono::high_resolution_clock::now(); }
+	       // The format is picked from the extension of the file (.csv or .json).
+	       bool                                  ExportReport(const std::string&);
+
+	inline std::chrono::steady_clock::time_point Now() const { return std::chrono::steady_clock::now(); }
 
 private:
 
 	BenchmarkHelper();
 
+	void                     PrintReport();
+	std::vector<std::string> GetSortedKeys() const;
+	bool                     ExportCSV(const std::string&);
+	bool                     ExportJSON(const std::string&);
+
 private:
 
-	       std::unordered_map<std::string, TimeStats> m_info;
+	       std::unordered_map<std::string, Histogram> m_info;
 		   std::list<int>                             m_recordedFps;
 		   std::list<int>                             m_recordedMs;
 
@@ -56,6 +55,7 @@ private:
 
 		   unsigned long                              m_startTime;
 		   unsigned long                              m_previousMsTime;
+		   std::chrono::steady_clock::time_point      m_previousFrameTime;
 		   int                                        m_recordedSecondsCount;
 
 	static BenchmarkHelper*                           g_benchmarkHelper;
@@ -5,7 +5,6 @@
 #include "glad/glad.h"
 
 #include "Camera.h"
-#include "InputWrapper.h"
 
 using namespace std;
 using namespace glm;
@@ -41,61 +40,12 @@ void Camera::UpdateWindowSize(float width, float height)
 
 void Camera::Update(float deltaTime)
 {
-    auto mouseDiff = InputWrapper::GetInstance()->GetMouseMoveDiff();
-
-    m_rotation.x += mouseDiff.y * CAMERA_ROTATE_SPEED;
-    m_rotation.y += mouseDiff.x * CAMERA_ROTATE_SPEED;
-
-    constexpr float halfPi = half_pi<float>();
-
-    if (m_rotation.x >= halfPi)
-        m_rotation.x = halfPi;
-
-    if (m_rotation.x <= -halfPi)
-        m_rotation.x = -halfPi;
-
-    UpdateViewMatrix();
-    UpdateModelMatrix();
-
-    mat4 rotationMatrix = GetRotationMatrix();
-
-    vec4 translation    = vec4(0.0f, 0.0f, 0.0f, 0.0f);
-    bool translated     = false;
-
-    if (InputWrapper::GetInstance()->GetKey(InputWrapper::Keys::Up))
-    {
-        translation = vec4(translation.x, translation.y, translation.z - 1.0f, translation.w);
-        translated = true;
-    }
-
-    if (InputWrapper::GetInstance()->GetKey(InputWrapper::Keys::Left))
-    {
-        translation = vec4(translation.x - 1.0f, translation.y, translation.z, translation.w);
-        translated = true;
-    }
-
-    if (InputWrapper::GetInstance()->GetKey(InputWrapper::Keys::Down))
-    {
-        translation = vec4(translation.x, translation.y, translation.z + 1.0f, translation.w);
-        translated = true;
-    }
-
-    if (InputWrapper::GetInstance()->GetKey(InputWrapper::Keys::Right))
-    {
-        translation = vec4(translation.x + 1.0f, translation.y, translation.z, translation.w);
-        translated = true;
-    }
-
-    if (!translated)
-        return;
-
-    if (length(translation) < MINIMUM_TRANSLATION_BIAS)
-        return;
-
-    vec4 transformedTranslation = translation * rotationMatrix;
-    vec4 normalizedTranslation  = normalize(transformedTranslation);
+}
 
-    m_position += vec3(normalizedTranslation.x, normalizedTranslation.y, normalizedTranslation.z) * deltaTime * CAMERA_MOVE_SPEED;
+void Camera::SetTransform(const vec3& position, const vec3& rotation)
+{
+    m_position = position;
+    m_rotation = rotation;
 
     UpdateViewMatrix();
     UpdateModelMatrix();
@@ -121,6 +71,11 @@ vec3 Camera::GetPosition() const
     return m_position;
 }
 
+vec3 Camera::GetRotation() const
+{
+    return m_rotation;
+}
+
 float Camera::GetWidth() const
 {
     return m_width;
@@ -191,17 +146,38 @@ Camera::Directions Camera::GetReflectedVectors()
     return result;
 }
 
-mat4 Camera::GetRotationMatrix()
+Camera::Snapshot Camera::GetSnapshot()
+{
+    Snapshot snapshot;
+
+    snapshot.Position         = GetPosition();
+    snapshot.Forward          = GetForward();
+    snapshot.Far              = GetFar();
+
+    snapshot.ViewMatrix       = GetViewMatrix();
+    snapshot.ProjectionMatrix = GetProjectionMatrix();
+
+    snapshot.Frustum          = MathHelper::GetCameraFrustum(this);
+
+    return snapshot;
+}
+
+mat4 Camera::GetRotationMatrix(const vec3& rotation)
 {
     mat4 rotationMatrix = mat4(1.0f);
 
-    rotationMatrix = rotate(rotationMatrix, m_rotation.x, vec3(1.0f, 0.0f, 0.0f));
-    rotationMatrix = rotate(rotationMatrix, m_rotation.y, vec3(0.0f, 1.0f, 0.0f));
-    rotationMatrix = rotate(rotationMatrix, m_rotation.z, vec3(0.0f, 0.0f, 1.0f));
+    rotationMatrix = rotate(rotationMatrix, rotation.x, vec3(1.0f, 0.0f, 0.0f));
+    rotationMatrix = rotate(rotationMatrix, rotation.y, vec3(0.0f, 1.0f, 0.0f));
+    rotationMatrix = rotate(rotationMatrix, rotation.z, vec3(0.0f, 0.0f, 1.0f));
     
     return rotationMatrix;
 }
 
+mat4 Camera::GetRotationMatrix()
+{
+    return GetRotationMatrix(m_rotation);
+}
+
 void Camera::UpdateModelMatrix()
 {
     m_modelMatrix = inverse(m_viewMatrix);
@@ -17,11 +17,21 @@ public:
         glm::vec3 Up;
     };
 
-private:
+    // The camera values a frame is prepared with, read once on the main thread so the worker
+    // threads never go through the getters of a camera that changes under them.
+    struct Snapshot
+    {
+    public:
+
+        glm::vec3           Position;
+        glm::vec3           Forward;
+        float               Far;
 
-    const float CAMERA_MOVE_SPEED        = 10.0f;
-    const float CAMERA_ROTATE_SPEED      = 0.001f;
-    const float MINIMUM_TRANSLATION_BIAS = 0.01f;
+        glm::mat4           ViewMatrix;
+        glm::mat4           ProjectionMatrix;
+
+        MathHelper::Frustum Frustum;
+    };
 
 public:
 
@@ -31,11 +41,15 @@ public:
     virtual void       UpdateWindowSize(float, float);
                        
     virtual void       Update(float);
+
+            // The camera is flown by the Simulation, which hands the interpolated transform here.
+            void       SetTransform(const glm::vec3&, const glm::vec3&);
                        
     virtual glm::mat4  GetModelMatrix()                       const;
     virtual glm::mat4  GetViewMatrix()                        const;
     virtual glm::mat4  GetProjectionMatrix()                  const;
     virtual glm::vec3  GetPosition()                          const;
+            glm::vec3  GetRotation()                          const;
                                                       
     virtual float      GetWidth()                             const;
     virtual float      GetHeight()                            const;
@@ -50,6 +64,9 @@ public:
     virtual glm::vec3  GetUp()                                const;
 
             Directions GetReflectedVectors();
+            Snapshot   GetSnapshot();
+
+    static  glm::mat4  GetRotationMatrix(const glm::vec3&);
 
 private:
 
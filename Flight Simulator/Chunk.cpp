@@ -1,4 +1,6 @@
 #include <memory>
+#include <limits>
+#include <cstddef>
 #include <glm/ext/matrix_transform.hpp>
 #include "glad/glad.h"
 
@@ -9,43 +11,36 @@
 #include "Terrain.h"
 #include <glm/gtc/type_ptr.hpp>
 #include "ShaderManager.h"
+#include "RenderSettings.h"
 
 #include "BenchmarkHelper.h"
+#include "Profiler.h"
+#include "GpuProfiler.h"
+#include "TerrainQuery.h"
+#include "StreamingBuffer.h"
 
 using namespace std;
 using namespace glm;
 
-const float Chunk::CHUNK_CLOSE_BIAS = 1.0f;
+const float Chunk::CHUNK_CLOSE_BIAS              = 1.0f;
+const float Chunk::TEXTURE_SIZE_HALVING_DISTANCE = 128.0f;
 
 Chunk::Node::Node()
 {
     memset(Children, 0, sizeof(Node*) * CHILDREN_COUNT);
 
     IsLeaf           = false;
+    Depth            = 0;
     ZoneRange        = vec4(0.0f, 0.0f, 0.0f, 0.0f);
     PositionId       = make_pair(0, 0);
     BoundingBox      = MathHelper::AABB();
-    DesiredInstances = unordered_map<Biome::FolliageModel, vector<FolliageProperties>, Biome::HashFolliageModel>();
+    HeightError      = 0.0f;
+    HasWater         = false;
 }
 
-Chunk::Node::~Node()
-{
-    if (IsLeaf)
-        return;
-
-    for (int i = 0; i < CHILDREN_COUNT; i++)
-    {
-        if (Children[i])
-        {
-            delete Children[i];
-            Children[i] = nullptr;
-        }
-    }
-}
-
-Chunk::Chunk(PerlinNoise* perlinNoise, HydraulicErosion* hydraulicErosion, GaussianBlur* gaussianBlur, pair<int, int> chunkID) :
+// The chunk is only set up here, its data is generated by BuildStep, one stage at a time.
+Chunk::Chunk(PerlinNoise* perlinNoise, HydraulicErosion* hydraulicErosion, GaussianBlur* gaussianBlur, pair<int, int> chunkID, int textureSize) :
     m_vbo(0),
-    m_instanceVbo(0),
     m_ebo(0),
     m_vao(0),
     m_waterVbo(0),
@@ -53,321 +48,551 @@ Chunk::Chunk(PerlinNoise* perlinNoise, HydraulicErosion* hydraulicErosion, Gauss
     m_waterVao(0),
     m_perlinNoise(perlinNoise),
     m_hydraulicErosion(hydraulicErosion),
+    m_gaussianBlur(gaussianBlur),
     m_chunkID(chunkID),
+    m_buildStage(BuildStage::Buffers),
+    m_heightTexture(nullptr),
+    m_biomesTexture(nullptr),
+    m_textureSize(textureSize),
+    m_targetTextureSize(textureSize),
+    m_heightScale(1.0f),
+    m_heightBias(0.0f),
+    m_minHeight(0.0f),
+    m_maxHeight(1.0f),
+    m_upgradeStage(UpgradeStage::HeightNoise),
+    m_upgradeTextureSize(textureSize),
+    m_upgradeHeightTexture(nullptr),
+    m_upgradeBiomesTexture(nullptr),
+    m_minValues(nullptr),
+    m_maxValues(nullptr),
+    m_heightValues(nullptr),
+    m_biomeValues(nullptr),
+    m_folliageRandomnessValues(nullptr),
+    m_folliageSelectionRandomnessValues(nullptr),
+    m_nodes(nullptr),
+    m_nodesCount(0),
     m_quadTree(nullptr),
-    m_renderDebug(false)
+    m_folliageCells(nullptr)
 {
-    ShaderManager* shaderManager = ShaderManager::GetInstance();
-    CreateTerrainBuffers();
-    CreateWaterBuffers();
+    for (auto& view : m_views)
+    {
+        view.DrawZonesRanges        = nullptr;
+        view.WaterDrawZonesRanges   = nullptr;
+        view.ZoneRangesIndex        = 0;
+        view.WaterZoneRangesIndex   = 0;
+        view.ZonesBaseInstance      = -1;
+        view.WaterZonesBaseInstance = -1;
+        view.RenderDebug            = false;
+    }
+}
 
-    vec3 translation = GetTranslation();
+Chunk::~Chunk()
+{
+    if (m_buildStage > BuildStage::HeightBiomeValues)
+        TerrainQuery::GetInstance()->RemoveChunk(m_chunkID);
 
-    vec2 startPosition = vec2(translation.x - Terrain::CHUNK_WIDTH / 2.0f, translation.z - Terrain::CHUNK_WIDTH / 2.0f);
-    vec2 endPosition   = vec2(translation.x + Terrain::CHUNK_WIDTH / 2.0f, translation.z + Terrain::CHUNK_WIDTH / 2.0f);
+    for (auto& view : m_views)
+    {
+        if (view.WaterDrawZonesRanges)
+        {
+            delete[] view.WaterDrawZonesRanges;
+            view.WaterDrawZonesRanges = nullptr;
+        }
 
-    PerlinNoise::NoiseParameters heightParameters;
+        if (view.DrawZonesRanges)
+        {
+            delete[] view.DrawZonesRanges;
+            view.DrawZonesRanges = nullptr;
+        }
+    }
 
-    heightParameters.StartPosition = startPosition;
-    heightParameters.EndPosition   = endPosition;
-    heightParameters.Frequency     = Terrain::HEIGHT_FREQUENCY;
-    heightParameters.FudgeFactor   = Terrain::HEIGHT_FUDGE_FACTOR;
-    heightParameters.Exponent      = Terrain::HEIGHT_EXPONENT;
-    heightParameters.OctavesCount  = Terrain::HEIGHT_OCTAVES_COUNT;
-    heightParameters.TextureSize   = NOISE_TEXTURE_SIZE;
-                                   
-    m_heightTexture                = m_perlinNoise->RenderPerlinNoise(heightParameters);
-    m_hydraulicErosion->ApplyErosion(m_heightTexture);
-    gaussianBlur->ApplyBlur(m_heightTexture);
+    if (m_folliageCells)
+    {
+        delete[] m_folliageCells;
+        m_folliageCells = nullptr;
+    }
 
-    PerlinNoise::NoiseParameters biomeParameters;
+    if (m_nodes)
+    {
+        delete[] m_nodes;
+        m_nodes    = nullptr;
+        m_quadTree = nullptr;
+    }
 
-            biomeParameters.StartPosition = startPosition;
-            biomeParameters.EndPosition   = endPosition;
-            biomeParameters.Frequency     = Terrain::BIOME_FREQUENCY;
-            biomeParameters.FudgeFactor   = Terrain::BIOME_FUDGE_FACTOR;
-            biomeParameters.Exponent      = Terrain::BIOME_EXPONENT;
-            biomeParameters.OctavesCount  = Terrain::BIOME_OCTAVES_COUNT;
-            biomeParameters.TextureSize   = NOISE_TEXTURE_SIZE;
-            
-            m_biomesTexture               = m_perlinNoise->RenderPerlinNoise(biomeParameters);
-         
-    float** minValues                     = m_heightTexture->GetDownscaleValues({ shaderManager->GetMinShader(),     4, 8}, QUAD_TREE_DEPTH);
-    float** maxValues                     = m_heightTexture->GetDownscaleValues({ shaderManager->GetMaxShader(),     4, 8}, QUAD_TREE_DEPTH);
+    if (m_upgradeBiomesTexture)
+    {
+        delete m_upgradeBiomesTexture;
+        m_upgradeBiomesTexture = nullptr;
+    }
 
-    float** heightValues                  = m_heightTexture->GetDownscaleValues({ shaderManager->GetAverageShader(), 4, 8}, HEIGHT_BIOME_DEPTH);
-    float** biomeValues                   = m_biomesTexture->GetDownscaleValues({ shaderManager->GetAverageShader(), 4, 8 }, HEIGHT_BIOME_DEPTH);
-                                          
-    int     quadTreesDivisionsCount       = 1 << (QUAD_TREE_DEPTH - 1);
-    int     heightBiomeDivisionsCount     = 1 << (HEIGHT_BIOME_DEPTH - 1);
+    if (m_upgradeHeightTexture)
+    {
+        delete m_upgradeHeightTexture;
+        m_upgradeHeightTexture = nullptr;
+    }
 
-    PerlinNoise::NoiseParameters folliageRandomnessParameters;
+    if (m_biomesTexture)
+    {
+        delete m_biomesTexture;
+        m_biomesTexture = nullptr;
+    }
 
-             folliageRandomnessParameters.StartPosition = startPosition;
-             folliageRandomnessParameters.EndPosition   = endPosition;
-             folliageRandomnessParameters.Frequency     = Terrain::FOLLIAGE_RANDOMNESS_FREQUENCY;
-             folliageRandomnessParameters.FudgeFactor   = Terrain::FOLLIAGE_RANDOMNESS_FUDGE_FACTOR;
-             folliageRandomnessParameters.Exponent      = Terrain::FOLLIAGE_RANDOMNESS_EXPONENT;
-             folliageRandomnessParameters.OctavesCount  = Terrain::FOLLIAGE_RANDOMNESS_OCTAVES_COUNT;
-             folliageRandomnessParameters.TextureSize   = heightBiomeDivisionsCount;
+    if (m_heightTexture)
+    {
+        delete m_heightTexture;
+        m_heightTexture = nullptr;
+    }
+
+    int quadTreesDivisionsCount   = 1 << (QUAD_TREE_DEPTH - 1);
+    int heightBiomeDivisionsCount = 1 << (HEIGHT_BIOME_DEPTH - 1);
 
-    Texture* folliageRandomnessMap                      = m_perlinNoise->RenderPerlinNoise(folliageRandomnessParameters);
-    float**  folliageRandomnessValues                   = Texture::GetPixelsInfo(folliageRandomnessMap);
+    FreeValues(m_folliageSelectionRandomnessValues, heightBiomeDivisionsCount);
+    FreeValues(m_folliageRandomnessValues,          heightBiomeDivisionsCount);
+    FreeValues(m_biomeValues,                       heightBiomeDivisionsCount);
+    FreeValues(m_heightValues,                      heightBiomeDivisionsCount);
+    FreeValues(m_maxValues,                         quadTreesDivisionsCount);
+    FreeValues(m_minValues,                         quadTreesDivisionsCount);
 
-    PerlinNoise::NoiseParameters folliageSelectionRandomnessParameters;
+    if (m_buildStage > BuildStage::Buffers)
+    {
+        FreeWaterBuffers();
+        FreeTerrainBuffers();
+    }
+}
 
-             folliageSelectionRandomnessParameters.StartPosition = startPosition;
-             folliageSelectionRandomnessParameters.EndPosition   = endPosition;
-             folliageSelectionRandomnessParameters.Frequency     = Terrain::FOLLIAGE_SELECTION_RANDOMNESS_FREQUENCY;
-             folliageSelectionRandomnessParameters.FudgeFactor   = Terrain::FOLLIAGE_SELECTION_RANDOMNESS_FUDGE_FACTOR;
-             folliageSelectionRandomnessParameters.Exponent      = Terrain::FOLLIAGE_SELECTION_RANDOMNESS_EXPONENT;
-             folliageSelectionRandomnessParameters.OctavesCount  = Terrain::FOLLIAGE_SELECTION_RANDOMNESS_OCTAVES_COUNT;
-             folliageSelectionRandomnessParameters.TextureSize   = heightBiomeDivisionsCount;
+// Runs the current construction stage and moves to the next one. Every stage is short enough to
+// fit in a frame, the data that the next stages need is kept in the chunk between the calls.
+bool Chunk::BuildStep()
+{
+    ShaderManager* shaderManager = ShaderManager::GetInstance();
+    Profiler*      profiler      = Profiler::GetInstance();
+    GpuProfiler*   gpuProfiler   = GpuProfiler::GetInstance();
 
-    Texture* folliageSelectionRandomnessMap                      = m_perlinNoise->RenderPerlinNoise(folliageSelectionRandomnessParameters);
-    float**  folliageSelectionRandomnessValues                   = Texture::GetPixelsInfo(folliageSelectionRandomnessMap);
+    vec3           translation   = GetTranslation();
 
-    BuildQuadTree(make_pair(minValues, maxValues), make_pair(heightValues, biomeValues), make_pair(folliageRandomnessValues, folliageSelectionRandomnessValues));
-    BuildWaterQuadTree();
+    vec2           startPosition = vec2(translation.x - Terrain::CHUNK_WIDTH / 2.0f, translation.z - Terrain::CHUNK_WIDTH / 2.0f);
+    vec2           endPosition   = vec2(translation.x + Terrain::CHUNK_WIDTH / 2.0f, translation.z + Terrain::CHUNK_WIDTH / 2.0f);
 
-    m_drawZonesRanges = new vec4[quadTreesDivisionsCount * quadTreesDivisionsCount];
-    m_waterDrawZonesRanges = new vec4[quadTreesDivisionsCount * quadTreesDivisionsCount];
+    int            quadTreesDivisionsCount   = 1 << (QUAD_TREE_DEPTH - 1);
+    int            waterDivisionsCount       = 1 << (WATER_TREE_DEPTH - 1);
+    int            heightBiomeDivisionsCount = 1 << (HEIGHT_BIOME_DEPTH - 1);
 
-    for (int i = 0; i < heightBiomeDivisionsCount; i++)
+    switch (m_buildStage)
     {
-        if (folliageSelectionRandomnessValues[i])
-        {
-            delete[] folliageSelectionRandomnessValues[i];
-            folliageSelectionRandomnessValues[i] = nullptr;
-        }
+    case BuildStage::Buffers:
+    {
+        profiler->BeginZone("Chunk::CreateBuffers");
+        CreateTerrainBuffers();
+        CreateWaterBuffers();
+        profiler->EndZone();
 
-        if (folliageRandomnessValues[i])
-        {
-            delete[] folliageRandomnessValues[i];
-            folliageRandomnessValues[i] = nullptr;
-        }
+        break;
     }
-
-    if (folliageSelectionRandomnessValues)
+    case BuildStage::HeightNoise:
     {
-        delete[] folliageSelectionRandomnessValues;
-        folliageSelectionRandomnessValues = nullptr;
-    }
+        profiler->BeginZone("Chunk::HeightNoise");
+        gpuProfiler->BeginZone("Chunk::HeightNoise");
+        m_heightTexture = RenderHeightNoise(m_textureSize);
+        gpuProfiler->EndZone();
+        profiler->EndZone();
 
-    if (folliageRandomnessValues)
-    {
-        delete[] folliageRandomnessValues;
-        folliageRandomnessValues = nullptr;
+        break;
     }
-
-    if (folliageSelectionRandomnessMap)
+    case BuildStage::Erosion:
     {
-        delete folliageSelectionRandomnessMap;
-        folliageSelectionRandomnessMap = nullptr;
+        profiler->BeginZone("Chunk::HydraulicErosion");
+        gpuProfiler->BeginZone("Chunk::HydraulicErosion");
+        m_hydraulicErosion->ApplyErosion(m_heightTexture);
+        gpuProfiler->EndZone();
+        profiler->EndZone();
+
+        break;
     }
+    case BuildStage::Blur:
+    {
+        profiler->BeginZone("Chunk::GaussianBlur");
+        gpuProfiler->BeginZone("Chunk::GaussianBlur");
+        m_gaussianBlur->ApplyBlur(m_heightTexture);
+        gpuProfiler->EndZone();
+        profiler->EndZone();
 
-    if (folliageRandomnessMap)
+        break;
+    }
+    case BuildStage::BiomeNoise:
     {
-        delete folliageRandomnessMap;
-        folliageRandomnessMap = nullptr;
+        profiler->BeginZone("Chunk::BiomeNoise");
+        gpuProfiler->BeginZone("Chunk::BiomeNoise");
+        m_biomesTexture = RenderBiomeNoise(m_textureSize);
+        gpuProfiler->EndZone();
+        profiler->EndZone();
+
+        break;
     }
+    case BuildStage::MinMaxValues:
+    {
+        profiler->BeginZone("Chunk::Downscale");
+        gpuProfiler->BeginZone("Chunk::Downscale");
+        m_minValues = m_heightTexture->GetDownscaleValues({ shaderManager->GetMinShader(), 4, 8 }, QUAD_TREE_DEPTH);
+        m_maxValues = m_heightTexture->GetDownscaleValues({ shaderManager->GetMaxShader(), 4, 8 }, QUAD_TREE_DEPTH);
+        gpuProfiler->EndZone();
+        profiler->EndZone();
 
-    for (int i = 0; i < quadTreesDivisionsCount; i++)
+        FindHeightRange();
+
+        break;
+    }
+    case BuildStage::QuadTree:
     {
-        if (maxValues[i])
-        {
-            delete[] maxValues[i];
-            maxValues[i] = nullptr;
-        }
+        profiler->BeginZone("Chunk::BuildQuadTree");
+        BuildQuadTree();
+        profiler->EndZone();
 
-        if (minValues[i])
+        for (auto& view : m_views)
         {
-            delete[] minValues[i];
-            minValues[i] = nullptr;
+            view.DrawZonesRanges      = new TerrainZone[quadTreesDivisionsCount * quadTreesDivisionsCount];
+            view.WaterDrawZonesRanges = new vec4[waterDivisionsCount * waterDivisionsCount];
         }
-    }
 
-    if (maxValues)
-    {
-        delete[] maxValues;
-        maxValues = nullptr;
+        FreeValues(m_maxValues, quadTreesDivisionsCount);
+        FreeValues(m_minValues, quadTreesDivisionsCount);
+
+        break;
     }
+    case BuildStage::HeightBiomeValues:
+    {
+        profiler->BeginZone("Chunk::Downscale");
+        gpuProfiler->BeginZone("Chunk::Downscale");
+        m_heightValues = m_heightTexture->GetDownscaleValues({ shaderManager->GetAverageShader(), 4, 8 }, HEIGHT_BIOME_DEPTH);
+        m_biomeValues  = m_biomesTexture->GetDownscaleValues({ shaderManager->GetAverageShader(), 4, 8 }, HEIGHT_BIOME_DEPTH);
+        gpuProfiler->EndZone();
+        profiler->EndZone();
+
+        TerrainQuery::GetInstance()->AddChunkHeights(m_chunkID, m_heightValues, heightBiomeDivisionsCount);
 
-    if (minValues)
+        break;
+    }
+    case BuildStage::Quantize:
     {
-        delete[] minValues;
-        minValues = nullptr;
+        // The generation stages needed the R32F images, the chunk only samples the textures from
+        // now on.
+        profiler->BeginZone("Chunk::Quantize");
+        gpuProfiler->BeginZone("Chunk::Quantize");
+        SetQuantizedTextures(m_heightTexture, m_biomesTexture, m_minHeight, m_maxHeight);
+        gpuProfiler->EndZone();
+        profiler->EndZone();
+
+        break;
     }
-
-    for (int i = 0; i < heightBiomeDivisionsCount; i++)
+    case BuildStage::FolliageNoise:
     {
-        if (biomeValues[i])
+        profiler->BeginZone("Chunk::FolliageNoise");
+
+        PerlinNoise::NoiseParameters folliageRandomnessParameters;
+
+                 folliageRandomnessParameters.StartPosition = startPosition;
+                 folliageRandomnessParameters.EndPosition   = endPosition;
+                 folliageRandomnessParameters.Frequency     = Terrain::FOLLIAGE_RANDOMNESS_FREQUENCY;
+                 folliageRandomnessParameters.FudgeFactor   = Terrain::FOLLIAGE_RANDOMNESS_FUDGE_FACTOR;
+                 folliageRandomnessParameters.Exponent      = Terrain::FOLLIAGE_RANDOMNESS_EXPONENT;
+                 folliageRandomnessParameters.OctavesCount  = Terrain::FOLLIAGE_RANDOMNESS_OCTAVES_COUNT;
+                 folliageRandomnessParameters.TextureSize   = heightBiomeDivisionsCount;
+
+        Texture* folliageRandomnessMap                      = m_perlinNoise->RenderPerlinNoise(folliageRandomnessParameters);
+        m_folliageRandomnessValues                          = Texture::GetPixelsInfo(folliageRandomnessMap);
+
+        PerlinNoise::NoiseParameters folliageSelectionRandomnessParameters;
+
+                 folliageSelectionRandomnessParameters.StartPosition = startPosition;
+                 folliageSelectionRandomnessParameters.EndPosition   = endPosition;
+                 folliageSelectionRandomnessParameters.Frequency     = Terrain::FOLLIAGE_SELECTION_RANDOMNESS_FREQUENCY;
+                 folliageSelectionRandomnessParameters.FudgeFactor   = Terrain::FOLLIAGE_SELECTION_RANDOMNESS_FUDGE_FACTOR;
+                 folliageSelectionRandomnessParameters.Exponent      = Terrain::FOLLIAGE_SELECTION_RANDOMNESS_EXPONENT;
+                 folliageSelectionRandomnessParameters.OctavesCount  = Terrain::FOLLIAGE_SELECTION_RANDOMNESS_OCTAVES_COUNT;
+                 folliageSelectionRandomnessParameters.TextureSize   = heightBiomeDivisionsCount;
+
+        Texture* folliageSelectionRandomnessMap                      = m_perlinNoise->RenderPerlinNoise(folliageSelectionRandomnessParameters);
+        m_folliageSelectionRandomnessValues                          = Texture::GetPixelsInfo(folliageSelectionRandomnessMap);
+
+        if (folliageSelectionRandomnessMap)
         {
-            delete[] biomeValues[i];
-            biomeValues[i] = nullptr;
+            delete folliageSelectionRandomnessMap;
+            folliageSelectionRandomnessMap = nullptr;
         }
 
-        if (heightValues[i])
+        if (folliageRandomnessMap)
         {
-            delete[] heightValues[i];
-            heightValues[i] = nullptr;
+            delete folliageRandomnessMap;
+            folliageRandomnessMap = nullptr;
         }
-    }
 
-    if (biomeValues)
-    {
-        delete[] biomeValues;
-        biomeValues = nullptr;
-    }
+        profiler->EndZone();
 
-    if (heightValues)
+        break;
+    }
+    case BuildStage::Folliage:
     {
-        delete[] heightValues;
-        heightValues = nullptr;
+        vector<vec3> obstacles;
+
+        profiler->BeginZone("Chunk::Folliage");
+        m_folliageCells = new FolliageCell[FOLLIAGE_CELLS_WIDTH * FOLLIAGE_CELLS_WIDTH];
+        FillDesiredInstances(m_quadTree, obstacles);
+        profiler->EndZone();
+
+        TerrainQuery::GetInstance()->AddChunkObstacles(m_chunkID, obstacles);
+
+        FreeValues(m_folliageSelectionRandomnessValues, heightBiomeDivisionsCount);
+        FreeValues(m_folliageRandomnessValues,          heightBiomeDivisionsCount);
+        FreeValues(m_biomeValues,                       heightBiomeDivisionsCount);
+        FreeValues(m_heightValues,                      heightBiomeDivisionsCount);
+
+        break;
+    }
+    case BuildStage::Ready:
+        return true;
     }
+
+    m_buildStage = (BuildStage)((int)m_buildStage + 1);
+
+    return m_buildStage == BuildStage::Ready;
 }
 
-Chunk::~Chunk()
+Chunk::BuildStage Chunk::GetBuildStage() const
 {
-    if (m_waterDrawZonesRanges)
-    {
-        delete[] m_waterDrawZonesRanges;
-        m_waterDrawZonesRanges = nullptr;
-    }
+    return m_buildStage;
+}
 
-    if (m_drawZonesRanges)
-    {
-        delete[] m_drawZonesRanges;
-        m_drawZonesRanges = nullptr;
-    }
+bool Chunk::IsDrawable() const
+{
+    return m_buildStage > BuildStage::QuadTree;
+}
+
+void Chunk::SetTargetTextureSize(int textureSize)
+{
+    m_targetTextureSize = std::max(m_targetTextureSize, textureSize);
+}
+
+bool Chunk::NeedsUpgrade() const
+{
+    return m_buildStage == BuildStage::Ready && m_targetTextureSize > m_textureSize;
+}
+
+// Runs the current upgrade stage, like BuildStep. The textures, the quadtree bounds and the CPU copy
+// of the heights are replaced, the folliage is kept from the first build.
+bool Chunk::UpgradeStep()
+{
+    ShaderManager* shaderManager             = ShaderManager::GetInstance();
+    Profiler*      profiler                  = Profiler::GetInstance();
+    GpuProfiler*   gpuProfiler               = GpuProfiler::GetInstance();
 
-    if (m_waterQuadTree)
+    int            quadTreesDivisionsCount   = 1 << (QUAD_TREE_DEPTH - 1);
+    int            heightBiomeDivisionsCount = 1 << (HEIGHT_BIOME_DEPTH - 1);
+
+    switch (m_upgradeStage)
+    {
+    case UpgradeStage::HeightNoise:
     {
-        delete m_waterQuadTree;
-        m_waterQuadTree = nullptr;
+        // The target can grow while the chunk is upgraded, the textures started are finished first.
+        m_upgradeTextureSize   = m_targetTextureSize;
+
+        profiler->BeginZone("Chunk::UpgradeHeightNoise");
+        gpuProfiler->BeginZone("Chunk::UpgradeHeightNoise");
+        m_upgradeHeightTexture = RenderHeightNoise(m_upgradeTextureSize);
+        gpuProfiler->EndZone();
+        profiler->EndZone();
+
+        break;
     }
+    case UpgradeStage::Erosion:
+    {
+        profiler->BeginZone("Chunk::UpgradeHydraulicErosion");
+        gpuProfiler->BeginZone("Chunk::UpgradeHydraulicErosion");
+        m_hydraulicErosion->ApplyErosion(m_upgradeHeightTexture);
+        gpuProfiler->EndZone();
+        profiler->EndZone();
 
-    if (m_quadTree)
+        break;
+    }
+    case UpgradeStage::Blur:
     {
-        delete m_quadTree;
-        m_quadTree = nullptr;
+        profiler->BeginZone("Chunk::UpgradeGaussianBlur");
+        gpuProfiler->BeginZone("Chunk::UpgradeGaussianBlur");
+        m_gaussianBlur->ApplyBlur(m_upgradeHeightTexture);
+        gpuProfiler->EndZone();
+        profiler->EndZone();
+
+        break;
     }
+    case UpgradeStage::BiomeNoise:
+    {
+        profiler->BeginZone("Chunk::UpgradeBiomeNoise");
+        gpuProfiler->BeginZone("Chunk::UpgradeBiomeNoise");
+        m_upgradeBiomesTexture = RenderBiomeNoise(m_upgradeTextureSize);
+        gpuProfiler->EndZone();
+        profiler->EndZone();
 
-    if (m_biomesTexture)
+        break;
+    }
+    case UpgradeStage::Downscale:
     {
-        delete m_biomesTexture;
-        m_biomesTexture = nullptr;
+        // The erosion doesn't give exactly the same heights at another resolution, the node bounds,
+        // the CPU copy of the heights and the range of the quantization are measured again.
+        profiler->BeginZone("Chunk::UpgradeDownscale");
+        gpuProfiler->BeginZone("Chunk::UpgradeDownscale");
+        m_minValues    = m_upgradeHeightTexture->GetDownscaleValues({ shaderManager->GetMinShader(),     4, 8 }, QUAD_TREE_DEPTH);
+        m_maxValues    = m_upgradeHeightTexture->GetDownscaleValues({ shaderManager->GetMaxShader(),     4, 8 }, QUAD_TREE_DEPTH);
+        m_heightValues = m_upgradeHeightTexture->GetDownscaleValues({ shaderManager->GetAverageShader(), 4, 8 }, HEIGHT_BIOME_DEPTH);
+        gpuProfiler->EndZone();
+        profiler->EndZone();
+
+        break;
     }
-
-    if (m_heightTexture)
+    case UpgradeStage::Swap:
     {
-        delete m_heightTexture;
-        m_heightTexture = nullptr;
+        profiler->BeginZone("Chunk::UpgradeSwap");
+        gpuProfiler->BeginZone("Chunk::UpgradeSwap");
+
+        // The quadtree is built again over the same nodes block, the folliage cells are indexed by
+        // position so they stay valid. The obstacles of the chunk are kept by TerrainQuery.
+        BuildQuadTree();
+        FindHeightRange();
+
+        TerrainQuery::GetInstance()->AddChunkHeights(m_chunkID, m_heightValues, heightBiomeDivisionsCount);
+
+        FreeValues(m_heightValues, heightBiomeDivisionsCount);
+        FreeValues(m_maxValues,    quadTreesDivisionsCount);
+        FreeValues(m_minValues,    quadTreesDivisionsCount);
+
+        SetQuantizedTextures(m_upgradeHeightTexture, m_upgradeBiomesTexture, m_minHeight, m_maxHeight);
+
+        gpuProfiler->EndZone();
+        profiler->EndZone();
+
+        m_upgradeHeightTexture = nullptr;
+        m_upgradeBiomesTexture = nullptr;
+        m_textureSize          = m_upgradeTextureSize;
+        m_upgradeStage         = UpgradeStage::HeightNoise;
+
+        return true;
+    }
     }
 
-    FreeWaterBuffers();
-    FreeTerrainBuffers();
+    m_upgradeStage = (UpgradeStage)((int)m_upgradeStage + 1);
+
+    return false;
+}
+
+Chunk::UpgradeStage Chunk::GetUpgradeStage() const
+{
+    return m_upgradeStage;
 }
 
-void Chunk::Update(Camera* camera, float deltaTime, bool renderDebug, bool renderFoliage)
+// Runs on a worker thread, from the camera snapshot only: nothing here may touch GL or the
+// shared helpers, the debug rectangles are handed to the DebugHelper by FinishView.
+void Chunk::PrepareView(int viewIndex, const Camera::Snapshot& camera, bool renderDebug, bool renderFoliage, bool fillWater)
 {
-    m_renderDebug = renderDebug;
+    ChunkView& view = m_views[viewIndex];
+
+    view.ZoneRangesIndex        = 0;
+    view.WaterZoneRangesIndex   = 0;
+    view.ZonesBaseInstance      = -1;
+    view.WaterZonesBaseInstance = -1;
+    view.RenderDebug            = renderDebug;
 
-    m_zoneRangesIndex = 0;
+    view.DebugRectangles.clear();
 
-    MathHelper::Frustum cameraFrustum = MathHelper::GetCameraFrustum(camera);
+    if (!IsDrawable())
+        return;
 
-    FillZoneRanges(cameraFrustum, m_quadTree);
-    UpdateZoneRangesBuffer();
+    FillZoneRanges(view, camera.Frustum, camera.Position, m_quadTree, true, fillWater);
 
-    if (renderFoliage)
+    // The instance arrays of the previous frame were in the frame arena, they are gone. Reserving
+    // the previous count avoids regrowing them (and leaving the smaller copies) in the arena.
+    for (auto& folliageModel : view.FolliageModelsInstances)
     {
-        for (auto& folliageModel : m_folliageModelsInstances)
-            m_folliageModelsInstances[folliageModel.first].clear();
+        FolliageInstances& instances = folliageModel.second;
 
-        FillFolliageInstances(camera, cameraFrustum, m_quadTree);
+        instances.PreviousCount = instances.Transforms.size();
+        instances.Transforms    = FrameVector<mat4>();
+        instances.Transforms.reserve(instances.PreviousCount);
+        instances.BaseInstance  = -1;
+    }
+
+    if (renderFoliage && m_buildStage == BuildStage::Ready)
+    {
+        FillFolliageInstances(view, camera, m_quadTree);
 
-        for (auto& model : m_folliageModelsInstances)
+        for (auto& model : view.FolliageModelsInstances)
         {
-            sort(model.second.begin(), model.second.end(), [&](const mat4& a, const mat4& b)
+            sort(model.second.Transforms.begin(), model.second.Transforms.end(), [&](const mat4& a, const mat4& b)
                 {
                     const float* valsA = value_ptr(a);
                     const float* valsB = value_ptr(b);
 
-                    return distance(vec3(valsA[12], valsA[13], valsA[14]), camera->GetPosition()) > distance(vec3(valsB[12], valsB[13], valsB[14]), camera->GetPosition());
+                    return distance(vec3(valsA[12], valsA[13], valsA[14]), camera.Position) > distance(vec3(valsB[12], valsB[13], valsB[14]), camera.Position);
                 });
         }
     }
 }
 
-void Chunk::UpdateWater(Camera* camera, float deltaTime, bool renderDebug)
+// Runs on the main thread once the view is prepared, the instance data of the view is written in
+// the region of the frame of the StreamingBuffer.
+void Chunk::FinishView(int viewIndex)
 {
-    m_renderDebug = renderDebug;
+    ChunkView&       view            = m_views[viewIndex];
+    StreamingBuffer* streamingBuffer = StreamingBuffer::GetInstance();
 
-    m_waterZoneRangesIndex = 0;
+    if (view.ZoneRangesIndex > 0)
+        view.ZonesBaseInstance = streamingBuffer->Write(view.DrawZonesRanges, view.ZoneRangesIndex, sizeof(TerrainZone));
 
-    MathHelper::Frustum cameraFrustum = MathHelper::GetCameraFrustum(camera);
+    if (view.WaterZoneRangesIndex > 0)
+        view.WaterZonesBaseInstance = streamingBuffer->Write(view.WaterDrawZonesRanges, view.WaterZoneRangesIndex, sizeof(vec4));
 
-    FillWaterZoneRanges(cameraFrustum, m_waterQuadTree);
-    UpdateWaterZoneRangesBuffer();
-}
-
-void Chunk::DrawTerrain(Camera* camera, Light* light, const vector<Material*>& terrainMaterials, Texture* terrainBiomesData)
-{
-    vec3           cameraPosition = camera->GetPosition();
-                   
-    mat4           model          = translate(mat4(1.0f), GetTranslation());
-    mat4           view           = camera->GetViewMatrix();
-    mat4           projection     = camera->GetProjectionMatrix();
-
-    ShaderManager* shaderManager  = ShaderManager::GetInstance();
-    Shader*        terrainShader  = shaderManager->GetTerrainShader();
-
-    terrainShader->Use();
-
-    terrainShader->SetMatrix4("Model",                     model);
-
-    terrainShader->SetVec3("CameraPosition",               cameraPosition);
-    terrainShader->SetFloat("DistanceForDetails",          Terrain::DISTANCE_FOR_DETAILS);
-    terrainShader->SetFloat("TessellationLevel",           Terrain::MAX_TESSELATION);
-
-    terrainShader->SetTexture("HeightTexture",             m_heightTexture, 0);
-    terrainShader->SetTexture("BiomeTexture",              m_biomesTexture, 1);
+    for (auto& folliageModel : view.FolliageModelsInstances)
+    {
+        auto& transforms = folliageModel.second.Transforms;
 
-    terrainShader->SetMatrix4("View",                      view);
-    terrainShader->SetMatrix4("Projection",                projection);
+        if (!transforms.empty())
+            folliageModel.second.BaseInstance = streamingBuffer->Write(transforms.data(), (int)transforms.size(), sizeof(mat4));
+    }
 
-    terrainShader->SetFloat("TerrainWidth",                Terrain::CHUNK_WIDTH);
-    terrainShader->SetFloat("GridWidth",                   CHUNK_GRID_WIDTH);
-    terrainShader->SetFloat("GridHeight",                  CHUNK_GRID_HEIGHT);
-    terrainShader->SetFloat("TerrainAmplitude",            Terrain::TERRAIN_AMPLITUDE);
+    for (auto& debugRectangle : view.DebugRectangles)
+        DebugHelper::GetInstance()->AddRectangleInstance(debugRectangle.Center, debugRectangle.Extents);
+}
 
-    terrainShader->SetFloat("Gamma",                       Terrain::GAMMA);
+void Chunk::DrawTerrain(Shader* terrainShader, int viewIndex)
+{
+    const ChunkView& view = m_views[viewIndex];
 
-    terrainShader->SetLight(camera, light);
+    if (view.ZoneRangesIndex == 0 || view.ZonesBaseInstance < 0)
+        return;
 
-    terrainShader->SetInt("BiomesCount",                   terrainBiomesData->GetWidth());
-    terrainShader->SetInt("MaterialsPerBiome",             terrainBiomesData->GetHeight());
+    mat4 model = translate(mat4(1.0f), GetTranslation());
 
-    terrainShader->SetTexture("BiomeMaterialsTexture",     terrainBiomesData, 2);
+    terrainShader->SetMatrix4("Model",             model);
+    terrainShader->SetFloat("TexCoordsMultiplier", TEX_COORDS_MULTIPLIER);
+    terrainShader->SetFloat("HeightScale",         m_heightScale);
+    terrainShader->SetFloat("HeightBias",          m_heightBias);
 
-    terrainShader->SetMaterials("TerrainTextures",
-                                "TerrainNormalTextures", 
-                                "TerrainSpecularTextures", terrainMaterials,  3);
+    terrainShader->SetTexture("HeightTexture",     m_heightTexture, 0);
+    terrainShader->SetTexture("BiomeTexture",      m_biomesTexture, 1);
 
     glBindVertexArray(m_vao);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-    glDrawElementsInstanced(GL_PATCHES, INDICES_COUNT, GL_UNSIGNED_INT, 0, m_zoneRangesIndex);
+    StreamingBuffer::GetInstance()->BindVertexBuffer(ZONES_BINDING, sizeof(TerrainZone));
+    glDrawElementsInstancedBaseInstance(GL_TRIANGLES, INDICES_COUNT, GL_UNSIGNED_INT, 0, view.ZoneRangesIndex, view.ZonesBaseInstance);
 }
 
-void Chunk::DrawFolliage(Camera* camera, Light* light)
+void Chunk::DrawFolliage(Camera* camera, Light* light, int viewIndex)
 {
     mat4 model      = translate(mat4(1.0f), GetTranslation());
     mat4 view       = camera->GetViewMatrix();
     mat4 projection = camera->GetProjectionMatrix();
 
-    for (auto& keyValue : m_folliageModelsInstances)
+    for (auto& keyValue : m_views[viewIndex].FolliageModelsInstances)
     {
+        if (keyValue.second.Transforms.empty() || keyValue.second.BaseInstance < 0)
+            continue;
+
         auto modelShader = keyValue.first;
         auto model = modelShader.first;
         auto shader = modelShader.second;
@@ -383,23 +608,104 @@ void Chunk::DrawFolliage(Camera* camera, Light* light)
         shader->SetFloat("GridWidth",        CHUNK_GRID_WIDTH);
         shader->SetFloat("GridHeight",       CHUNK_GRID_HEIGHT);
         shader->SetFloat("TerrainAmplitude", Terrain::TERRAIN_AMPLITUDE);
+        shader->SetFloat("HeightScale",      m_heightScale);
+        shader->SetFloat("HeightBias",       m_heightBias);
 
         shader->SetTexture("NoiseTexture",   m_heightTexture, 0);
 
         if (shader->HasLightUniforms())
             shader->SetLight(camera, light);
 
-        model->SetInstances(keyValue.second);
+        model->SetInstances(keyValue.second.BaseInstance, (int)keyValue.second.Transforms.size());
         model->Draw(shader, "DiffuseTextures", "NormalTextures", "SpecularTextures", 1);
     }
 }
 
-void Chunk::DrawWater(Camera* camera, Light* light, Texture* refractionTexture, Texture* reflectionTexture, Texture* refractionDepthTexture, Texture* reflectionDepthTexture, float waterMoveFactor, Material* waterMaterial, float waterTime)
+void Chunk::DrawWater(Shader* waterShader, int viewIndex)
 {
-    ShaderManager* shaderManager = ShaderManager::GetInstance();
-    Shader*        waterShader   = shaderManager->GetWaterShader();
+    const ChunkView& view = m_views[viewIndex];
+
+    if (view.WaterZoneRangesIndex == 0 || view.WaterZonesBaseInstance < 0)
+        return;
+
+    mat4 model = translate(mat4(1.0f), GetTranslation() + vec3(0.0f, Terrain::WATER_LEVEL, 0.0f));
+
+    waterShader->SetMatrix4("Model", model);
+
+    //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+
+    glBindVertexArray(m_waterVao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_waterEbo);
+    StreamingBuffer::GetInstance()->BindVertexBuffer(ZONES_BINDING, sizeof(vec4));
+    glDrawElementsInstancedBaseInstance(GL_PATCHES, INDICES_COUNT, GL_UNSIGNED_INT, 0, view.WaterZoneRangesIndex, view.WaterZonesBaseInstance);
+
+    //glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+}
+
+vec3 Chunk::GetTranslation() const
+{
+    return GetPositionForChunkId(m_chunkID);
+}
+
+int Chunk::GetTextureSizeForDistance(float distance)
+{
+    int   textureSize     = MAX_TEXTURE_SIZE;
+    float halvingDistance = TEXTURE_SIZE_HALVING_DISTANCE;
+
+    while (distance > halvingDistance && textureSize > MIN_TEXTURE_SIZE)
+    {
+        textureSize     >>= 1;
+        halvingDistance  *= 2.0f;
+    }
+
+    return textureSize;
+}
+
+vec3 Chunk::GetPositionForChunkId(Vec2Int chunkId)
+{
+    return vec3(chunkId.first  * (Terrain::CHUNK_WIDTH - CHUNK_CLOSE_BIAS),
+                0.0f,
+                chunkId.second * (Terrain::CHUNK_WIDTH - CHUNK_CLOSE_BIAS));
+}
+
+// The parameters shared by all the chunks are set once per pass, so the materials
+// are bound only once instead of once for every chunk.
+void Chunk::SetTerrainShaderParameters(Shader* terrainShader, Camera* camera, Light* light, MaterialArray* terrainMaterials, Texture* terrainBiomesData)
+{
+    vec3 cameraPosition = camera->GetPosition();
+
+    mat4 view           = camera->GetViewMatrix();
+    mat4 projection     = camera->GetProjectionMatrix();
 
-    mat4 model      = translate(mat4(1.0f), GetTranslation() + vec3(0.0f, Terrain::WATER_LEVEL, 0.0f)); 
+    terrainShader->Use();
+
+    terrainShader->SetVec3("CameraPosition",               cameraPosition);
+
+    terrainShader->SetMatrix4("View",                      view);
+    terrainShader->SetMatrix4("Projection",                projection);
+
+    terrainShader->SetFloat("TerrainWidth",                Terrain::CHUNK_WIDTH);
+    terrainShader->SetFloat("GridWidth",                   CHUNK_GRID_WIDTH);
+    terrainShader->SetFloat("GridHeight",                  CHUNK_GRID_HEIGHT);
+    terrainShader->SetFloat("TerrainAmplitude",            Terrain::TERRAIN_AMPLITUDE);
+
+    terrainShader->SetFloat("Gamma",                       Terrain::GAMMA);
+
+    terrainShader->SetLight(camera, light);
+
+    terrainShader->SetInt("BiomesCount",                   terrainBiomesData->GetWidth());
+    terrainShader->SetInt("MaterialsPerBiome",             terrainBiomesData->GetHeight());
+    terrainShader->SetInt("TerrainMaterialsCount",         terrainMaterials->GetMaterialsCount());
+
+    terrainShader->SetTexture("BiomeMaterialsTexture",     terrainBiomesData, 2);
+
+    terrainShader->SetMaterialArray("TerrainTextures",
+                                    "TerrainNormalTextures",
+                                    "TerrainSpecularTextures", terrainMaterials, 3);
+}
+
+void Chunk::SetWaterShaderParameters(Shader* waterShader, Camera* camera, Light* light, Texture* refractionTexture, Texture* reflectionTexture, Texture* refractionDepthTexture, Texture* reflectionDepthTexture, float waterMoveFactor, MaterialArray* waterMaterial, float waterTime)
+{
     mat4 view       = camera->GetViewMatrix();
     mat4 projection = camera->GetProjectionMatrix();
 
@@ -407,7 +713,6 @@ void Chunk::DrawWater(Camera* camera, Light* light, Texture* refractionTexture,
 
     waterShader->Use();
 
-    waterShader->SetMatrix4("Model",                      model);
     waterShader->SetMatrix4("View",                       view);
     waterShader->SetMatrix4("Projection",                 projection);
                                                           
@@ -435,9 +740,9 @@ void Chunk::DrawWater(Camera* camera, Light* light, Texture* refractionTexture,
     waterShader->SetTexture("ReflectionTexture",          reflectionTexture,      1);
     waterShader->SetTexture("RefractionDepthTexture",     refractionDepthTexture, 2);
     waterShader->SetTexture("ReflectionDepthTexture",     reflectionDepthTexture, 3);
-    waterShader->SetMaterials("WaterTextures",
-                              "WaterNormalTextures",
-                              "WaterSpecularTextures", { waterMaterial }, 4);
+    waterShader->SetMaterialArray("WaterTextures",
+                                  "WaterNormalTextures",
+                                  "WaterSpecularTextures", waterMaterial, 4);
                                                           
     waterShader->SetFloat("FadeWaterDepth",               3.0f);
                                                           
@@ -448,26 +753,7 @@ void Chunk::DrawWater(Camera* camera, Light* light, Texture* refractionTexture,
                                                           
     waterShader->SetFloat("Near",                         camera->GetNear());
     waterShader->SetFloat("Far",                          camera->GetFar());
-
-    //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-
-    glBindVertexArray(m_waterVao);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_waterEbo);
-    glDrawElementsInstanced(GL_PATCHES, INDICES_COUNT, GL_UNSIGNED_INT, 0, m_waterZoneRangesIndex);
-
-    //glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-}
-
-vec3 Chunk::GetTranslation() const
-{
-    return GetPositionForChunkId(m_chunkID);
-}
-
-vec3 Chunk::GetPositionForChunkId(Vec2Int chunkId)
-{
-    return vec3(chunkId.first  * (Terrain::CHUNK_WIDTH - CHUNK_CLOSE_BIAS),
-                0.0f,
-                chunkId.second * (Terrain::CHUNK_WIDTH - CHUNK_CLOSE_BIAS));
+    TerrainClipmap::SetDepthRangeParameters(waterShader, camera);
 }
 
 void Chunk::CreateTerrainBuffers()
@@ -527,13 +813,16 @@ void Chunk::CreateTerrainBuffers()
 
     VertexPositionTexture::SetLayout();
 
-    glGenBuffers(1, &m_instanceVbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
-    glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_DYNAMIC_DRAW);
-
+    // The zones come from the StreamingBuffer, bound in Draw since it can be reallocated.
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glVertexAttribDivisor(2, 1);
+    glVertexAttribFormat(2, 4, GL_FLOAT, GL_FALSE, offsetof(TerrainZone, ZoneRange));
+    glVertexAttribBinding(2, ZONES_BINDING);
+
+    glEnableVertexAttribArray(3);
+    glVertexAttribFormat(3, 2, GL_FLOAT, GL_FALSE, offsetof(TerrainZone, MorphRange));
+    glVertexAttribBinding(3, ZONES_BINDING);
+
+    glVertexBindingDivisor(ZONES_BINDING, 1);
 
     glGenBuffers(1, &m_ebo);
 
@@ -559,13 +848,11 @@ void Chunk::FreeTerrainBuffers()
 
     VertexPositionTexture::ResetLayout();
     glDisableVertexAttribArray(2);
+    glDisableVertexAttribArray(3);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glDeleteBuffers(1, &m_vbo);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glDeleteBuffers(1, &m_instanceVbo);
-
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     glDeleteBuffers(1, &m_ebo);
 
@@ -632,13 +919,11 @@ void Chunk::CreateWaterBuffers()
 
     VertexPositionTexture::SetLayout();
 
-    glGenBuffers(1, &m_waterInstanceVbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_waterInstanceVbo);
-    glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_DYNAMIC_DRAW);
-
+    // The zones come from the StreamingBuffer, bound in DrawWater since it can be reallocated.
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glVertexAttribDivisor(2, 1);
+    glVertexAttribFormat(2, 4, GL_FLOAT, GL_FALSE, 0);
+    glVertexAttribBinding(2, ZONES_BINDING);
+    glVertexBindingDivisor(ZONES_BINDING, 1);
 
     glGenBuffers(1, &m_waterEbo);
 
@@ -668,9 +953,6 @@ void Chunk::FreeWaterBuffers()
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glDeleteBuffers(1, &m_waterVbo);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glDeleteBuffers(1, &m_waterInstanceVbo);
-
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     glDeleteBuffers(1, &m_waterEbo);
 
@@ -678,27 +960,112 @@ void Chunk::FreeWaterBuffers()
     glDeleteVertexArrays(1, &m_waterVao);
 }
 
-void Chunk::BuildQuadTree(pair<float**, float**> minMax, pair<float**, float**> heightBiome, pair<float**, float**> folliageRandomnessValues)
+// The noise covers the whole chunk whatever the size of the texture, so the shaders sample it the
+// same way at any resolution.
+Texture* Chunk::RenderHeightNoise(int textureSize)
 {
+    vec3                         translation = GetTranslation();
+    PerlinNoise::NoiseParameters heightParameters;
+
+    heightParameters.StartPosition = vec2(translation.x - Terrain::CHUNK_WIDTH / 2.0f, translation.z - Terrain::CHUNK_WIDTH / 2.0f);
+    heightParameters.EndPosition   = vec2(translation.x + Terrain::CHUNK_WIDTH / 2.0f, translation.z + Terrain::CHUNK_WIDTH / 2.0f);
+    heightParameters.Frequency     = Terrain::HEIGHT_FREQUENCY;
+    heightParameters.FudgeFactor   = Terrain::HEIGHT_FUDGE_FACTOR;
+    heightParameters.Exponent      = Terrain::HEIGHT_EXPONENT;
+    heightParameters.OctavesCount  = Terrain::HEIGHT_OCTAVES_COUNT;
+    heightParameters.TextureSize   = textureSize;
+
+    return m_perlinNoise->RenderPerlinNoise(heightParameters);
+}
+
+Texture* Chunk::RenderBiomeNoise(int textureSize)
+{
+    vec3                         translation = GetTranslation();
+    PerlinNoise::NoiseParameters biomeParameters;
+
+    biomeParameters.StartPosition = vec2(translation.x - Terrain::CHUNK_WIDTH / 2.0f, translation.z - Terrain::CHUNK_WIDTH / 2.0f);
+    biomeParameters.EndPosition   = vec2(translation.x + Terrain::CHUNK_WIDTH / 2.0f, translation.z + Terrain::CHUNK_WIDTH / 2.0f);
+    biomeParameters.Frequency     = Terrain::BIOME_FREQUENCY;
+    biomeParameters.FudgeFactor   = Terrain::BIOME_FUDGE_FACTOR;
+    biomeParameters.Exponent      = Terrain::BIOME_EXPONENT;
+    biomeParameters.OctavesCount  = Terrain::BIOME_OCTAVES_COUNT;
+    biomeParameters.TextureSize   = textureSize;
+
+    return m_perlinNoise->RenderPerlinNoise(biomeParameters);
+}
+
+// Replaces the drawn textures with the quantized copies of the R32F ones, which are freed. The
+// heights are spread over the 16 bits between the lowest and the highest point of the chunk, the
+// biomes are already in [0, 1].
+void Chunk::SetQuantizedTextures(Texture* heightTexture, Texture* biomesTexture, float minHeight, float maxHeight)
+{
+    float    heightScale            = std::max(maxHeight - minHeight, numeric_limits<float>::epsilon());
+    Shader*  quantizeShader         = ShaderManager::GetInstance()->GetTextureQuantizeShader();
+
+    Texture* quantizedHeightTexture = heightTexture->GetQuantizedTexture(quantizeShader, Texture::Format::R16, heightScale, minHeight);
+    Texture* quantizedBiomesTexture = biomesTexture->GetQuantizedTexture(quantizeShader, Texture::Format::R8,  1.0f,        0.0f);
+
+    if (m_heightTexture != heightTexture)
+        delete m_heightTexture;
+
+    if (m_biomesTexture != biomesTexture)
+        delete m_biomesTexture;
+
+    delete heightTexture;
+    delete biomesTexture;
+
+    m_heightTexture = quantizedHeightTexture;
+    m_biomesTexture = quantizedBiomesTexture;
+    m_heightScale   = heightScale;
+    m_heightBias    = minHeight;
+}
+
+// An upgrade builds the tree again, in the same block.
+void Chunk::BuildQuadTree()
+{
+    if (!m_nodes)
+        m_nodes = new Node[NODES_COUNT];
+    else
+    {
+        for (int i = 0; i < NODES_COUNT; i++)
+            m_nodes[i] = Node();
+    }
+
+    m_nodesCount = 0;
+
     m_quadTree = CreateNode(0, 
                             vec2(-Terrain::CHUNK_WIDTH / 2.0f, -Terrain::CHUNK_WIDTH / 2.0f),
                             vec2( Terrain::CHUNK_WIDTH / 2.0f,  Terrain::CHUNK_WIDTH / 2.0f),
-                            make_pair(0, 0),
-                            minMax,
-                            heightBiome,
-                            folliageRandomnessValues);
+                            make_pair(0, 0));
 }
 
-Chunk::Node* Chunk::CreateNode(int depth, const vec2& bottomLeft, const vec2& topRight, pair<int, int> positionId, pair<float**, float**> minMax, pair<float**, float**> heightBiome, pair<float**, float**> folliageRandomnessValues)
+void Chunk::FindHeightRange()
+{
+    int quadTreesDivisionsCount = 1 << (QUAD_TREE_DEPTH - 1);
+
+    m_minHeight = m_minValues[0][0];
+    m_maxHeight = m_maxValues[0][0];
+
+    for (int i = 0; i < quadTreesDivisionsCount; i++)
+    {
+        for (int j = 0; j < quadTreesDivisionsCount; j++)
+        {
+            m_minHeight = std::min(m_minHeight, m_minValues[i][j]);
+            m_maxHeight = std::max(m_maxHeight, m_maxValues[i][j]);
+        }
+    }
+}
+
+Chunk::Node* Chunk::CreateNode(int depth, const vec2& bottomLeft, const vec2& topRight, pair<int, int> positionId)
 {
     if (depth >= QUAD_TREE_DEPTH)
         return nullptr;
 
-    Node* result            = new Node();
+    Node* result            = &m_nodes[m_nodesCount++];
 
+    result->Depth           = depth;
     result->ZoneRange       = vec4(bottomLeft.x, bottomLeft.y, topRight.x, topRight.y);
     result->PositionId      = positionId;
-    result->LinkedNode      = nullptr;
 
     vec3 boundingBoxCenter  = vec3((bottomLeft.x + topRight.x) * 0.5f, 0.0f,
                                    (bottomLeft.y + topRight.y) * 0.5f) + GetTranslation();
@@ -710,12 +1077,16 @@ Chunk::Node* Chunk::CreateNode(int depth, const vec2& bottomLeft, const vec2& to
     {
         result->IsLeaf = true;
 
-        float minAmplitude = minMax.first [positionId.first][positionId.second] * Terrain::TERRAIN_AMPLITUDE;
-        float maxAmplitude = minMax.second[positionId.first][positionId.second] * Terrain::TERRAIN_AMPLITUDE;
+        float minAmplitude = m_minValues[positionId.first][positionId.second] * Terrain::TERRAIN_AMPLITUDE;
+        float maxAmplitude = m_maxValues[positionId.first][positionId.second] * Terrain::TERRAIN_AMPLITUDE;
 
         float center       = (maxAmplitude + minAmplitude) / 2.0f;
         float extents      = (maxAmplitude - minAmplitude) / 2.0f;
 
+        // The waves rise above the water level, the leaves just above it still get a patch.
+        result->HasWater    = minAmplitude < Terrain::WATER_LEVEL + WATER_WAVES_EXTENT;
+        result->HeightError = maxAmplitude - minAmplitude;
+
         center  += FOLLIAGE_HEIGHT_BIAS / 2.0f;
         extents += FOLLIAGE_HEIGHT_BIAS / 2.0f;
 
@@ -728,40 +1099,31 @@ Chunk::Node* Chunk::CreateNode(int depth, const vec2& bottomLeft, const vec2& to
         result->Children[0] = CreateNode(depth + 1,
                                          bottomLeft,
                                          (topRight + bottomLeft) * 0.5f,
-                                         make_pair(positionId.first * 2, positionId.second * 2),
-                                         minMax,
-                                         heightBiome, 
-                                         folliageRandomnessValues);
+                                         make_pair(positionId.first * 2, positionId.second * 2));
 
         result->Children[1] = CreateNode(depth + 1,
                                          vec2((bottomLeft.x + topRight.x) * 0.5f, bottomLeft.y),
                                          vec2(topRight.x, (bottomLeft.y + topRight.y) * 0.5f),
-                                         make_pair(1 + positionId.first * 2, positionId.second * 2),
-                                         minMax,
-                                         heightBiome, 
-                                         folliageRandomnessValues);
+                                         make_pair(1 + positionId.first * 2, positionId.second * 2));
 
         result->Children[2] = CreateNode(depth + 1,
                                          vec2(bottomLeft.x, (bottomLeft.y + topRight.y) * 0.5f),
                                          vec2((bottomLeft.x + topRight.x) * 0.5f, topRight.y),
-                                         make_pair(positionId.first * 2, positionId.second * 2 + 1),
-                                         minMax,
-                                         heightBiome,
-                                         folliageRandomnessValues);
+                                         make_pair(positionId.first * 2, positionId.second * 2 + 1));
 
         result->Children[3] = CreateNode(depth + 1,
                                          (topRight + bottomLeft) * 0.5f,
                                          topRight,
-                                         make_pair(positionId.first * 2 + 1, positionId.second * 2 + 1),
-                                         minMax,
-                                         heightBiome,
-                                         folliageRandomnessValues);
+                                         make_pair(positionId.first * 2 + 1, positionId.second * 2 + 1));
 
         float maxAmplitude  = -Terrain::TERRAIN_AMPLITUDE;
         float minAmplitude  =  Terrain::TERRAIN_AMPLITUDE;
 
         for (int i = 0; i < Node::CHILDREN_COUNT; i++)
         {
+            result->HasWater    = result->HasWater || result->Children[i]->HasWater;
+            result->HeightError = std::max(result->HeightError, result->Children[i]->HeightError);
+
             maxAmplitude = std::max(maxAmplitude, 
                                     result->Children[i]->BoundingBox.Center.y + result->Children[i]->BoundingBox.Extents.y);
 
@@ -769,6 +1131,10 @@ Chunk::Node* Chunk::CreateNode(int depth, const vec2& bottomLeft, const vec2& to
                                     result->Children[i]->BoundingBox.Center.y - result->Children[i]->BoundingBox.Extents.y);
         }
 
+        // The children boxes are raised by FOLLIAGE_HEIGHT_BIAS, so their union spans the terrain
+        // heights under the node plus the bias.
+        result->HeightError = std::max(result->HeightError, maxAmplitude - minAmplitude - FOLLIAGE_HEIGHT_BIAS);
+
         float center       = (maxAmplitude + minAmplitude) / 2.0f;
         float extents      = (maxAmplitude - minAmplitude) / 2.0f;
 
@@ -779,159 +1145,167 @@ Chunk::Node* Chunk::CreateNode(int depth, const vec2& bottomLeft, const vec2& to
     result->BoundingBox = MathHelper::AABB(boundingBoxCenter, 
                                            boundingBoxExtents.x, boundingBoxExtents.y, boundingBoxExtents.z);
 
-    if (result->IsLeaf)
+    return result;
+}
+
+// The folliage keeps the granularity of the FOLLIAGE_TREE_DEPTH level, independent of the terrain LODs.
+void Chunk::FillDesiredInstances(Node* node, vector<vec3>& obstacles)
+{
+    if (node->Depth < FOLLIAGE_TREE_DEPTH - 1)
     {
-        int quadTreeWidth    = 1 << (QUAD_TREE_DEPTH    - 1);
-        int heightBiomeWidth = 1 << (HEIGHT_BIOME_DEPTH - 1);
+        for (int i = 0; i < Node::CHILDREN_COUNT; i++)
+            FillDesiredInstances(node->Children[i], obstacles);
 
-        int pixelsPerQuad    = heightBiomeWidth / quadTreeWidth;
+        return;
+    }
 
-        for (int x = 0; x < pixelsPerQuad; x++)
+    vec2 bottomLeft = vec2(node->ZoneRange.x, node->ZoneRange.y);
+    vec2 topRight   = vec2(node->ZoneRange.z, node->ZoneRange.w);
+
+    int quadTreeWidth    = 1 << (FOLLIAGE_TREE_DEPTH - 1);
+    int heightBiomeWidth = 1 << (HEIGHT_BIOME_DEPTH - 1);
+
+    int pixelsPerQuad    = heightBiomeWidth / quadTreeWidth;
+
+    for (int x = 0; x < pixelsPerQuad; x++)
+    {
+        for (int y = 0; y < pixelsPerQuad; y++)
         {
-            for (int y = 0; y < pixelsPerQuad; y++)
-            {
-                int xIndex = positionId.first  * pixelsPerQuad + x;
-                int yIndex = positionId.second * pixelsPerQuad + y;
+            int xIndex = node->PositionId.first  * pixelsPerQuad + x;
+            int yIndex = node->PositionId.second * pixelsPerQuad + y;
 
-                if (folliageRandomnessValues.first[xIndex][yIndex] < Terrain::FOLLIAGE_RANDOMNESS_THRESHOLD)
-                    continue;
+            if (m_folliageRandomnessValues[xIndex][yIndex] < Terrain::FOLLIAGE_RANDOMNESS_THRESHOLD)
+                continue;
 
-                float height = heightBiome.first [xIndex][yIndex];
-                float biome  = heightBiome.second[xIndex][yIndex];
-                
-                auto translation = vec3(bottomLeft.x + (topRight.x - bottomLeft.x) * ((float)x / (float)(pixelsPerQuad - 1)), 
-                                        0.0f, 
-                                        bottomLeft.y + (topRight.y - bottomLeft.y) * ((float)y / (float)(pixelsPerQuad - 1))) +
-                                   GetTranslation();
+            float height = m_heightValues[xIndex][yIndex];
+            float biome  = m_biomeValues[xIndex][yIndex];
+            
+            auto translation = vec3(bottomLeft.x + (topRight.x - bottomLeft.x) * ((float)x / (float)(pixelsPerQuad - 1)), 
+                                    0.0f, 
+                                    bottomLeft.y + (topRight.y - bottomLeft.y) * ((float)y / (float)(pixelsPerQuad - 1))) +
+                               GetTranslation();
 
-                translation = vec3(translation.x, 0.0f, translation.z);
+            translation = vec3(translation.x, 0.0f, translation.z);
 
-                auto biomeModelsVectors = Biome::GetBiomeFolliageModels(height, biome);
+            auto biomeModelsVectors = Biome::GetBiomeFolliageModels(height, biome);
 
-                if (!biomeModelsVectors.size())
-                    continue;
+            if (!biomeModelsVectors.size())
+                continue;
 
-                auto biomeModels = RouletteWheelSelection(biomeModelsVectors, folliageRandomnessValues.second[xIndex][yIndex]);
+            auto biomeModels = RouletteWheelSelection(biomeModelsVectors, m_folliageSelectionRandomnessValues[xIndex][yIndex]);
 
-                if (!biomeModels.Models.size())
-                    continue;
+            if (!biomeModels.Models.size())
+                continue;
 
-                auto biomeModel = RouletteWheelSelection(biomeModels.Models, folliageRandomnessValues.second[yIndex][xIndex]); // little "hack" so we don't need two separate maps
+            auto biomeModel = RouletteWheelSelection(biomeModels.Models, m_folliageSelectionRandomnessValues[yIndex][xIndex]); // little "hack" so we don't need two separate maps
 
-                if (result->DesiredInstances.find(biomeModel) == result->DesiredInstances.end())
-                    result->DesiredInstances[biomeModel] = vector<FolliageProperties>();
+            GetFolliageCell(node).DesiredInstances[biomeModel].push_back( {translation, biomeModels.Chance });
 
-                result->DesiredInstances[biomeModel].push_back( {translation, biomeModels.Chance });
-            }
+            obstacles.push_back(vec3(translation.x, height * Terrain::TERRAIN_AMPLITUDE, translation.z));
         }
     }
-
-    return result;
 }
 
-void Chunk::BuildWaterQuadTree()
+// The terrain nodes are selected by their distance to the camera (CDLOD): a node is drawn whole when
+// the camera is outside the range of the finer level, otherwise its children are visited. The water
+// patches come from the same traversal and keep the size of the WATER_TREE_DEPTH level.
+void Chunk::FillZoneRanges(ChunkView& view, const MathHelper::Frustum& frustum, const vec3& cameraPosition, Node* node, bool fillTerrain, bool fillWater)
 {
-    m_waterQuadTree = CreateWaterNode(0, m_quadTree);
-}
+    bool terrainVisible = fillTerrain && node->BoundingBox.IsOnFrustum(frustum);
+    bool waterVisible   = fillWater && node->HasWater && GetWaterBoundingBox(node).IsOnFrustum(frustum);
 
-Chunk::Node* Chunk::CreateWaterNode(int depth, Node* linkedNode)
-{
-    if (depth >= QUAD_TREE_DEPTH)
-        return nullptr;
+    if (!terrainVisible && !waterVisible)
+        return;
 
-    Node* result = new Node();
+    int  lodLevel       = QUAD_TREE_DEPTH - 1 - node->Depth;
 
-    MathHelper::AABB linkedBoundingBox = linkedNode->BoundingBox;
+    // Subdividing a node flatter than FLAT_NODE_ERROR wouldn't change the surface, and the cracks
+    // next to its finer neighbours are bounded by the same error.
+    if (terrainVisible && (node->IsLeaf || node->HeightError < FLAT_NODE_ERROR ||
+                           node->BoundingBox.GetDistance(cameraPosition) > GetLodRange(lodLevel - 1)))
+    {
+        view.DrawZonesRanges[view.ZoneRangesIndex++] = { node->ZoneRange, GetMorphRange(lodLevel) };
 
-    result->ZoneRange  = linkedNode->ZoneRange;
-    result->PositionId = linkedNode->PositionId;
-    result->LinkedNode = linkedNode;
-    result->IsLeaf     = linkedNode->IsLeaf;
+        if (view.RenderDebug)
+            view.DebugRectangles.push_back(node->BoundingBox);
 
-    
-    if (!result->IsLeaf)
+        terrainVisible = false;
+    }
+
+    if (waterVisible && node->Depth == WATER_TREE_DEPTH - 1)
     {
-        result->Children[0] = CreateWaterNode(depth + 1, linkedNode->Children[0]);
-        result->Children[1] = CreateWaterNode(depth + 1, linkedNode->Children[1]);
-        result->Children[2] = CreateWaterNode(depth + 1, linkedNode->Children[2]);
-        result->Children[3] = CreateWaterNode(depth + 1, linkedNode->Children[3]);
+        view.WaterDrawZonesRanges[view.WaterZoneRangesIndex++] = node->ZoneRange;
+
+        if (view.RenderDebug)
+            view.DebugRectangles.push_back(GetWaterBoundingBox(node));
+
+        waterVisible = false;
     }
 
-    MathHelper::AABB aabb = linkedBoundingBox;
-    aabb.Center = vec3(aabb.Center.x, Terrain::WATER_LEVEL, aabb.Center.z);
-    aabb.Extents = vec3(aabb.Extents.x, 3.0f, aabb.Extents.z); // TODO: Replace this hard-coded number
-    result->BoundingBox = aabb;
+    if (node->IsLeaf || (!terrainVisible && !waterVisible))
+        return;
 
-    return result;
+    for (int i = 0; i < Node::CHILDREN_COUNT; i++)
+        FillZoneRanges(view, frustum, cameraPosition, node->Children[i], terrainVisible, waterVisible);
 }
 
-void Chunk::FillZoneRanges(const MathHelper::Frustum& frustum, Node* node)
+void Chunk::FreeValues(float**& values, int width)
 {
-    if (!node->BoundingBox.IsOnFrustum(frustum))
+    if (!values)
         return;
-    
-    if (node->IsLeaf)
-    {
-        m_drawZonesRanges[m_zoneRangesIndex++] = node->ZoneRange;
 
-        if (m_renderDebug)
-            DebugHelper::GetInstance()->AddRectangleInstance(node->BoundingBox.Center, node->BoundingBox.Extents);
-    }
-    else
+    for (int i = 0; i < width; i++)
     {
-        for (int i = 0; i < Node::CHILDREN_COUNT; i++)
-            FillZoneRanges(frustum, node->Children[i]);
+        if (values[i])
+        {
+            delete[] values[i];
+            values[i] = nullptr;
+        }
     }
+
+    delete[] values;
+    values = nullptr;
 }
 
-void Chunk::UpdateZoneRangesBuffer()
+Chunk::FolliageCell& Chunk::GetFolliageCell(Node* node) const
 {
-    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vec4) * m_zoneRangesIndex, m_drawZonesRanges, GL_DYNAMIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return m_folliageCells[node->PositionId.first * FOLLIAGE_CELLS_WIDTH + node->PositionId.second];
 }
 
-void Chunk::FillWaterZoneRanges(const MathHelper::Frustum& frustum, Node* node)
+MathHelper::AABB Chunk::GetWaterBoundingBox(Node* node) const
 {
-    if (!node->BoundingBox.IsOnFrustum(frustum))
-        return;
-
-    MathHelper::AABB otherAABB = node->LinkedNode->BoundingBox;
-    MathHelper::AABB currentAABB = node->BoundingBox;
-
-    if (otherAABB.Center.y - otherAABB.Extents.y > currentAABB.Center.y + currentAABB.Extents.y)
-        return;
+    return MathHelper::AABB(vec3(node->BoundingBox.Center.x, Terrain::WATER_LEVEL, node->BoundingBox.Center.z),
+                            node->BoundingBox.Extents.x, WATER_WAVES_EXTENT, node->BoundingBox.Extents.z);
+}
 
-    if (node->IsLeaf)
-    {
-        m_waterDrawZonesRanges[m_waterZoneRangesIndex++] = node->ZoneRange;
-        if (m_renderDebug)
-            DebugHelper::GetInstance()->AddRectangleInstance(node->BoundingBox.Center, node->BoundingBox.Extents);
-    }
-    else
-    {
-        for (int i = 0; i < Node::CHILDREN_COUNT; i++)
-            FillWaterZoneRanges(frustum, node->Children[i]);
-    }
+float Chunk::GetLodRange(int lodLevel) const
+{
+    return LOD_BASE_RANGE * (float)(1 << lodLevel);
 }
 
-void Chunk::UpdateWaterZoneRangesBuffer()
+// The vertices start morphing at MORPH_START_RATIO of the level's range and reach the coarser
+// grid at the end of it, where the coarser level takes over. The root has no coarser level.
+vec2 Chunk::GetMorphRange(int lodLevel) const
 {
-    glBindBuffer(GL_ARRAY_BUFFER, m_waterInstanceVbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vec4) * m_waterZoneRangesIndex, m_waterDrawZonesRanges, GL_DYNAMIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (lodLevel >= QUAD_TREE_DEPTH - 1)
+        return vec2(numeric_limits<float>::max() / 2.0f, numeric_limits<float>::max());
+
+    float rangeStart = lodLevel > 0 ? GetLodRange(lodLevel - 1) : 0.0f;
+    float rangeEnd   = GetLodRange(lodLevel);
+
+    return vec2(rangeStart + (rangeEnd - rangeStart) * MORPH_START_RATIO, rangeEnd);
 }
 
-void Chunk::FillFolliageInstances(Camera* camera, const MathHelper::Frustum& frustum, Node* node)
+void Chunk::FillFolliageInstances(ChunkView& view, const Camera::Snapshot& camera, Node* node)
 {
-    if (!node->BoundingBox.IsOnFrustum(frustum))
+    if (!node->BoundingBox.IsOnFrustum(camera.Frustum))
         return;
 
-    if (node->IsLeaf)
+    if (node->Depth == FOLLIAGE_TREE_DEPTH - 1)
     {
-        for (auto& biomeModel : node->DesiredInstances)
+        for (auto& biomeModel : GetFolliageCell(node).DesiredInstances)
         {
-            vec3 cameraPosition = camera->GetPosition();
+            vec3 cameraPosition = camera.Position;
 
             for (auto& folliageProperties : biomeModel.second)
             {
@@ -943,7 +1317,7 @@ void Chunk::FillFolliageInstances(Camera* camera, const MathHelper::Frustum& fru
                 float   dist           = distance(vec2(translation.x,    translation.z), 
                                                   vec2(cameraPosition.x, cameraPosition.z));
 
-                float   distPercentage = dist / camera->GetFar();
+                float   distPercentage = dist / camera.Far;
 
                 auto&   modelLODs      = biomeModel.first.ModelLODs;
                 int     lodsCount      = modelLODs.size();
@@ -981,16 +1355,13 @@ void Chunk::FillFolliageInstances(Camera* camera, const MathHelper::Frustum& fru
 
                 auto  mapKey      = make_pair(lod.Model, lod.Shader);
 
-                if (m_folliageModelsInstances.find(mapKey) == m_folliageModelsInstances.end())
-                    m_folliageModelsInstances[mapKey] = vector<mat4>();
-
-                m_folliageModelsInstances[mapKey].push_back(modelMatrix);
+                view.FolliageModelsInstances[mapKey].Transforms.push_back(modelMatrix);
             }
         }
     }
     else
     {
         for (int i = 0; i < Node::CHILDREN_COUNT; i++)
-            FillFolliageInstances(camera, frustum, node->Children[i]);
+            FillFolliageInstances(view, camera, node->Children[i]);
     }
 }
\ No newline at end of file
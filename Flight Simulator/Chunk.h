@@ -10,11 +10,13 @@
 #include "Camera.h"
 #include "Light.h"
 #include "Material.h"
+#include "MaterialArray.h"
 #include "MathHelper.h"
 #include "Model.h"
 #include "Biome.h"
 #include "HydraulicErosion.h"
 #include "GaussianBlur.h"
+#include "FrameArena.h"
 
 class Chunk
 {
@@ -26,6 +28,13 @@ private:
         float     Scale;
     };
 
+    struct TerrainZone
+    {
+        glm::vec4 ZoneRange;
+        glm::vec2 MorphRange; // the camera distances between which the vertices morph to the coarser level
+    };
+
+    // The nodes of a chunk are allocated together, in one block of NODES_COUNT, and point into it.
     struct Node
     {
     public:
@@ -35,56 +44,162 @@ private:
     public:
 
         Node();
-        ~Node();
 
     public:
 
-        Node*                                                                                               Children[CHILDREN_COUNT];
-        bool                                                                                                IsLeaf;
-        glm::vec4                                                                                           ZoneRange;
-                                                                                                            
-        Vec2Int                                                                                             PositionId;
-                                                                                                            
-        MathHelper::AABB                                                                                    BoundingBox;
+        Node*            Children[CHILDREN_COUNT];
+        bool             IsLeaf;
+        int              Depth;
+        glm::vec4        ZoneRange;
+                         
+        Vec2Int          PositionId;
+                         
+        MathHelper::AABB BoundingBox;
+        float            HeightError; // the height difference under the node, from the min/max pyramid
+
+        bool             HasWater;    // the terrain goes below the top of the waves somewhere under the node
+    };
+
+    // The folliage placed under a node of the FOLLIAGE_TREE_DEPTH level, kept apart from the nodes
+    // so the other levels don't carry it.
+    struct FolliageCell
+    {
+    public:
 
         std::unordered_map<Biome::FolliageModel, std::vector<FolliageProperties>, Biome::HashFolliageModel> DesiredInstances;
+    };
+
+    // The transforms of a folliage model in a view, and where FinishView wrote them in the
+    // StreamingBuffer.
+    struct FolliageInstances
+    {
+    public:
+
+        FrameVector<glm::mat4> Transforms;    // lives in the frame arena
+        int                    BaseInstance;
+        size_t                 PreviousCount; // of the previous frame, reserved up front
+    };
+
+    // What a view of the frame (a camera) draws from the chunk. The views are prepared on the
+    // worker threads, each into its own ChunkView, and drawn on the main thread.
+    struct ChunkView
+    {
+    public:
+
+        TerrainZone*                                                                                 DrawZonesRanges;
+        glm::vec4*                                                                                   WaterDrawZonesRanges;
+        int                                                                                          ZoneRangesIndex;
+        int                                                                                          WaterZoneRangesIndex;
+        int                                                                                          ZonesBaseInstance;      // in the StreamingBuffer, set by FinishView
+        int                                                                                          WaterZonesBaseInstance;
+
+        std::unordered_map<std::pair<Model*, Shader*>, FolliageInstances, HashHelper::HashPair>      FolliageModelsInstances;
 
-        Node*                                                                                               LinkedNode;
+        bool                                                                                         RenderDebug;
+        std::vector<MathHelper::AABB>                                                                DebugRectangles;
     };
 
 public:
 
+    // The construction stages, in order. The terrain and the water can be drawn after the
+    // QuadTree stage, the folliage only when the chunk is Ready.
+    enum class BuildStage
+    {
+        Buffers,
+        HeightNoise,
+        Erosion,
+        Blur,
+        BiomeNoise,
+        MinMaxValues,
+        QuadTree,
+        HeightBiomeValues,
+        Quantize,
+        FolliageNoise,
+        Folliage,
+        Ready
+    };
+
+    static const int   BUILD_STAGES_COUNT = (int)BuildStage::Ready;
+
+    // The stages that generate the textures of a Ready chunk again, at a higher resolution. The
+    // chunk is drawn with the old textures until the Swap stage.
+    enum class UpgradeStage
+    {
+        HeightNoise,
+        Erosion,
+        Blur,
+        BiomeNoise,
+        Downscale,
+        Swap
+    };
+
+    static const int   UPGRADE_STAGES_COUNT = (int)UpgradeStage::Swap + 1;
+
+    static const int   VIEWS_COUNT        = 2;
+
     static const float CHUNK_CLOSE_BIAS;
 
+    // The height and biome textures are MAX_TEXTURE_SIZE wide near the camera, their size is
+    // halved every time the distance doubles past TEXTURE_SIZE_HALVING_DISTANCE.
+    static const int   MAX_TEXTURE_SIZE   = 1024;
+    static const int   MIN_TEXTURE_SIZE   = 256;
+    static const float TEXTURE_SIZE_HALVING_DISTANCE;
+
 private:
            const float FOLLIAGE_HEIGHT_BIAS  = 10.0f;
+           const float WATER_WAVES_EXTENT    = 3.0f;
 
            const float TEX_COORDS_MULTIPLIER = 0.2f;
 
-           const int   NOISE_TEXTURE_SIZE    = 1024;
+           const float LOD_BASE_RANGE        = 16.0f; // the leaves are drawn up to this distance, doubled for every coarser level
+           const float MORPH_START_RATIO     = 0.7f;
+           const float FLAT_NODE_ERROR       = 0.1f;  // the nodes flatter than this aren't subdivided
 
     static const int   CHUNK_GRID_WIDTH      = 8;
     static const int   CHUNK_GRID_HEIGHT     = 8;
 
-    static const int   QUAD_TREE_DEPTH       = 4;
+    static const int   QUAD_TREE_DEPTH       = 6;
+    static const int   FOLLIAGE_TREE_DEPTH   = 4;
+    static const int   WATER_TREE_DEPTH      = 4;
     static const int   HEIGHT_BIOME_DEPTH    = 8;
 
     static const int   INDICES_COUNT         = CHUNK_GRID_WIDTH * CHUNK_GRID_HEIGHT * 6;
+    static const int   ZONES_BINDING         = 2; // the vertex buffer binding of the zones, after the vertex attributes
+
+    static const int   NODES_COUNT           = ((1 << (2 * QUAD_TREE_DEPTH)) - 1) / 3; // all the levels of a full quadtree
+    static const int   FOLLIAGE_CELLS_WIDTH  = 1 << (FOLLIAGE_TREE_DEPTH - 1);
 
 public:
 
-    Chunk(PerlinNoise*, HydraulicErosion*, GaussianBlur*, std::pair<int, int>);
+    Chunk(PerlinNoise*, HydraulicErosion*, GaussianBlur*, std::pair<int, int>, int);
     ~Chunk();
 
-           void      Update(Camera*, float, bool, bool);
-           void      UpdateWater(Camera*, float, bool);
-           void      DrawTerrain(Camera*, Light*, const std::vector<Material*>&, Texture*);
-           void      DrawFolliage(Camera*, Light*);
-           void      DrawWater(Camera*, Light*, Texture*, Texture*, Texture*, Texture*, float, Material*, float);
+           bool       BuildStep(); // returns true when the chunk is complete
+           BuildStage GetBuildStage() const;
+           bool       IsDrawable()    const;
+
+           // Only Ready chunks are upgraded, towards the largest size they were asked for. Must not
+           // run while a view of the chunk is being prepared.
+           void         SetTargetTextureSize(int);
+           bool         NeedsUpgrade()    const;
+           bool         UpgradeStep(); // returns true when the new textures are drawn
+           UpgradeStage GetUpgradeStage() const;
+
+           // Thread safe as long as the views prepared at the same time are different.
+           void      PrepareView(int, const Camera::Snapshot&, bool, bool, bool);
+           void      FinishView(int);
+
+           void      DrawTerrain(Shader*, int);
+           void      DrawFolliage(Camera*, Light*, int);
+           void      DrawWater(Shader*, int);
 
            glm::vec3 GetTranslation() const;
 
     static glm::vec3 GetPositionForChunkId(Vec2Int);
+    static int       GetTextureSizeForDistance(float);
+
+    static void      SetTerrainShaderParameters(Shader*, Camera*, Light*, MaterialArray*, Texture*);
+    static void      SetWaterShaderParameters(Shader*, Camera*, Light*, Texture*, Texture*, Texture*, Texture*, float, MaterialArray*, float);
 
 
 private:
@@ -94,20 +209,26 @@ private:
 
           void  CreateWaterBuffers();
           void  FreeWaterBuffers();
+
+          Texture* RenderHeightNoise(int);
+          Texture* RenderBiomeNoise(int);
+          void     SetQuantizedTextures(Texture*, Texture*, float, float);
                         
-          void  BuildQuadTree(std::pair<float**, float**>, std::pair<float**, float**>, std::pair<float**, float**>);
-          Node* CreateNode(int, const glm::vec2&, const glm::vec2&, std::pair<int, int>, std::pair<float**, float**>, std::pair<float**, float**>, std::pair<float**, float**>);
+          void  BuildQuadTree();
+          void  FindHeightRange();
+          Node* CreateNode(int, const glm::vec2&, const glm::vec2&, std::pair<int, int>);
+          void  FillDesiredInstances(Node*, std::vector<glm::vec3>&);
           
-          void  BuildWaterQuadTree();
-          Node* CreateWaterNode(int, Node*);
-
-          void  FillZoneRanges(const MathHelper::Frustum&, Node*);
-          void  UpdateZoneRangesBuffer();
+          void  FillZoneRanges(ChunkView&, const MathHelper::Frustum&, const glm::vec3&, Node*, bool, bool);
 
-          void  FillWaterZoneRanges(const MathHelper::Frustum&, Node*);
-          void  UpdateWaterZoneRangesBuffer();
+          FolliageCell&    GetFolliageCell(Node*)     const;
+          MathHelper::AABB GetWaterBoundingBox(Node*) const;
+          float            GetLodRange(int)           const;
+          glm::vec2        GetMorphRange(int)         const;
                         
-          void  FillFolliageInstances(Camera*, const MathHelper::Frustum&, Node*);
+          void  FillFolliageInstances(ChunkView&, const Camera::Snapshot&, Node*);
+
+    static void FreeValues(float**&, int);
 
     template<typename T>
     const T&    RouletteWheelSelection(const std::vector<T>& models, float r)
@@ -143,30 +264,48 @@ private:
     Vec2Int                                                                                      m_chunkID;
                                                                                                  
     unsigned int                                                                                 m_vbo;
-    unsigned int                                                                                 m_instanceVbo;
     unsigned int                                                                                 m_ebo;
     unsigned int                                                                                 m_vao;
 
     unsigned int                                                                                 m_waterVbo;
-    unsigned int                                                                                 m_waterInstanceVbo;
     unsigned int                                                                                 m_waterEbo;
     unsigned int                                                                                 m_waterVao;
                                                                                                  
     PerlinNoise*                                                                                 m_perlinNoise;
     HydraulicErosion*                                                                            m_hydraulicErosion;
+    GaussianBlur*                                                                                m_gaussianBlur;
+
+    BuildStage                                                                                   m_buildStage;
 
+    // R32F while the chunk is generated, R16 and R8 from the Quantize stage on. The shaders decode
+    // the heights as value * m_heightScale + m_heightBias.
     Texture*                                                                                     m_heightTexture;
     Texture*                                                                                     m_biomesTexture;
-    glm::vec4*                                                                                   m_drawZonesRanges; 
-    glm::vec4*                                                                                   m_waterDrawZonesRanges;
-
-    std::unordered_map<std::pair<Model*, Shader*>, std::vector<glm::mat4>, HashHelper::HashPair> m_folliageModelsInstances;
-                                                       
-    int                                                                                          m_zoneRangesIndex;
-    int                                                                                          m_waterZoneRangesIndex;
+    int                                                                                          m_textureSize;
+    int                                                                                          m_targetTextureSize;
+    float                                                                                        m_heightScale;
+    float                                                                                        m_heightBias;
+    float                                                                                        m_minHeight;         // of the whole chunk, found by the MinMaxValues stage
+    float                                                                                        m_maxHeight;
+
+    // The R32F textures generated by the upgrade stages, at m_targetTextureSize.
+    UpgradeStage                                                                                 m_upgradeStage;
+    int                                                                                          m_upgradeTextureSize;
+    Texture*                                                                                     m_upgradeHeightTexture;
+    Texture*                                                                                     m_upgradeBiomesTexture;
+
+    // The downscaled values read back by a stage and used by the next ones.
+    float**                                                                                      m_minValues;
+    float**                                                                                      m_maxValues;
+    float**                                                                                      m_heightValues;
+    float**                                                                                      m_biomeValues;
+    float**                                                                                      m_folliageRandomnessValues;
+    float**                                                                                      m_folliageSelectionRandomnessValues;
+
+    ChunkView                                                                                    m_views[VIEWS_COUNT];
                                                                                                  
+    Node*                                                                                        m_nodes;             // m_nodes[0] is the root
+    int                                                                                          m_nodesCount;
     Node*                                                                                        m_quadTree;
-    Node*                                                                                        m_waterQuadTree;
-                                                                                                 
-    bool                                                                                         m_renderDebug;
+    FolliageCell*                                                                                m_folliageCells;
 };
\ No newline at end of file
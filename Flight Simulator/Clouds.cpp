@@ -2,9 +2,18 @@
 #include "DebugHelper.h"
 #include "ShaderManager.h"
 #include "Terrain.h"
+#include "StartupProfiler.h"
+#include "RenderSettings.h"
+#include "glad/glad.h"
 
+using namespace std;
 using namespace glm;
 
+const float        Clouds::HISTORY_WEIGHT      = 0.9f;
+const unsigned int Clouds::NOISE_SEED          = 1337;
+const vec4         Clouds::SHAPE_NOISE_WEIGHTS = vec4(1.0f, 0.5f, 0.25f, 0.0f);
+const float        Clouds::DENSITY_OFFSET      = -3.64f * 0.2f;
+
 Clouds::Clouds(CloudsProperties cloudsProperties)
 {
 	m_cloudsProperties = cloudsProperties;
@@ -12,13 +21,26 @@ Clouds::Clouds(CloudsProperties cloudsProperties)
 	m_worleyNoise = new WorleyNoise();
 	m_perlinNoise = new PerlinNoise();
 
-	m_worleyNoiseTexture = m_worleyNoise->RenderNoise({ 128, 3, 0.5f, 2, 3, 4, vec4(1.0f, 0.0f, 0.0f, 1.0f) });
-	m_worleyNoise->RenderNoise({ 128, 3, 0.5f, 3, 5, 9, vec4(0.0f, 1.0f, 0.0f, 0.0f) }, m_worleyNoiseTexture);
-	m_worleyNoise->RenderNoise({ 128, 3, 0.5f, 1, 2, 3, vec4(0.0f, 0.0f, 1.0f, 0.0f) }, m_worleyNoiseTexture);
+	StartupProfiler* startupProfiler = StartupProfiler::GetInstance();
+
+	startupProfiler->BeginPhase("Worley noise generation");
+
+	vec4 maxShapeNoise;
+
+	m_worleyNoiseTexture = m_worleyNoise->GenerateNoise({ { 128, 3, 0.5f, 2, 3, 4,  vec4(1.0f, 0.0f, 0.0f, 1.0f) },
+	                                                      { 128, 3, 0.5f, 3, 5, 9,  vec4(0.0f, 1.0f, 0.0f, 0.0f) },
+	                                                      { 128, 3, 0.5f, 1, 2, 3,  vec4(0.0f, 0.0f, 1.0f, 0.0f) } },
+	                                                    NOISE_SEED, "CloudsShapeNoise.cache", &maxShapeNoise);
+
+	// The weights are positive, so this bounds the weighted shape noise everywhere.
+	m_maxShapeNoise = dot(maxShapeNoise, SHAPE_NOISE_WEIGHTS / dot(SHAPE_NOISE_WEIGHTS, vec4(1.0f, 1.0f, 1.0f, 1.0f)));
+
+	m_detailNoiseTexture = m_worleyNoise->GenerateNoise({ { 32,  3, 0.5f, 2, 4, 8,  vec4(1.0f, 0.0f, 0.0f, 1.0f) },
+	                                                      { 32,  3, 0.5f, 3, 5, 9,  vec4(0.0f, 1.0f, 0.0f, 0.0f) },
+	                                                      { 32,  3, 0.5f, 8, 9, 10, vec4(0.0f, 0.0f, 1.0f, 0.0f) } },
+	                                                    NOISE_SEED + 1, "CloudsDetailNoise.cache");
 
-	m_detailNoiseTexture = m_worleyNoise->RenderNoise({ 32, 3, 0.5f, 2, 4, 8, vec4(1.0f, 0.0f, 0.0f, 1.0f) });
-	m_worleyNoise->RenderNoise({ 32, 3, 0.5f, 3, 5, 9, vec4(0.0f, 1.0f, 0.0f, 0.0f) }, m_detailNoiseTexture);
-	m_worleyNoise->RenderNoise({ 32, 3, 0.5f, 8, 9, 10, vec4(0.0f, 0.0f, 1.0f, 0.0f) }, m_detailNoiseTexture);
+	startupProfiler->EndPhase();
 
 	PerlinNoise::NoiseParameters noiseParameters;
 
@@ -33,11 +55,51 @@ Clouds::Clouds(CloudsProperties cloudsProperties)
 	m_cloudsOffset  = vec3(0.0f, 0.0f, 0.0f);
 	m_detailsOffset = vec3(0.0f, 0.0f, 0.0f);
 
+	startupProfiler->BeginPhase("Simplex weather map generation");
 	m_weatherMap = m_perlinNoise->RenderSimplexNoise(noiseParameters, true);
+	startupProfiler->EndPhase();
+
+	// The light volumes are indexed (x, y, z) like the world, with the slices along z.
+	for (int i = 0; i < 2; i++)
+		m_lightVolumes[i] = new Texture3D(LIGHT_VOLUME_WIDTH, LIGHT_VOLUME_HEIGHT, LIGHT_VOLUME_WIDTH,
+		                                  Texture::Format::R32F, Texture::Format::RED);
+
+	m_currentLightVolume = 0;
+	m_bakedSlicesCount   = 0;
+	m_lightVolumeValid   = false;
+	m_lightVolumeMin     = vec3(0.0f, 0.0f, 0.0f);
+	m_lightVolumeMax     = vec3(1.0f, 1.0f, 1.0f);
+
+	m_occupancyGrid      = new Texture3D(OCCUPANCY_GRID_WIDTH, OCCUPANCY_GRID_HEIGHT, OCCUPANCY_GRID_WIDTH,
+		                                 Texture::Format::R32F, Texture::Format::RED, Texture::Filter::Point);
+
+	m_occupancyGridValid = false;
+	m_occupancyGridMin   = vec3(0.0f, 0.0f, 0.0f);
+	m_occupancyGridMax   = vec3(1.0f, 1.0f, 1.0f);
 }
 
 Clouds::~Clouds()
 {
+	for (auto& history : m_histories)
+		FreeHistory(history.second);
+
+	m_histories.clear();
+
+	if (m_occupancyGrid)
+	{
+		delete m_occupancyGrid;
+		m_occupancyGrid = nullptr;
+	}
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (m_lightVolumes[i])
+		{
+			delete m_lightVolumes[i];
+			m_lightVolumes[i] = nullptr;
+		}
+	}
+
 	if (m_weatherMap)
 	{
 		delete m_weatherMap;
@@ -75,57 +137,194 @@ void Clouds::Update(float deltaTime)
 	UpdateOffset(m_detailsOffset, m_cloudsProperties.DetailsOffsetVelocity, deltaTime);
 }
 
+// Bakes the light volume of the box around the camera into the back volume, a few slices per frame.
+// When all the slices are done the volumes are swapped, so the raymarch never sees a partial bake,
+// and the next bake starts right away to follow the drifting noise and the light direction.
+void Clouds::UpdateLightVolume(Camera* camera, Light* light)
+{
+	ShaderManager* shaderManager     = ShaderManager::GetInstance();
+	Shader*        lightVolumeShader = shaderManager->GetCloudsLightVolumeShader();
+
+	if (m_bakedSlicesCount == 0)
+	{
+		// The volume moves with the camera in whole voxels, so the bakes line up.
+		vec3 voxelSize = vec3(2.0f * m_cloudsProperties.CloudBoxExtents.x / LIGHT_VOLUME_WIDTH, 1.0f,
+		                      2.0f * m_cloudsProperties.CloudBoxExtents.y / LIGHT_VOLUME_WIDTH);
+
+		vec3 center    = floor(camera->GetPosition() / voxelSize) * voxelSize;
+
+		GetCloudsBounds(center, m_bakingVolumeMin, m_bakingVolumeMax);
+	}
+
+	int slicesCount = m_lightVolumeValid ? LIGHT_VOLUME_SLICES_PER_FRAME : LIGHT_VOLUME_WIDTH;
+	    slicesCount = min(slicesCount, LIGHT_VOLUME_WIDTH - m_bakedSlicesCount);
+
+	lightVolumeShader->Use();
+
+	SetDensityParameters(lightVolumeShader, light, m_bakingVolumeMin, m_bakingVolumeMax);
+
+	lightVolumeShader->SetImage3D("ImgOutput", m_lightVolumes[1 - m_currentLightVolume], 0, Texture::Format::R32F);
+	lightVolumeShader->SetInt("FirstSlice",    m_bakedSlicesCount);
+
+	glDispatchCompute(Texture::GetComputeShaderGroupsCount(LIGHT_VOLUME_WIDTH,  COMPUTE_SHADER_BLOCKS_COUNT),
+		              Texture::GetComputeShaderGroupsCount(LIGHT_VOLUME_HEIGHT, COMPUTE_SHADER_BLOCKS_COUNT),
+		              slicesCount);
+
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	m_bakedSlicesCount += slicesCount;
+
+	if (m_bakedSlicesCount >= LIGHT_VOLUME_WIDTH)
+	{
+		m_currentLightVolume = 1 - m_currentLightVolume;
+		m_lightVolumeMin     = m_bakingVolumeMin;
+		m_lightVolumeMax     = m_bakingVolumeMax;
+		m_lightVolumeValid   = true;
+		m_bakedSlicesCount   = 0;
+	}
+}
+
+// The grid only depends on the weather map and the largest shape noise value, so it's rebuilt
+// when the camera moves into another column of cells, not when the noise drifts.
+void Clouds::UpdateOccupancyGrid(Camera* camera)
+{
+	vec3 cellSize = vec3(2.0f * m_cloudsProperties.CloudBoxExtents.x / OCCUPANCY_GRID_WIDTH, 1.0f,
+	                     2.0f * m_cloudsProperties.CloudBoxExtents.y / OCCUPANCY_GRID_WIDTH);
+
+	vec3 boundsMin, boundsMax;
+	GetCloudsBounds(floor(camera->GetPosition() / cellSize) * cellSize, boundsMin, boundsMax);
+
+	if (m_occupancyGridValid && boundsMin == m_occupancyGridMin && boundsMax == m_occupancyGridMax)
+		return;
+
+	ShaderManager* shaderManager   = ShaderManager::GetInstance();
+	Shader*        occupancyShader = shaderManager->GetCloudsOccupancyShader();
+
+	occupancyShader->Use();
+
+	occupancyShader->SetImage3D("ImgOutput",    m_occupancyGrid, 0, Texture::Format::R32F);
+	occupancyShader->SetTexture("WeatherMap",   m_weatherMap,    1);
+
+	occupancyShader->SetVec3("BoundsMin",       boundsMin);
+	occupancyShader->SetVec3("BoundsMax",       boundsMax);
+	occupancyShader->SetFloat("MaxShapeNoise",  m_maxShapeNoise);
+	occupancyShader->SetFloat("DensityOffset",  DENSITY_OFFSET);
+
+	glDispatchCompute(Texture::GetComputeShaderGroupsCount(OCCUPANCY_GRID_WIDTH, COMPUTE_SHADER_BLOCKS_COUNT),
+		              1,
+		              Texture::GetComputeShaderGroupsCount(OCCUPANCY_GRID_WIDTH, COMPUTE_SHADER_BLOCKS_COUNT));
+
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	m_occupancyGridMin   = boundsMin;
+	m_occupancyGridMax   = boundsMax;
+	m_occupancyGridValid = true;
+}
+
+void Clouds::Render(Camera* camera, Light* light, Texture* depthTexture)
+{
+	int downscale = GetDownscale();
+
+	if (downscale == 1)
+		return;
+
+	ShaderManager* shaderManager  = ShaderManager::GetInstance();
+	Shader*        cloudsShader   = shaderManager->GetCloudsShader();
+	Shader*        temporalShader = shaderManager->GetCloudsTemporalShader();
+
+	CloudsHistory& history        = GetHistory(camera, depthTexture->GetWidth(), depthTexture->GetHeight(), downscale);
+	vec2           texelSize      = vec2(1.0f / history.Width, 1.0f / history.Height);
+
+	history.RaymarchRenderTexture->Begin();
+
+	cloudsShader->Use();
+
+	SetRaymarchParameters(cloudsShader, camera, light);
+
+	cloudsShader->SetTexture("DepthTexture",              depthTexture,         1);
+	cloudsShader->SetBool("OutputCloudsData",             true);
+	cloudsShader->SetVec2("SampleOffset",                 GetSampleOffset(history.FramesCount, downscale) * texelSize);
+
+	DebugHelper::GetInstance()->FullScreenQuadDrawCall();
+
+	RenderTexture* previousHistory = history.HistoryRenderTextures[history.CurrentHistory];
+	history.CurrentHistory         = 1 - history.CurrentHistory;
+	RenderTexture* currentHistory  = history.HistoryRenderTextures[history.CurrentHistory];
+
+	currentHistory->Begin();
+
+	temporalShader->Use();
+
+	temporalShader->SetTexture("CurrentTexture",          history.RaymarchRenderTexture->GetTexture(), 0);
+	temporalShader->SetTexture("HistoryTexture",          previousHistory->GetTexture(),               1);
+
+	mat4 cameraMatrix = camera->GetModelMatrix();
+
+	temporalShader->SetMatrix4("CameraMatrix",            cameraMatrix);
+	temporalShader->SetMatrix4("PreviousViewProjection",  history.PreviousViewProjection);
+	temporalShader->SetFloat("AspectRatio",               camera->GetAspectRatio());
+	temporalShader->SetFloat("Near",                      camera->GetNear());
+	temporalShader->SetFloat("FovY",                      camera->GetFieldOfViewY());
+
+	temporalShader->SetVec2("TexelSize",                  texelSize);
+	temporalShader->SetFloat("HistoryWeight",             HISTORY_WEIGHT);
+	temporalShader->SetBool("HistoryValid",               history.FramesCount > 0);
+
+	DebugHelper::GetInstance()->FullScreenQuadDrawCall();
+
+	history.PreviousViewProjection = camera->GetProjectionMatrix() * camera->GetViewMatrix();
+	history.FramesCount++;
+}
+
 void Clouds::Draw(Camera* camera, Light* light, Texture* sceneTexture, Texture* depthTexture, bool useGammaCorrection)
 {
 	ShaderManager* shaderManager = ShaderManager::GetInstance();
-	Shader*        cloudsShader  = shaderManager->GetCloudsShader();
+
+	auto it = m_histories.find(camera);
+
+	if (GetDownscale() != 1 && it != m_histories.end() && it->second.FramesCount > 0)
+	{
+		CloudsHistory& history         = it->second;
+		Shader*        compositeShader = shaderManager->GetCloudsCompositeShader();
+
+		compositeShader->Use();
+
+		compositeShader->SetTexture("SceneTexture",           sceneTexture,                                                          0);
+		compositeShader->SetTexture("DepthTexture",           depthTexture,                                                          1);
+		compositeShader->SetTexture("CloudsTexture",          history.HistoryRenderTextures[history.CurrentHistory]->GetTexture(), 2);
+
+		mat4 cameraMatrix = camera->GetModelMatrix();
+
+		compositeShader->SetMatrix4("CameraMatrix",           cameraMatrix);
+		compositeShader->SetFloat("AspectRatio",              camera->GetAspectRatio());
+		compositeShader->SetFloat("Near",                     camera->GetNear());
+		compositeShader->SetFloat("Far",                      camera->GetFar());
+		TerrainClipmap::SetDepthRangeParameters(compositeShader, camera);
+		compositeShader->SetFloat("FovY",                     camera->GetFieldOfViewY());
+
+		compositeShader->SetVec2("CloudsTexelSize",           vec2(1.0f / history.Width, 1.0f / history.Height));
+
+		compositeShader->SetVec4("DiffuseColor",              light->GetDiffuseColor());
+		compositeShader->SetVec3("LightDirection",            light->GetLightDirection());
+		compositeShader->SetInt("FocusedEyeSunExponent",      1);
+
+		compositeShader->SetBool("UseGammaCorrection",        useGammaCorrection);
+
+		DebugHelper::GetInstance()->FullScreenQuadDrawCall();
+
+		return;
+	}
+
+	Shader* cloudsShader = shaderManager->GetCloudsShader();
 
 	cloudsShader->Use();
 
+	SetRaymarchParameters(cloudsShader, camera, light);
+
 	cloudsShader->SetTexture("SceneTexture",              sceneTexture,         0);
 	cloudsShader->SetTexture("DepthTexture",              depthTexture,         1);
-	cloudsShader->SetTexture3D("CloudsDensityTexture",    m_worleyNoiseTexture, 2);
-	cloudsShader->SetTexture3D("DetailNoiseTexture",      m_detailNoiseTexture, 3);
-	cloudsShader->SetTexture("WeatherMap",                m_weatherMap,         4);
-													      
-	mat4 cameraMatrix = camera->GetModelMatrix();	      
-													      
-	cloudsShader->SetMatrix4("CameraMatrix",              cameraMatrix);
-	cloudsShader->SetFloat("AspectRatio",                 camera->GetAspectRatio());
-	cloudsShader->SetFloat("Near",                        camera->GetNear());
-	cloudsShader->SetFloat("Far",                         camera->GetFar());
-	cloudsShader->SetFloat("FovY",                        camera->GetFieldOfViewY());
-	
-	vec3 position = camera->GetPosition();
-	position = vec3(position.x, 0.0f, position.z);
-	vec3 extent = vec3(m_cloudsProperties.CloudBoxExtents.x, 0.0f, m_cloudsProperties.CloudBoxExtents.y);
-
-	vec3 boundsMin = position - extent + vec3(0.0f, Terrain::WATER_LEVEL,              0.0f);
-	vec3 boundsMax = position + extent + vec3(0.0f, m_cloudsProperties.CloudsAltitude, 0.0f);
-												          
-	cloudsShader->SetVec3("BoundsMin",                    boundsMin);
-	cloudsShader->SetVec3("BoundsMax",                    boundsMax);
-												          
-	cloudsShader->SetVec3("CloudScale",                   0.006f * vec3(1.0f, 1.0f, 1.0f));
-	cloudsShader->SetFloat("DetailNoiseScale",            4.0f);
-	cloudsShader->SetVec3("CloudOffset",                  m_cloudsOffset);
-	cloudsShader->SetVec3("DetailsOffset",                m_detailsOffset);
-	cloudsShader->SetFloat("DensityMultiplier",           0.5f * 0.82f);
-	cloudsShader->SetFloat("DarknessThreshold",           0.38f);
-	cloudsShader->SetFloat("DensityOffset",               -3.64 * 0.2f);
-	cloudsShader->SetVec4("PhaseParams",                  vec4(0.72f, 0.33f, 1.0f, 0.83f));
-	cloudsShader->SetInt("FocusedEyeSunExponent",         1);
-	cloudsShader->SetVec4("ShapeNoiseWeights",            vec4(1.0f, 0.5f, 0.25f, 0.0f));
-	cloudsShader->SetVec4("DetailNoiseWeights",           vec4(0.25f, 1.0f, 0.5f, 0.0f));
-	cloudsShader->SetFloat("LightAbsorbtionTowardSun",    1.0);
-	cloudsShader->SetFloat("LightAbsorptionThroughCloud", 2.05);
-	cloudsShader->SetFloat("DetailNoiseWeight",           20.0f);
-	cloudsShader->SetFloat("RayMarchStepSize",            11.0f);
-
-	cloudsShader->SetVec4("DiffuseColor",                 light->GetDiffuseColor());
-	cloudsShader->SetVec3("LightDirection",               light->GetLightDirection());
-												          
-	cloudsShader->SetInt("LightStepsCount",               10);
+	cloudsShader->SetBool("OutputCloudsData",             false);
+	cloudsShader->SetVec2("SampleOffset",                 vec2(0.0f, 0.0f));
 
 	cloudsShader->SetBool("UseGammaCorrection",           useGammaCorrection);
 	
@@ -154,3 +353,170 @@ void Clouds::UpdateOffset(vec3& offset, vec3& offsetVelocity, float deltaTime)
 		offset = vec3(x, y, z);
 	}
 }
+
+
+void Clouds::SetRaymarchParameters(Shader* cloudsShader, Camera* camera, Light* light)
+{
+	vec3 boundsMin, boundsMax;
+	GetCloudsBounds(camera->GetPosition(), boundsMin, boundsMax);
+
+	// The edge fade and the light march depend on the box, the raymarch uses the one the light
+	// volume was baked with, so the baked transmittance matches the raymarched density.
+	if (m_lightVolumeValid)
+	{
+		boundsMin = m_lightVolumeMin;
+		boundsMax = m_lightVolumeMax;
+	}
+
+	SetDensityParameters(cloudsShader, light, boundsMin, boundsMax);
+													      
+	mat4 cameraMatrix = camera->GetModelMatrix();	      
+													      
+	cloudsShader->SetMatrix4("CameraMatrix",              cameraMatrix);
+	cloudsShader->SetFloat("AspectRatio",                 camera->GetAspectRatio());
+	cloudsShader->SetFloat("Near",                        camera->GetNear());
+	cloudsShader->SetFloat("Far",                         camera->GetFar());
+	TerrainClipmap::SetDepthRangeParameters(cloudsShader, camera);
+	cloudsShader->SetFloat("FovY",                        camera->GetFieldOfViewY());
+
+	cloudsShader->SetVec4("PhaseParams",                  vec4(0.72f, 0.33f, 1.0f, 0.83f));
+	cloudsShader->SetInt("FocusedEyeSunExponent",         1);
+	cloudsShader->SetFloat("LightAbsorptionThroughCloud", 2.05);
+	cloudsShader->SetFloat("RayMarchStepSize",            11.0f);
+
+	cloudsShader->SetVec4("DiffuseColor",                 light->GetDiffuseColor());
+
+	cloudsShader->SetTexture3D("LightVolume",             m_lightVolumes[m_currentLightVolume], 5);
+	cloudsShader->SetVec3("LightVolumeMin",               m_lightVolumeMin);
+	cloudsShader->SetVec3("LightVolumeMax",               m_lightVolumeMax);
+	cloudsShader->SetBool("UseLightVolume",               m_lightVolumeValid);
+
+	cloudsShader->SetTexture3D("OccupancyGrid",           m_occupancyGrid, 6);
+	cloudsShader->SetVec3("OccupancyGridMin",             m_occupancyGridMin);
+	cloudsShader->SetVec3("OccupancyGridMax",             m_occupancyGridMax);
+	cloudsShader->SetBool("UseOccupancyGrid",             m_occupancyGridValid);
+}
+
+// The parameters shared by the raymarch and the light volume bake.
+void Clouds::SetDensityParameters(Shader* shader, Light* light, const vec3& boundsMin, const vec3& boundsMax)
+{
+	shader->SetTexture3D("CloudsDensityTexture",    m_worleyNoiseTexture, 2);
+	shader->SetTexture3D("DetailNoiseTexture",      m_detailNoiseTexture, 3);
+	shader->SetTexture("WeatherMap",                m_weatherMap,         4);
+												          
+	shader->SetVec3("BoundsMin",                    boundsMin);
+	shader->SetVec3("BoundsMax",                    boundsMax);
+												          
+	shader->SetVec3("CloudScale",                   0.006f * vec3(1.0f, 1.0f, 1.0f));
+	shader->SetFloat("DetailNoiseScale",            4.0f);
+	shader->SetVec3("CloudOffset",                  m_cloudsOffset);
+	shader->SetVec3("DetailsOffset",                m_detailsOffset);
+	shader->SetFloat("DensityMultiplier",           0.5f * 0.82f);
+	shader->SetFloat("DarknessThreshold",           0.38f);
+	shader->SetFloat("DensityOffset",               DENSITY_OFFSET);
+	shader->SetVec4("ShapeNoiseWeights",            SHAPE_NOISE_WEIGHTS);
+	shader->SetVec4("DetailNoiseWeights",           vec4(0.25f, 1.0f, 0.5f, 0.0f));
+	shader->SetFloat("LightAbsorbtionTowardSun",    1.0);
+	shader->SetFloat("DetailNoiseWeight",           20.0f);
+
+	shader->SetVec3("LightDirection",               light->GetLightDirection());
+	shader->SetInt("LightStepsCount",               10);
+}
+
+void Clouds::GetCloudsBounds(vec3 center, vec3& boundsMin, vec3& boundsMax)
+{
+	vec3 position = vec3(center.x, 0.0f, center.z);
+	vec3 extent   = vec3(m_cloudsProperties.CloudBoxExtents.x, 0.0f, m_cloudsProperties.CloudBoxExtents.y);
+
+	boundsMin = position - extent + vec3(0.0f, Terrain::WATER_LEVEL,              0.0f);
+	boundsMax = position + extent + vec3(0.0f, m_cloudsProperties.CloudsAltitude, 0.0f);
+}
+
+Clouds::CloudsHistory& Clouds::GetHistory(Camera* camera, int width, int height, int downscale)
+{
+	int historyWidth  = max((width  + downscale - 1) / downscale, 1);
+	int historyHeight = max((height + downscale - 1) / downscale, 1);
+
+	auto it = m_histories.find(camera);
+
+	if (it != m_histories.end())
+	{
+		if (it->second.Width == historyWidth && it->second.Height == historyHeight && it->second.Downscale == downscale)
+			return it->second;
+
+		FreeHistory(it->second);
+	}
+
+	CloudsHistory& history = m_histories[camera];
+
+	history.RaymarchRenderTexture    = new RenderTexture(historyWidth, historyHeight);
+	history.HistoryRenderTextures[0] = new RenderTexture(historyWidth, historyHeight);
+	history.HistoryRenderTextures[1] = new RenderTexture(historyWidth, historyHeight);
+	history.CurrentHistory           = 0;
+	history.Width                    = historyWidth;
+	history.Height                   = historyHeight;
+	history.Downscale                = downscale;
+	history.FramesCount              = 0;
+	history.PreviousViewProjection   = mat4(1.0f);
+
+	return history;
+}
+
+void Clouds::FreeHistory(CloudsHistory& history)
+{
+	if (history.RaymarchRenderTexture)
+	{
+		delete history.RaymarchRenderTexture;
+		history.RaymarchRenderTexture = nullptr;
+	}
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (history.HistoryRenderTextures[i])
+		{
+			delete history.HistoryRenderTextures[i];
+			history.HistoryRenderTextures[i] = nullptr;
+		}
+	}
+}
+
+int Clouds::GetDownscale()
+{
+	switch (RenderSettings::GetInstance()->GetCloudsQuality())
+	{
+	case RenderSettings::CloudsQuality::Half:
+		return 2;
+	case RenderSettings::CloudsQuality::Quarter:
+		return 4;
+	}
+
+	return 1;
+}
+
+// The raymarch sample moves inside the low resolution texel every frame, in the order of a Bayer
+// matrix, so that the accumulated history covers all the full resolution pixels of the texel.
+vec2 Clouds::GetSampleOffset(int frame, int downscale)
+{
+	static const int BAYER_2X2[2][2] = { { 0, 2 },
+	                                     { 3, 1 } };
+
+	static const int BAYER_4X4[4][4] = { {  0,  8,  2, 10 },
+	                                     { 12,  4, 14,  6 },
+	                                     {  3, 11,  1,  9 },
+	                                     { 15,  7, 13,  5 } };
+
+	int sampleIndex = frame % (downscale * downscale);
+
+	for (int y = 0; y < downscale; y++)
+	{
+		for (int x = 0; x < downscale; x++)
+		{
+			int order = downscale == 2 ? BAYER_2X2[y][x] : BAYER_4X4[y][x];
+
+			if (order == sampleIndex)
+				return vec2((x + 0.5f) / downscale - 0.5f, (y + 0.5f) / downscale - 0.5f);
+		}
+	}
+
+	return vec2(0.0f, 0.0f);
+}
\ No newline at end of file
@@ -1,5 +1,8 @@
 #pragma once
+#include <unordered_map>
 #include "Texture.h"
+#include "RenderTexture.h"
+#include "Shader.h"
 #include "Camera.h"
 #include "WorleyNoise.h"
 #include "Light.h"
@@ -17,17 +20,64 @@ public:
 		float     CloudsAltitude;
 	};
 
+private:
+
+	// The reduced resolution clouds of a camera, the raymarch results are accumulated over
+	// frames, so every camera needs its own history.
+	struct CloudsHistory
+	{
+	public:
+
+		RenderTexture* RaymarchRenderTexture;
+		RenderTexture* HistoryRenderTextures[2];
+		int            CurrentHistory;
+
+		int            Width;
+		int            Height;
+		int            Downscale;
+
+		int            FramesCount;
+		glm::mat4      PreviousViewProjection;
+	};
+
+	static const int          COMPUTE_SHADER_BLOCKS_COUNT   = 8;
+
+	static const int          LIGHT_VOLUME_WIDTH            = 64; // voxels along x and z
+	static const int          LIGHT_VOLUME_HEIGHT           = 16;
+	static const int          LIGHT_VOLUME_SLICES_PER_FRAME = 8;
+
+	static const int          OCCUPANCY_GRID_WIDTH          = 32; // cells along x and z
+	static const int          OCCUPANCY_GRID_HEIGHT         = 8;
+
+	static const float        HISTORY_WEIGHT;
+	static const unsigned int NOISE_SEED;
+	static const glm::vec4    SHAPE_NOISE_WEIGHTS;
+	static const float        DENSITY_OFFSET;
+
 public:
 
 	Clouds(CloudsProperties);
 	~Clouds();
 
 	void Update(float);
+	void UpdateLightVolume(Camera*, Light*);
+	void UpdateOccupancyGrid(Camera*);
+	// Raymarches the clouds at reduced resolution, must be called before the target of Draw is bound.
+	void Render(Camera*, Light*, Texture*);
 	void Draw(Camera*, Light*, Texture*, Texture*, bool);
 
 private:
 
-	void UpdateOffset(glm::vec3&, glm::vec3&, float);
+	void             UpdateOffset(glm::vec3&, glm::vec3&, float);
+	void             SetRaymarchParameters(Shader*, Camera*, Light*);
+	void             SetDensityParameters(Shader*, Light*, const glm::vec3&, const glm::vec3&);
+	void             GetCloudsBounds(glm::vec3, glm::vec3&, glm::vec3&);
+
+	CloudsHistory&   GetHistory(Camera*, int, int, int);
+	void             FreeHistory(CloudsHistory&);
+
+	static int       GetDownscale();
+	static glm::vec2 GetSampleOffset(int, int);
 
 private:
 
@@ -42,4 +92,22 @@ private:
 				     
 	glm::vec3        m_cloudsOffset;
 	glm::vec3        m_detailsOffset;
+
+	Texture3D*       m_lightVolumes[2];
+	int              m_currentLightVolume;
+	glm::vec3        m_lightVolumeMin;
+	glm::vec3        m_lightVolumeMax;
+	bool             m_lightVolumeValid;
+
+	int              m_bakedSlicesCount;
+	glm::vec3        m_bakingVolumeMin;
+	glm::vec3        m_bakingVolumeMax;
+
+	Texture3D*       m_occupancyGrid;
+	glm::vec3        m_occupancyGridMin;
+	glm::vec3        m_occupancyGridMax;
+	bool             m_occupancyGridValid;
+	float            m_maxShapeNoise;
+
+	std::unordered_map<Camera*, CloudsHistory> m_histories;
 };
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include <cstdint>
+#include <algorithm>
+
+#include "FrameArena.h"
+
+using namespace std;
+
+thread_local FrameArena::ThreadArena* FrameArena::g_threadArena      = nullptr;
+thread_local FrameArena*              FrameArena::g_threadArenaOwner = nullptr;
+
+FrameArena*                           FrameArena::g_instance         = nullptr;
+
+FrameArena::~FrameArena()
+{
+	lock_guard<mutex> lock(m_threadArenasMutex);
+
+	for (auto& threadArena : m_threadArenas)
+	{
+		if (threadArena)
+		{
+			for (auto& block : threadArena->Blocks)
+				delete[] block.Memory;
+
+			delete threadArena;
+			threadArena = nullptr;
+		}
+	}
+
+	m_threadArenas.clear();
+}
+
+FrameArena* FrameArena::GetInstance()
+{
+	if (!g_instance)
+		g_instance = new FrameArena();
+
+	return g_instance;
+}
+
+void FrameArena::FreeInstance()
+{
+	if (g_instance)
+	{
+		delete g_instance;
+		g_instance = nullptr;
+	}
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	ThreadArena* threadArena = GetThreadArena();
+
+	while (true)
+	{
+		Block&    block   = threadArena->Blocks[threadArena->CurrentBlock];
+		uintptr_t address = (uintptr_t)(block.Memory + threadArena->Offset);
+		size_t    padding = (alignment - address % alignment) % alignment;
+
+		if (threadArena->Offset + padding + size <= block.Size)
+		{
+			threadArena->Offset   += padding + size;
+			threadArena->UsedSize += padding + size;
+
+			return (void*)(address + padding);
+		}
+
+		// The rest of the block is wasted, it still counts for the size of the merged block.
+		threadArena->UsedSize += block.Size - threadArena->Offset;
+
+		if (threadArena->CurrentBlock + 1 >= (int)threadArena->Blocks.size())
+			AddBlock(threadArena, std::max(BLOCK_SIZE, size + alignment));
+
+		threadArena->CurrentBlock++;
+		threadArena->Offset = 0;
+	}
+}
+
+void FrameArena::Reset()
+{
+	lock_guard<mutex> lock(m_threadArenasMutex);
+
+	for (auto& threadArena : m_threadArenas)
+	{
+		if (threadArena->Blocks.size() > 1)
+		{
+			size_t mergedSize = std::max(threadArena->UsedSize, BLOCK_SIZE);
+
+			for (auto& block : threadArena->Blocks)
+				delete[] block.Memory;
+
+			threadArena->Blocks.clear();
+			AddBlock(threadArena, mergedSize);
+		}
+
+		threadArena->CurrentBlock = 0;
+		threadArena->Offset       = 0;
+		threadArena->UsedSize     = 0;
+	}
+}
+
+FrameArena::FrameArena()
+{
+}
+
+// The arena of a thread is created the first time the thread allocates, the Profiler keeps its
+// buffers the same way.
+FrameArena::ThreadArena* FrameArena::GetThreadArena()
+{
+	if (g_threadArena && g_threadArenaOwner == this)
+		return g_threadArena;
+
+	ThreadArena* threadArena = new ThreadArena();
+
+	threadArena->CurrentBlock = 0;
+	threadArena->Offset       = 0;
+	threadArena->UsedSize     = 0;
+
+	AddBlock(threadArena, BLOCK_SIZE);
+
+	{
+		lock_guard<mutex> lock(m_threadArenasMutex);
+		m_threadArenas.push_back(threadArena);
+	}
+
+	g_threadArena      = threadArena;
+	g_threadArenaOwner = this;
+
+	return threadArena;
+}
+
+void FrameArena::AddBlock(ThreadArena* threadArena, size_t size)
+{
+	Block block;
+
+	block.Memory = new char[size];
+	block.Size   = size;
+
+	threadArena->Blocks.push_back(block);
+}
\ No newline at end of file
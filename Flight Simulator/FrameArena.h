@@ -0,0 +1,117 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <functional>
+#include <unordered_set>
+
+// Linear allocator for the data that only lives during a frame (visibility lists, instance arrays,
+// sort buffers). Every thread bumps a pointer in its own blocks, so allocating takes no locks and
+// freeing does nothing; Reset rewinds all of them at once. A frame that overflows the blocks gets
+// them merged into a single larger block at the next Reset, so after a few frames the arena stops
+// going to the heap.
+class FrameArena
+{
+public:
+
+	static const size_t BLOCK_SIZE = 1 << 20;
+
+private:
+
+	struct Block
+	{
+	public:
+
+		char*  Memory;
+		size_t Size;
+	};
+
+	struct ThreadArena
+	{
+	public:
+
+		std::vector<Block> Blocks;
+		int                CurrentBlock;
+		size_t             Offset;     // in the current block
+		size_t             UsedSize;   // in all the blocks, since the last Reset
+	};
+
+public:
+
+	FrameArena(const FrameArena&)     = delete;
+	void operator=(const FrameArena&) = delete;
+
+	~FrameArena();
+
+	static FrameArena* GetInstance();
+	static void        FreeInstance();
+
+	       void*       Allocate(size_t, size_t);
+
+	       // Must only be called while no thread uses the memory it got during the frame.
+	       void        Reset();
+
+private:
+
+	FrameArena();
+
+	ThreadArena* GetThreadArena();
+	void         AddBlock(ThreadArena*, size_t);
+
+private:
+
+	       std::mutex                       m_threadArenasMutex;
+	       std::vector<ThreadArena*>        m_threadArenas;
+
+	static thread_local ThreadArena*        g_threadArena;
+	static thread_local FrameArena*         g_threadArenaOwner;
+
+	static FrameArena*                      g_instance;
+};
+
+// STL allocator over the FrameArena of the calling thread. The containers using it must not
+// outlive the frame they were filled in.
+template <class T>
+class FrameAllocator
+{
+public:
+
+	typedef T value_type;
+
+public:
+
+	FrameAllocator() = default;
+
+	template <class U>
+	FrameAllocator(const FrameAllocator<U>&)
+	{
+	}
+
+	T* allocate(size_t count)
+	{
+		return static_cast<T*>(FrameArena::GetInstance()->Allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	void deallocate(T*, size_t)
+	{
+	}
+
+	template <class U>
+	bool operator==(const FrameAllocator<U>&) const
+	{
+		return true;
+	}
+
+	template <class U>
+	bool operator!=(const FrameAllocator<U>&) const
+	{
+		return false;
+	}
+};
+
+template <class T>
+using FrameVector       = std::vector<T, FrameAllocator<T>>;
+
+template <class T, class Hash = std::hash<T>>
+using FrameUnorderedSet = std::unordered_set<T, Hash, std::equal_to<T>, FrameAllocator<T>>;
\ No newline at end of file
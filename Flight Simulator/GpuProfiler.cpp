@@ -0,0 +1,183 @@
+#include "glad/glad.h"
+#include "GpuProfiler.h"
+#include "BenchmarkHelper.h"
+
+using namespace std;
+
+GpuProfiler* GpuProfiler::g_instance = nullptr;
+
+GpuProfiler::~GpuProfiler()
+{
+	for (auto& frame : m_frames)
+	{
+		if (!frame.Queries.empty())
+			glDeleteQueries((int)frame.Queries.size(), frame.Queries.data());
+
+		frame.Queries.clear();
+		frame.Zones.clear();
+	}
+}
+
+GpuProfiler* GpuProfiler::GetInstance()
+{
+	if (!g_instance)
+		g_instance = new GpuProfiler();
+
+	return g_instance;
+}
+
+void GpuProfiler::FreeInstance()
+{
+	if (g_instance)
+	{
+		delete g_instance;
+		g_instance = nullptr;
+	}
+}
+
+void GpuProfiler::BeginFrame()
+{
+	// The zones left open belong to the previous frame, they can't be closed anymore.
+	m_depth        = 0;
+	m_currentFrame = (m_currentFrame + 1) % FRAMES_LATENCY;
+
+	FrameQueries& frame = m_frames[m_currentFrame];
+
+	ResolveFrame(frame);
+
+	long long gpuTime = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+
+	frame.CpuNanoseconds = Profiler::GetInstance()->Now();
+	frame.GpuNanoseconds = gpuTime;
+}
+
+void GpuProfiler::BeginZone(const char* name)
+{
+	if (m_depth >= MAX_ZONE_DEPTH)
+	{
+		m_depth++;
+		return;
+	}
+
+	if (!Profiler::GetInstance()->IsEnabled())
+	{
+		m_openZones[m_depth++] = -1;
+		return;
+	}
+
+	FrameQueries& frame = m_frames[m_currentFrame];
+
+	GpuZone zone;
+	zone.Name            = name;
+	zone.BeginQueryIndex = PushQuery();
+	zone.EndQueryIndex   = -1;
+	zone.Depth           = m_depth;
+
+	m_openZones[m_depth++] = (int)frame.Zones.size();
+	frame.Zones.push_back(zone);
+}
+
+void GpuProfiler::EndZone()
+{
+	if (m_depth <= 0)
+		return;
+
+	m_depth--;
+
+	if (m_depth >= MAX_ZONE_DEPTH || m_openZones[m_depth] < 0)
+		return;
+
+	FrameQueries& frame = m_frames[m_currentFrame];
+	frame.Zones[m_openZones[m_depth]].EndQueryIndex = PushQuery();
+}
+
+int GpuProfiler::GetDroppedFramesCount() const
+{
+	return m_droppedFramesCount;
+}
+
+GpuProfiler::GpuProfiler() :
+	m_currentFrame(0),
+	m_depth(0),
+	m_droppedFramesCount(0)
+{
+	for (auto& frame : m_frames)
+	{
+		frame.UsedQueriesCount = 0;
+		frame.CpuNanoseconds   = 0;
+		frame.GpuNanoseconds   = 0;
+	}
+
+	long long gpuTime = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+
+	m_frames[m_currentFrame].CpuNanoseconds = Profiler::GetInstance()->Now();
+	m_frames[m_currentFrame].GpuNanoseconds = gpuTime;
+}
+
+int GpuProfiler::PushQuery()
+{
+	FrameQueries& frame = m_frames[m_currentFrame];
+
+	// The queries are kept between frames, new ones are only created when a frame needs more.
+	if (frame.UsedQueriesCount >= (int)frame.Queries.size())
+	{
+		unsigned int query;
+		glGenQueries(1, &query);
+		frame.Queries.push_back(query);
+	}
+
+	int queryIndex = frame.UsedQueriesCount++;
+	glQueryCounter(frame.Queries[queryIndex], GL_TIMESTAMP);
+
+	return queryIndex;
+}
+
+void GpuProfiler::ResolveFrame(FrameQueries& frame)
+{
+	if (frame.UsedQueriesCount > 0)
+	{
+		int lastAvailable = 0;
+		glGetQueryObjectiv(frame.Queries[frame.UsedQueriesCount - 1], GL_QUERY_RESULT_AVAILABLE, &lastAvailable);
+
+		// The queries complete in order, if the last one isn't ready after FRAMES_LATENCY frames
+		// the GPU is far behind; the frame is dropped instead of waiting for it.
+		if (!lastAvailable)
+			m_droppedFramesCount++;
+		else
+		{
+			BenchmarkHelper*            benchmarkHelper = BenchmarkHelper::GetInstance();
+			vector<Profiler::ZoneEvent> zoneEvents;
+
+			zoneEvents.reserve(frame.Zones.size());
+
+			for (auto& zone : frame.Zones)
+			{
+				if (zone.EndQueryIndex < 0)
+					continue;
+
+				unsigned long long beginTime = 0;
+				unsigned long long endTime   = 0;
+
+				glGetQueryObjectui64v(frame.Queries[zone.BeginQueryIndex], GL_QUERY_RESULT, &beginTime);
+				glGetQueryObjectui64v(frame.Queries[zone.EndQueryIndex],   GL_QUERY_RESULT, &endTime);
+
+				Profiler::ZoneEvent zoneEvent;
+				zoneEvent.Name             = zone.Name;
+				zoneEvent.BeginNanoseconds = (long long)beginTime - frame.GpuNanoseconds + frame.CpuNanoseconds;
+				zoneEvent.EndNanoseconds   = (long long)endTime   - frame.GpuNanoseconds + frame.CpuNanoseconds;
+				zoneEvent.Depth            = zone.Depth;
+
+				zoneEvents.push_back(zoneEvent);
+
+				benchmarkHelper->AddTimeSample(string("GPU::") + zone.Name, (long long)(endTime - beginTime));
+			}
+
+			Profiler::GetInstance()->AddTrackZones("GPU", zoneEvents);
+		}
+	}
+
+	frame.UsedQueriesCount = 0;
+	frame.Zones.clear();
+}
\ No newline at end of file
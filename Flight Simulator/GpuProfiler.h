@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+
+#include "Profiler.h"
+
+// Measures the GPU time of the render passes and compute stages with GL_TIMESTAMP queries.
+// The queries of a frame are read back FRAMES_LATENCY frames later, so the CPU never waits
+// for them; the results go to the "GPU" track of the Profiler and to the BenchmarkHelper.
+class GpuProfiler
+{
+private:
+
+	static const int FRAMES_LATENCY = 4;
+	static const int MAX_ZONE_DEPTH = 16;
+
+	struct GpuZone
+	{
+	public:
+
+		const char* Name;
+		int         BeginQueryIndex;
+		int         EndQueryIndex;
+		int         Depth;
+	};
+
+	struct FrameQueries
+	{
+	public:
+
+		std::vector<unsigned int> Queries;
+		int                       UsedQueriesCount;
+		std::vector<GpuZone>      Zones;
+
+		long long                 CpuNanoseconds; // CPU and GPU clocks sampled at the same moment,
+		long long                 GpuNanoseconds; // used to place the GPU zones on the CPU timeline
+	};
+
+public:
+
+	GpuProfiler(const GpuProfiler&)    = delete;
+	void operator=(const GpuProfiler&) = delete;
+
+	~GpuProfiler();
+
+	static GpuProfiler* GetInstance();
+	static void         FreeInstance();
+
+	       void         BeginFrame();
+
+	       void         BeginZone(const char*);
+	       void         EndZone();
+
+	       int          GetDroppedFramesCount() const;
+
+private:
+
+	GpuProfiler();
+
+	int  PushQuery();
+	void ResolveFrame(FrameQueries&);
+
+private:
+
+	       FrameQueries        m_frames[FRAMES_LATENCY];
+	       int                 m_currentFrame;
+
+	       int                 m_openZones[MAX_ZONE_DEPTH];
+	       int                 m_depth;
+
+	       int                 m_droppedFramesCount;
+
+	static GpuProfiler*        g_instance;
+};
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "Histogram.h"
+
+using namespace std;
+
+Histogram::Histogram()
+{
+	Reset();
+}
+
+void Histogram::AddValue(long long value)
+{
+	value = max(value, 0LL);
+
+	m_counts[GetBucketIndex(value)]++;
+	m_totalCount++;
+	m_sum += value;
+
+	m_min = m_totalCount == 1 ? value : min(m_min, value);
+	m_max = m_totalCount == 1 ? value : max(m_max, value);
+}
+
+void Histogram::Reset()
+{
+	memset(m_counts, 0, sizeof(m_counts));
+
+	m_totalCount = 0;
+	m_sum        = 0.0;
+	m_min        = 0;
+	m_max        = 0;
+}
+
+long long Histogram::GetPercentile(double percentile) const
+{
+	if (m_totalCount == 0)
+		return 0;
+
+	percentile = min(max(percentile, 0.0), 100.0);
+
+	unsigned long long targetCount = (unsigned long long)ceil(percentile / 100.0 * m_totalCount);
+	targetCount                    = max(targetCount, 1ULL);
+
+	unsigned long long currentCount = 0;
+
+	for (int i = 0; i < BUCKETS_COUNT; i++)
+	{
+		currentCount += m_counts[i];
+
+		if (currentCount >= targetCount)
+			return min(GetBucketHighestValue(i), m_max);
+	}
+
+	return m_max;
+}
+
+long long Histogram::GetMin() const
+{
+	return m_min;
+}
+
+long long Histogram::GetMax() const
+{
+	return m_max;
+}
+
+long long Histogram::GetAverage() const
+{
+	if (m_totalCount == 0)
+		return 0;
+
+	return (long long)(m_sum / m_totalCount);
+}
+
+unsigned long long Histogram::GetCount() const
+{
+	return m_totalCount;
+}
+
+int Histogram::GetBucketIndex(long long value)
+{
+	value = min(value, (1LL << MAX_VALUE_BITS) - 1);
+
+	if (value < SUB_BUCKETS_COUNT)
+		return (int)value;
+
+	int mostSignificantBit = SUB_BUCKET_BITS;
+	while ((value >> (mostSignificantBit + 1)) != 0)
+		mostSignificantBit++;
+
+	// value >> shift lands in [HALF_BUCKETS_COUNT, SUB_BUCKETS_COUNT).
+	int shift = mostSignificantBit - (SUB_BUCKET_BITS - 1);
+
+	return SUB_BUCKETS_COUNT + (shift - 1) * HALF_BUCKETS_COUNT + (int)((value >> shift) - HALF_BUCKETS_COUNT);
+}
+
+long long Histogram::GetBucketHighestValue(int bucketIndex)
+{
+	if (bucketIndex < SUB_BUCKETS_COUNT)
+		return bucketIndex;
+
+	int       bucketOffset = bucketIndex - SUB_BUCKETS_COUNT;
+	int       shift        = bucketOffset / HALF_BUCKETS_COUNT + 1;
+	long long subBucket    = bucketOffset % HALF_BUCKETS_COUNT + HALF_BUCKETS_COUNT;
+
+	return ((subBucket + 1) << shift) - 1;
+}
\ No newline at end of file
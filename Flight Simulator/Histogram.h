@@ -0,0 +1,43 @@
+#pragma once
+
+// Fixed-memory log-linear histogram (in the style of HdrHistogram) for durations in nanoseconds.
+// Values below 2^SUB_BUCKET_BITS are counted exactly, above that every power of two is split
+// into 2^(SUB_BUCKET_BITS - 1) buckets, which keeps the relative error under 1%.
+class Histogram
+{
+public:
+
+	static const int       SUB_BUCKET_BITS    = 8;
+	static const int       MAX_VALUE_BITS     = 43; // ~2.4 hours in nanoseconds, larger values are clamped
+
+	static const int       SUB_BUCKETS_COUNT  = 1 << SUB_BUCKET_BITS;
+	static const int       HALF_BUCKETS_COUNT = SUB_BUCKETS_COUNT / 2;
+	static const int       BUCKETS_COUNT      = SUB_BUCKETS_COUNT + (MAX_VALUE_BITS - SUB_BUCKET_BITS) * HALF_BUCKETS_COUNT;
+
+public:
+
+	Histogram();
+
+	void               AddValue(long long);
+	void               Reset();
+
+	long long          GetPercentile(double) const; // percentile in [0, 100]
+	long long          GetMin()              const;
+	long long          GetMax()              const;
+	long long          GetAverage()          const;
+	unsigned long long GetCount()            const;
+
+private:
+
+	static int       GetBucketIndex(long long);
+	static long long GetBucketHighestValue(int);
+
+private:
+
+	unsigned long long m_counts[BUCKETS_COUNT];
+	unsigned long long m_totalCount;
+	long double        m_sum;
+
+	long long          m_min;
+	long long          m_max;
+};
\ No newline at end of file
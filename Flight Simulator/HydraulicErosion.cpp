@@ -13,7 +13,7 @@ HydraulicErosion::HydraulicErosion(ErosionParameters parameters) :
 	m_parameters(parameters)
 {
 	CreateRandomIndices();
-	CreateErosionBrushDetails();
+	CreateErosionBrushDetails(m_parameters.BrushWidth);
 
 	CreateRandomIndicesBuffer();
 	CreateErosionBrushDetailsBuffer();
@@ -30,6 +30,25 @@ void HydraulicErosion::ApplyErosion(Texture* heightMap)
 	ShaderManager* shaderManager = ShaderManager::GetInstance();
 	Shader*        erosionShader = shaderManager->GetHydraulicErosionShader();
 
+	// A droplet moves by a texel every step and the brush and the border are in texels, they are
+	// all scaled with the texture so the erosion covers the same part of the chunk at any size.
+	float sizeRatio      = (float)heightMap->GetWidth() / (float)m_parameters.TextureSize;
+	int   brushWidth     = std::min(std::max((int)round(m_parameters.BrushWidth * sizeRatio), 1), MAX_BRUSH_WIDTH);
+	int   lifetime       = std::max((int)round(DROPLET_LIFETIME * sizeRatio), 1);
+	int   borderSize     = std::max((int)round(BORDER_SIZE * sizeRatio), 1);
+
+	// The water evaporates over the same distance, with fewer and longer steps.
+	float evaporateSpeed = 1.0f - pow(1.0f - 0.02f, 1.0f / sizeRatio);
+
+	if (brushWidth != m_brushWidth)
+	{
+		CreateErosionBrushDetails(brushWidth);
+
+		glBindBuffer(GL_UNIFORM_BUFFER, m_erosionBrushDetailsBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(vec4) * MAX_BRUSH_SIZE, m_erosionBrushDetails);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
 	erosionShader->Use();
 
 	erosionShader->SetImage2D("ImgOutput", heightMap, 0, Texture::Format::R32F);
@@ -40,11 +59,11 @@ void HydraulicErosion::ApplyErosion(Texture* heightMap)
 	erosionShader->SetUniformBlockBinding("ErosionBrushDetails", 2);
 	glBindBufferBase(GL_UNIFORM_BUFFER, 2, m_erosionBrushDetailsBuffer);
 
-	erosionShader->SetInt("DropletLifetime", 90);
-	erosionShader->SetInt("BrushWidth", m_parameters.BrushWidth);
+	erosionShader->SetInt("DropletLifetime", lifetime);
+	erosionShader->SetInt("BrushWidth", brushWidth);
 
 	erosionShader->SetFloat("InitialWater",           1);
-	erosionShader->SetFloat("EvaporateSpeed",         0.02);
+	erosionShader->SetFloat("EvaporateSpeed",         evaporateSpeed);
 	erosionShader->SetFloat("InitialSpeed",           2.0);
 	erosionShader->SetFloat("SedimentCapacityFactor", 3.0f);
 	erosionShader->SetFloat("MinSedimentCapacity",    0.01);
@@ -52,9 +71,12 @@ void HydraulicErosion::ApplyErosion(Texture* heightMap)
 	erosionShader->SetFloat("ErodeSpeed",             0.4f);
 	erosionShader->SetFloat("Gravity",                4.0f);
 	erosionShader->SetFloat("Inertia",                0.7f);
-	erosionShader->SetInt("BorderSize",               10);
+	erosionShader->SetInt("BorderSize",               borderSize);
 
-	glDispatchCompute(Texture::GetComputeShaderGroupsCount(m_parameters.Iterations, THREADS_PER_BLOCK), 1, 1);
+	// The droplets per texel stay the same at any resolution.
+	int   iterations     = std::max((int)(m_parameters.Iterations * sizeRatio * sizeRatio), 1);
+
+	glDispatchCompute(Texture::GetComputeShaderGroupsCount(iterations, THREADS_PER_BLOCK), 1, 1);
 	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 }
 
@@ -70,19 +92,21 @@ void HydraulicErosion::CreateRandomIndices()
 		m_randomIndices[i].Index = random();
 }
 
-void HydraulicErosion::CreateErosionBrushDetails()
+void HydraulicErosion::CreateErosionBrushDetails(int brushWidth)
 {
-	int centerX = m_parameters.BrushWidth / 2;
-	int centerY = m_parameters.BrushWidth / 2;
+	m_brushWidth = brushWidth;
+
+	int centerX = brushWidth / 2;
+	int centerY = brushWidth / 2;
 
-	float radius = (float)m_parameters.BrushWidth / 2.0f;
+	float radius = (float)brushWidth / 2.0f;
 
 	int index = 0;
 	float totalWeights = 0.0f;
 
-	for (int x = 0; x < m_parameters.BrushWidth; x++)
+	for (int x = 0; x < brushWidth; x++)
 	{
-		for (int y = 0; y < m_parameters.BrushWidth; y++)
+		for (int y = 0; y < brushWidth; y++)
 		{
 			int dx = x - centerX;
 			int dy = y - centerY;
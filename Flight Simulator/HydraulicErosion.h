@@ -12,15 +12,20 @@ private:
 	static const int MAX_BRUSH_WIDTH    = 9;
 	static const int MAX_BRUSH_SIZE     = MAX_BRUSH_WIDTH * MAX_BRUSH_WIDTH;
 
+	// For a TextureSize wide texture, in texels and droplet steps.
+	static const int DROPLET_LIFETIME   = 90;
+	static const int BORDER_SIZE        = 10;
+
 public:
 
 	struct ErosionParameters
 	{
 	public:
 
-		int Iterations;
+		int Iterations;  // the droplets for a TextureSize wide texture
 		int Seed;
 		int BrushWidth;
+		int TextureSize; // the texture size the parameters are tuned for
 	};
 
 	struct RandomIndices
@@ -43,7 +48,7 @@ public:
 private:
 
 	void CreateRandomIndices();
-	void CreateErosionBrushDetails();
+	void CreateErosionBrushDetails(int);
 
 	void CreateRandomIndicesBuffer();
 	void FreeRandomIndicesBuffer();
@@ -57,6 +62,7 @@ private:
 
 	RandomIndices       m_randomIndices[MAX_RANDOM_INDICES];
 	glm::vec4           m_erosionBrushDetails[MAX_BRUSH_SIZE];
+	int                 m_brushWidth;        // of the brush in the buffer
 
 	unsigned int        m_randomIndicesBuffer;
 	unsigned int        m_erosionBrushDetailsBuffer;
@@ -104,5 +104,6 @@ InputWrapper::InputWrapper() :
 
 	m_glfwToKeysMapping[GLFW_KEY_T     ] = { Keys::Debug   };
 	m_glfwToKeysMapping[GLFW_KEY_Y     ] = { Keys::Foliage };
+	m_glfwToKeysMapping[GLFW_KEY_P     ] = { Keys::Profile };
 	m_glfwToKeysMapping[GLFW_KEY_ESCAPE] = { Keys::Exit    };
 }
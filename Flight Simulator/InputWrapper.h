@@ -16,6 +16,7 @@ public:
 
 		Debug,
 		Foliage,
+		Profile,
 		Exit,
 
 		Last
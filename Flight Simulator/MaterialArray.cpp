@@ -0,0 +1,89 @@
+#include <algorithm>
+
+#include "MaterialArray.h"
+
+using namespace std;
+
+MaterialArray::MaterialArray(const vector<Material*>& materials)
+{
+	vector<Texture*> textures;
+	vector<Texture*> normalTextures;
+	vector<Texture*> specularTextures;
+
+	for (auto& material : materials)
+	{
+		textures.push_back(material->GetTexture());
+		normalTextures.push_back(material->GetNormalTexture());
+		specularTextures.push_back(material->GetSpecularTexture());
+	}
+
+	m_textureArray         = CreateTextureArray(textures);
+	m_normalTextureArray   = CreateTextureArray(normalTextures);
+	m_specularTextureArray = CreateTextureArray(specularTextures);
+}
+
+MaterialArray::~MaterialArray()
+{
+	if (m_specularTextureArray)
+	{
+		delete m_specularTextureArray;
+		m_specularTextureArray = nullptr;
+	}
+
+	if (m_normalTextureArray)
+	{
+		delete m_normalTextureArray;
+		m_normalTextureArray = nullptr;
+	}
+
+	if (m_textureArray)
+	{
+		delete m_textureArray;
+		m_textureArray = nullptr;
+	}
+}
+
+TextureArray* MaterialArray::GetTextureArray() const
+{
+	return m_textureArray;
+}
+
+TextureArray* MaterialArray::GetNormalTextureArray() const
+{
+	return m_normalTextureArray;
+}
+
+TextureArray* MaterialArray::GetSpecularTextureArray() const
+{
+	return m_specularTextureArray;
+}
+
+int MaterialArray::GetMaterialsCount() const
+{
+	return m_textureArray->GetLayersCount();
+}
+
+TextureArray* MaterialArray::CreateTextureArray(const vector<Texture*>& textures)
+{
+	// All the layers of an array share the same size, so every texture is rescaled to the biggest one.
+	int width  = 1;
+	int height = 1;
+
+	for (auto& texture : textures)
+	{
+		width  = max(width,  texture->GetWidth());
+		height = max(height, texture->GetHeight());
+	}
+
+	width  = min(width,  MAX_TEXTURE_SIZE);
+	height = min(height, MAX_TEXTURE_SIZE);
+
+	TextureArray* result = new TextureArray(width, height, max((int)textures.size(), 1));
+
+	for (int i = 0; i < textures.size(); i++)
+		result->SetLayer(i, textures[i]);
+
+	result->GenerateMipmaps();
+
+	return result;
+}
\ No newline at end of file
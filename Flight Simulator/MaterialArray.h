@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+#include "Material.h"
+#include "TextureArray.h"
+
+// Packs the textures of several materials into texture arrays, so all of them can be bound at once
+// and the shaders can index them by material ID.
+class MaterialArray
+{
+private:
+
+	const int MAX_TEXTURE_SIZE = 1024;
+
+public:
+
+	MaterialArray(const std::vector<Material*>&);
+	~MaterialArray();
+
+	TextureArray* GetTextureArray()         const;
+	TextureArray* GetNormalTextureArray()   const;
+	TextureArray* GetSpecularTextureArray() const;
+
+	int           GetMaterialsCount()       const;
+
+private:
+
+	TextureArray* CreateTextureArray(const std::vector<Texture*>&);
+
+private:
+
+	TextureArray* m_textureArray;
+	TextureArray* m_normalTextureArray;
+	TextureArray* m_specularTextureArray;
+};
\ No newline at end of file
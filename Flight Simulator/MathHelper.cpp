@@ -15,6 +15,19 @@ float MathHelper::Plane::GetSignedDistanceToPlane(const vec3& point) const
 	return dot(Normal, point) - Distance;
 }
 
+MathHelper::Frustum::Frustum() :
+	HasClipFace(false)
+{
+}
+
+void MathHelper::Frustum::SetClipPlane(const vec4& clipPlane)
+{
+	// The shaders keep the points with dot(plane.xyz, point) + plane.w >= 0.
+	ClipFace.Normal   = vec3(clipPlane.x, clipPlane.y, clipPlane.z);
+	ClipFace.Distance = -clipPlane.w;
+	HasClipFace       = true;
+}
+
 MathHelper::AABB::AABB() :
 	Center(vec3(0.0f, 0.0f, 0.0f)),
 	Extents(vec3(0.0f, 0.0f, 0.0f))
@@ -42,7 +55,8 @@ bool MathHelper::AABB::IsOnFrustum(const Frustum& frustum) const
 		   IsOnOrForwardPlane(frustum.LeftFace)  &&
 		   IsOnOrForwardPlane(frustum.RightFace) &&
 		   IsOnOrForwardPlane(frustum.TopFace)   &&
-		   IsOnOrForwardPlane(frustum.BottomFace);
+		   IsOnOrForwardPlane(frustum.BottomFace) &&
+		   (!frustum.HasClipFace || IsOnOrForwardPlane(frustum.ClipFace));
 }
 
 bool MathHelper::AABB::IsOnOrForwardPlane(const Plane& plane) const
@@ -54,6 +68,13 @@ bool MathHelper::AABB::IsOnOrForwardPlane(const Plane& plane) const
 	return -r <= plane.GetSignedDistanceToPlane(Center);
 }
 
+float MathHelper::AABB::GetDistance(const vec3& point) const
+{
+	vec3 offset = glm::max(glm::abs(point - Center) - Extents, vec3(0.0f, 0.0f, 0.0f));
+
+	return length(offset);
+}
+
 MathHelper::Frustum MathHelper::GetCameraFrustum(Camera* camera)
 {
 	Frustum result;
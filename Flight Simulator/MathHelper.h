@@ -25,6 +25,12 @@ public:
 
 	struct Frustum
 	{
+	public:
+
+		Frustum();
+
+		void SetClipPlane(const glm::vec4&); // same convention as the ClipPlane shader uniform
+
 	public:
 
 		Plane TopFace;
@@ -35,6 +41,9 @@ public:
 
 		Plane FarFace;
 		Plane NearFace;
+
+		Plane ClipFace;
+		bool  HasClipFace;
 	};
 
 	struct BoundingVolume
@@ -52,8 +61,9 @@ public:
 		AABB(const glm::vec3&, const glm::vec3&);
 		AABB(const glm::vec3&, float, float, float);
 
-		bool IsOnFrustum(const Frustum&)      const override;
-		bool IsOnOrForwardPlane(const Plane&) const;
+		bool  IsOnFrustum(const Frustum&)      const override;
+		bool  IsOnOrForwardPlane(const Plane&) const;
+		float GetDistance(const glm::vec3&)    const; // 0 for the points inside the box
 
 	public:
 
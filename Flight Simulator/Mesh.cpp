@@ -1,6 +1,7 @@
 #include "glad/glad.h"
 
 #include "Mesh.h"
+#include "StreamingBuffer.h"
 
 using namespace std;
 using namespace glm;
@@ -13,6 +14,7 @@ Mesh::Mesh(vector<VertexNormalTextureBinormalTangent> vertices, vector<unsigned
 	m_vbo(0),
 	m_ebo(0),
     m_instanced(instanced),
+    m_baseInstance(0),
     m_instancesCount(0)
 {
 	SetupMesh();
@@ -30,9 +32,6 @@ Mesh::~Mesh()
         glDisableVertexAttribArray(6);
         glDisableVertexAttribArray(7);
         glDisableVertexAttribArray(8);
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glDeleteBuffers(1, &m_instanceVbo);
     }
     
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -45,16 +44,13 @@ Mesh::~Mesh()
     glDeleteVertexArrays(1, &m_vao);
 }
 
-void Mesh::SetInstances(const vector<mat4>& instances)
+void Mesh::SetInstances(int baseInstance, int instancesCount)
 {
     if (!m_instanced)
         return;
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(mat4) * instances.size(), instances.size() ? &instances[0] : NULL, GL_DYNAMIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    m_instancesCount = instances.size();
+    m_baseInstance   = baseInstance;
+    m_instancesCount = instancesCount;
 }
 
 int Mesh::Draw(Shader* shader, const string& texturesName, const string& normalTexturesName, const string& specularTexturesName, int startingTextureNumber)
@@ -79,7 +75,10 @@ int Mesh::Draw(Shader* shader, const string& texturesName, const string& normalT
     if (!m_instanced)
         glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, 0);
     else
-        glDrawElementsInstanced(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, 0, m_instancesCount);
+    {
+        StreamingBuffer::GetInstance()->BindVertexBuffer(INSTANCES_BINDING, sizeof(mat4));
+        glDrawElementsInstancedBaseInstance(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, 0, m_instancesCount, m_baseInstance);
+    }
 
     glBindVertexArray(0);
 
@@ -109,25 +108,17 @@ void Mesh::SetupMesh()
 
     if (m_instanced)
     {
-        glGenBuffers(1, &m_instanceVbo);
-        glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
-        glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_DYNAMIC_DRAW);
-
+        // The transforms come from the StreamingBuffer, bound in Draw since it can be reallocated.
         int vec4Size = sizeof(vec4);
 
-        glEnableVertexAttribArray(5);
-        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)0);
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)(1 * vec4Size));
-        glEnableVertexAttribArray(7);
-        glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)(2 * vec4Size));
-        glEnableVertexAttribArray(8);
-        glVertexAttribPointer(8, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)(3 * vec4Size));
-
-        glVertexAttribDivisor(5, 1);
-        glVertexAttribDivisor(6, 1);
-        glVertexAttribDivisor(7, 1);
-        glVertexAttribDivisor(8, 1);
+        for (int i = 0; i < 4; i++)
+        {
+            glEnableVertexAttribArray(5 + i);
+            glVertexAttribFormat(5 + i, 4, GL_FLOAT, GL_FALSE, i * vec4Size);
+            glVertexAttribBinding(5 + i, INSTANCES_BINDING);
+        }
+
+        glVertexBindingDivisor(INSTANCES_BINDING, 1);
     }
 
     glBindVertexArray(0);
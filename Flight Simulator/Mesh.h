@@ -13,11 +13,16 @@ public:
 	Mesh(std::vector<VertexNormalTextureBinormalTangent>, std::vector<unsigned int>, std::vector<Material*>, bool);
 	~Mesh();
 
-	void                    SetInstances(const std::vector<glm::mat4>&);
+	// The instance transforms are in the StreamingBuffer, from the base instance on.
+	void                    SetInstances(int, int);
 
 	int                     Draw(Shader*, const std::string&, const std::string&, const std::string&, int);
 	std::vector<Material*>& GetMaterials();
 
+private:
+
+	static const int INSTANCES_BINDING = 5; // the vertex buffer binding of the transforms, after the vertex attributes
+
 private:
 
 	void SetupMesh();
@@ -29,11 +34,11 @@ private:
 	std::vector<Material*>                          m_materials;
 									                
 	unsigned int                                    m_vao;
-	unsigned int                                    m_instanceVbo;
 	unsigned int                                    m_vbo;
 	unsigned int                                    m_ebo;
 
 	bool                                            m_instanced;
 
+	int                                             m_baseInstance;
 	int                                             m_instancesCount;
 };
\ No newline at end of file
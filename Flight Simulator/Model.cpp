@@ -36,13 +36,13 @@ Model::~Model()
 	m_meshes.clear();
 }
 
-void Model::SetInstances(const vector<mat4>& instances)
+void Model::SetInstances(int baseInstance, int instancesCount)
 {
 	if (!m_instanced)
 		return;
 
 	for (auto& mesh : m_meshes)
-		mesh->SetInstances(instances);
+		mesh->SetInstances(baseInstance, instancesCount);
 }
 
 int Model::Draw(Shader* shader, const string& texturesName, const string& normalTexturesName, const string& specularTexturesName, int startingTextureNumber)
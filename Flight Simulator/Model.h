@@ -16,7 +16,7 @@ public:
 	Model(const std::string&, bool = false);
 	~Model();
 
-	void SetInstances(const std::vector<glm::mat4>&);
+	void SetInstances(int, int);
 
 	int  Draw(Shader*, const std::string&, const std::string&, const std::string&, int);
 
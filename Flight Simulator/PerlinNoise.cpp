@@ -24,6 +24,14 @@ PerlinNoise::~PerlinNoise()
     FreeValuesBuffer();
 }
 
+void PerlinNoise::SetNoiseValues(Shader* noiseShader)
+{
+    noiseShader->SetUniformBlockBinding("NoiseValues", 1);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 1, m_noiseValuesBuffer);
+
+    noiseShader->SetVec2("OctaveOffset", OCTAVE_OFFSET);
+}
+
 void PerlinNoise::GenerateNoiseValues(int seed)
 {
     mt19937 generator(seed);
@@ -83,8 +91,7 @@ Texture* PerlinNoise::RenderNoise(Shader* noiseShader, NoiseParameters noisePara
 
     noiseShader->SetImage2D("ImgOutput",        noiseTexture, 0, Texture::Format::R32F);
 
-    noiseShader->SetUniformBlockBinding("NoiseValues", 1);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 1, m_noiseValuesBuffer);
+    SetNoiseValues(noiseShader);
 
     if (noiseShader->HasUniform("PrepareNormalize"))
         noiseShader->SetInt("PrepareNormalize", 0);
@@ -110,8 +117,6 @@ Texture* PerlinNoise::RenderNoise(Shader* noiseShader, NoiseParameters noisePara
     noiseShader->SetFloat("FudgeFactor",        noiseParameters.FudgeFactor);
     noiseShader->SetFloat("Exponent",           noiseParameters.Exponent);
                                                   
-    noiseShader->SetVec2("OctaveOffset",        OCTAVE_OFFSET);
-                                                  
     noiseShader->SetVec2("StartPosition",       noiseParameters.StartPosition);
     noiseShader->SetVec2("FinalPosition",       noiseParameters.EndPosition);
 
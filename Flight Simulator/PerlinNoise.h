@@ -42,6 +42,9 @@ public:
     Texture* RenderPerlinNoise(NoiseParameters);
     Texture* RenderSimplexNoise(NoiseParameters, bool = false);
 
+    // Binds the gradients and the permutations to a shader that evaluates the same noise.
+    void     SetNoiseValues(Shader*);
+
 private:
 
     Texture* RenderNoise(Shader*, NoiseParameters, bool);
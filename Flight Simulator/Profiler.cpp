@@ -0,0 +1,269 @@
+#include "Profiler.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+using namespace std;
+using namespace std::chrono;
+
+thread_local Profiler::ThreadBuffer* Profiler::g_threadBuffer      = nullptr;
+thread_local Profiler*               Profiler::g_threadBufferOwner = nullptr;
+
+Profiler*                            Profiler::g_instance          = nullptr;
+
+Profiler::~Profiler()
+{
+	lock_guard<mutex> lock(m_threadBuffersMutex);
+
+	for (auto& threadBuffer : m_threadBuffers)
+	{
+		if (threadBuffer)
+		{
+			delete threadBuffer;
+			threadBuffer = nullptr;
+		}
+	}
+
+	m_threadBuffers.clear();
+	m_tracksIndices.clear();
+
+	// The buffer of the calling thread is gone, a profiler created later must not find it.
+	if (g_threadBufferOwner == this)
+	{
+		g_threadBuffer      = nullptr;
+		g_threadBufferOwner = nullptr;
+	}
+}
+
+Profiler* Profiler::GetInstance()
+{
+	if (!g_instance)
+		g_instance = new Profiler();
+
+	return g_instance;
+}
+
+void Profiler::FreeInstance()
+{
+	if (g_instance)
+	{
+		delete g_instance;
+		g_instance = nullptr;
+	}
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+	m_enabled.store(enabled, memory_order_relaxed);
+}
+
+bool Profiler::IsEnabled() const
+{
+	return m_enabled.load(memory_order_relaxed);
+}
+
+void Profiler::SetThreadName(const string& threadName)
+{
+	ThreadBuffer* threadBuffer = GetThreadBuffer();
+
+	lock_guard<mutex> lock(m_threadBuffersMutex);
+	threadBuffer->ThreadName = threadName;
+}
+
+void Profiler::BeginZone(const char* name)
+{
+	ThreadBuffer* threadBuffer = GetThreadBuffer();
+	int           depth        = threadBuffer->Depth++;
+
+	if (depth >= MAX_ZONE_DEPTH)
+		return;
+
+	// A zone opened while the profiler is disabled still takes its slot in the stack,
+	// so the matching EndZone stays balanced if the profiler gets enabled in between.
+	if (!IsEnabled())
+	{
+		threadBuffer->OpenZonesNames[depth] = nullptr;
+		return;
+	}
+
+	threadBuffer->OpenZonesNames[depth]  = name;
+	threadBuffer->OpenZonesBegins[depth] = Now();
+}
+
+void Profiler::EndZone()
+{
+	ThreadBuffer* threadBuffer = GetThreadBuffer();
+
+	if (threadBuffer->Depth <= 0)
+		return;
+
+	int depth = --threadBuffer->Depth;
+
+	if (depth >= MAX_ZONE_DEPTH || !threadBuffer->OpenZonesNames[depth])
+		return;
+
+	ZoneEvent zoneEvent;
+
+	zoneEvent.Name             = threadBuffer->OpenZonesNames[depth];
+	zoneEvent.BeginNanoseconds = threadBuffer->OpenZonesBegins[depth];
+	zoneEvent.EndNanoseconds   = Now();
+	zoneEvent.Depth            = depth;
+
+	WriteEvent(threadBuffer, zoneEvent);
+}
+
+void Profiler::AddTrackZones(const string& trackName, const vector<ZoneEvent>& zoneEvents)
+{
+	if (!IsEnabled())
+		return;
+
+	ThreadBuffer* trackBuffer = nullptr;
+
+	{
+		lock_guard<mutex> lock(m_threadBuffersMutex);
+
+		auto it = m_tracksIndices.find(trackName);
+		if (it != m_tracksIndices.end())
+			trackBuffer = m_threadBuffers[it->second];
+	}
+
+	if (!trackBuffer)
+	{
+		trackBuffer = CreateBuffer(trackName);
+
+		lock_guard<mutex> lock(m_threadBuffersMutex);
+		m_tracksIndices[trackName] = trackBuffer->ThreadID;
+	}
+
+	for (auto& zoneEvent : zoneEvents)
+		WriteEvent(trackBuffer, zoneEvent);
+}
+
+long long Profiler::Now() const
+{
+	return duration_cast<nanoseconds>(steady_clock::now() - m_startTime).count();
+}
+
+bool Profiler::ExportChromeTrace(const string& filename)
+{
+	ofstream trace(filename);
+
+	if (!trace.is_open())
+	{
+		cout << "ERROR::PROFILER::TRACE_NOT_WRITTEN: " << filename << endl;
+		return false;
+	}
+
+	vector<pair<ThreadBuffer*, vector<ZoneEvent>>> threadsEvents;
+
+	{
+		lock_guard<mutex> lock(m_threadBuffersMutex);
+
+		for (auto& threadBuffer : m_threadBuffers)
+			threadsEvents.push_back(make_pair(threadBuffer, ReadEvents(threadBuffer)));
+	}
+
+	// The timestamps are in microseconds, the fractional part keeps the nanoseconds.
+	trace << fixed << setprecision(3);
+	trace << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" << endl;
+
+	bool firstEvent = true;
+
+	for (auto& threadEvents : threadsEvents)
+	{
+		ThreadBuffer* threadBuffer = threadEvents.first;
+
+		if (!firstEvent)
+			trace << "," << endl;
+
+		trace << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadBuffer->ThreadID
+			  << ",\"args\":{\"name\":\"" << threadBuffer->ThreadName << "\"}}";
+
+		firstEvent = false;
+
+		for (auto& zoneEvent : threadEvents.second)
+		{
+			trace << "," << endl;
+			trace << "{\"name\":\""  << zoneEvent.Name
+				  << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadBuffer->ThreadID
+				  << ",\"ts\":"      << zoneEvent.BeginNanoseconds / 1000.0
+				  << ",\"dur\":"     << (zoneEvent.EndNanoseconds - zoneEvent.BeginNanoseconds) / 1000.0
+				  << ",\"args\":{\"depth\":" << zoneEvent.Depth << "}}";
+		}
+	}
+
+	trace << endl << "]}" << endl;
+
+	cout << "Profiler trace written to " << filename << endl;
+
+	return true;
+}
+
+Profiler::Profiler() :
+	m_enabled(true),
+	m_startTime(steady_clock::now())
+{
+}
+
+Profiler::ThreadBuffer* Profiler::CreateBuffer(const string& name)
+{
+	ThreadBuffer* buffer = new ThreadBuffer();
+	buffer->WriteIndex.store(0, memory_order_relaxed);
+	buffer->Depth        = 0;
+
+	lock_guard<mutex> lock(m_threadBuffersMutex);
+
+	buffer->ThreadID   = (int)m_threadBuffers.size();
+	buffer->ThreadName = name.empty() ? "Thread " + to_string(buffer->ThreadID) : name;
+
+	m_threadBuffers.push_back(buffer);
+
+	return buffer;
+}
+
+Profiler::ThreadBuffer* Profiler::GetThreadBuffer()
+{
+	if (g_threadBuffer && g_threadBufferOwner == this)
+		return g_threadBuffer;
+
+	g_threadBuffer      = CreateBuffer("");
+	g_threadBufferOwner = this;
+
+	return g_threadBuffer;
+}
+
+void Profiler::WriteEvent(ThreadBuffer* buffer, const ZoneEvent& zoneEvent)
+{
+	unsigned long long writeIndex = buffer->WriteIndex.load(memory_order_relaxed);
+
+	buffer->Events[writeIndex & (RING_BUFFER_SIZE - 1)] = zoneEvent;
+	buffer->WriteIndex.store(writeIndex + 1, memory_order_release);
+}
+
+vector<Profiler::ZoneEvent> Profiler::ReadEvents(ThreadBuffer* threadBuffer) const
+{
+	vector<ZoneEvent> result;
+
+	unsigned long long endIndex   = threadBuffer->WriteIndex.load(memory_order_acquire);
+	unsigned long long beginIndex = endIndex > RING_BUFFER_SIZE ? endIndex - RING_BUFFER_SIZE : 0;
+
+	result.reserve((size_t)(endIndex - beginIndex));
+
+	for (unsigned long long i = beginIndex; i < endIndex; i++)
+		result.push_back(threadBuffer->Events[i & (RING_BUFFER_SIZE - 1)]);
+
+	// The owner thread may have kept writing while the events were copied, drop the ones that
+	// could have been overwritten in the meantime. The slot of currentIndex is written before the
+	// index is published, so it may be torn as well.
+	unsigned long long currentIndex = threadBuffer->WriteIndex.load(memory_order_acquire);
+
+	if (currentIndex - beginIndex >= RING_BUFFER_SIZE)
+	{
+		size_t overwrittenCount = (size_t)min<unsigned long long>(currentIndex - beginIndex - RING_BUFFER_SIZE + 1, result.size());
+		result.erase(result.begin(), result.begin() + overwrittenCount);
+	}
+
+	return result;
+}
\ No newline at end of file
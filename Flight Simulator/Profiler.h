@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Records nested CPU zones into per-thread ring buffers and exports them in the Chrome trace
+// format (chrome://tracing, Perfetto). Every thread only writes into its own buffer, so
+// recording a zone takes no locks; the buffers keep the last RING_BUFFER_SIZE zones.
+class Profiler
+{
+public:
+
+	static const int RING_BUFFER_SIZE = 1 << 16; // must be a power of 2
+	static const int MAX_ZONE_DEPTH   = 64;
+
+	struct ZoneEvent
+	{
+	public:
+
+		const char* Name;             // must be a string literal (or outlive the profiler)
+		long long   BeginNanoseconds;
+		long long   EndNanoseconds;
+		int         Depth;
+	};
+
+private:
+
+	struct ThreadBuffer
+	{
+	public:
+
+		std::atomic<unsigned long long> WriteIndex;
+		ZoneEvent                       Events[RING_BUFFER_SIZE];
+
+		const char*                     OpenZonesNames[MAX_ZONE_DEPTH];
+		long long                       OpenZonesBegins[MAX_ZONE_DEPTH];
+		int                             Depth;
+
+		int                             ThreadID;
+		std::string                     ThreadName;
+	};
+
+public:
+
+	Profiler(const Profiler&)       = delete;
+	void operator=(const Profiler&) = delete;
+
+	~Profiler();
+
+	static Profiler* GetInstance();
+	static void      FreeInstance();
+
+	       void      SetEnabled(bool);
+	       bool      IsEnabled() const;
+
+	       void      SetThreadName(const std::string&);
+
+	       void      BeginZone(const char*);
+	       void      EndZone();
+
+	       // Appends already measured zones (e.g. the GPU timings) on a separate named track.
+	       // Each track must only be written by a single thread.
+	       void      AddTrackZones(const std::string&, const std::vector<ZoneEvent>&);
+
+	       long long Now() const;
+
+	       bool      ExportChromeTrace(const std::string&);
+
+private:
+
+	Profiler();
+
+	ThreadBuffer*          CreateBuffer(const std::string&);
+	ThreadBuffer*          GetThreadBuffer();
+	void                   WriteEvent(ThreadBuffer*, const ZoneEvent&);
+	std::vector<ZoneEvent> ReadEvents(ThreadBuffer*) const;
+
+private:
+
+	       std::atomic<bool>                     m_enabled;
+	       std::chrono::steady_clock::time_point m_startTime;
+
+	       std::mutex                            m_threadBuffersMutex;
+	       std::vector<ThreadBuffer*>            m_threadBuffers;
+	       std::unordered_map<std::string, int>  m_tracksIndices;
+
+	static thread_local ThreadBuffer*            g_threadBuffer;
+	static thread_local Profiler*                g_threadBufferOwner;
+
+	static Profiler*                             g_instance;
+};
+
+// Profiles the enclosing scope.
+class ProfileZone
+{
+public:
+
+	inline  ProfileZone(const char* name) { Profiler::GetInstance()->BeginZone(name); }
+	inline ~ProfileZone()                 { Profiler::GetInstance()->EndZone();       }
+};
\ No newline at end of file
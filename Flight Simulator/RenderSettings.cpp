@@ -1,6 +1,9 @@
+#include <algorithm>
+
 #include "glad/glad.h"
 #include "RenderSettings.h"
 
+using namespace std;
 using namespace glm;
 
 RenderSettings* RenderSettings::g_instance = nullptr;
@@ -49,8 +52,96 @@ vec4 RenderSettings::ClipPlane() const
 	return m_clipPlane;
 }
 
+void RenderSettings::SetReflectionResolutionScale(float reflectionResolutionScale)
+{
+	m_reflectionResolutionScale = min(max(reflectionResolutionScale, 0.1f), 1.0f);
+}
+
+void RenderSettings::SetReflectionUpdateInterval(int reflectionUpdateInterval)
+{
+	m_reflectionUpdateInterval = max(reflectionUpdateInterval, 1);
+}
+
+void RenderSettings::SetReflectionFoliage(bool reflectionFoliage)
+{
+	m_reflectionFoliage = reflectionFoliage;
+}
+
+void RenderSettings::SetReflectionClouds(bool reflectionClouds)
+{
+	m_reflectionClouds = reflectionClouds;
+}
+
+float RenderSettings::ReflectionResolutionScale() const
+{
+	return m_reflectionResolutionScale;
+}
+
+int RenderSettings::ReflectionUpdateInterval() const
+{
+	return m_reflectionUpdateInterval;
+}
+
+bool RenderSettings::ReflectionFoliage() const
+{
+	return m_reflectionFoliage;
+}
+
+bool RenderSettings::ReflectionClouds() const
+{
+	return m_reflectionClouds;
+}
+
+void RenderSettings::SetSceneRefraction(bool sceneRefraction)
+{
+	m_sceneRefraction = sceneRefraction;
+}
+
+bool RenderSettings::SceneRefraction() const
+{
+	return m_sceneRefraction;
+}
+
+void RenderSettings::SetCloudsQuality(CloudsQuality cloudsQuality)
+{
+	m_cloudsQuality = cloudsQuality;
+}
+
+RenderSettings::CloudsQuality RenderSettings::GetCloudsQuality() const
+{
+	return m_cloudsQuality;
+}
+
+void RenderSettings::SetLongRangeTerrain(bool longRangeTerrain)
+{
+	m_longRangeTerrain = longRangeTerrain;
+}
+
+bool RenderSettings::LongRangeTerrain() const
+{
+	return m_longRangeTerrain;
+}
+
+void RenderSettings::SetChunkStreamingBudget(float chunkStreamingBudget)
+{
+	m_chunkStreamingBudget = max(chunkStreamingBudget, 0.0f);
+}
+
+float RenderSettings::ChunkStreamingBudget() const
+{
+	return m_chunkStreamingBudget;
+}
+
 RenderSettings::RenderSettings() :
 	m_clipPlane(0.0f, 1.0f, 0.0f, 0.0f),
-	m_planeClippingEnabled(false)
+	m_planeClippingEnabled(false),
+	m_reflectionResolutionScale(0.5f),
+	m_reflectionUpdateInterval(2),
+	m_reflectionFoliage(false),
+	m_reflectionClouds(true),
+	m_sceneRefraction(true),
+	m_cloudsQuality(CloudsQuality::Half),
+	m_longRangeTerrain(true),
+	m_chunkStreamingBudget(4.0f)
 {
 }
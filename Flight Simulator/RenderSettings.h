@@ -4,6 +4,15 @@
 
 class RenderSettings
 {
+public:
+
+	enum class CloudsQuality
+	{
+		Full,    // the clouds are raymarched for every pixel
+		Half,    // raymarched at half resolution, reprojected and upsampled
+		Quarter  // raymarched at quarter resolution, reprojected and upsampled
+	};
+
 public:
 
 	RenderSettings(const RenderSettings&) = delete;
@@ -20,6 +29,34 @@ public:
 		   bool            PlaneClippingEnabled() const;
 		   glm::vec4       ClipPlane()            const;
 
+		   // The planar reflection is only seen distorted through the water,
+		   // so it can be rendered smaller, less often and with less content.
+		   void            SetReflectionResolutionScale(float);
+		   void            SetReflectionUpdateInterval(int);
+		   void            SetReflectionFoliage(bool);
+		   void            SetReflectionClouds(bool);
+
+		   float           ReflectionResolutionScale() const;
+		   int             ReflectionUpdateInterval()  const; // in frames, the last reflection is reused in between
+		   bool            ReflectionFoliage()         const;
+		   bool            ReflectionClouds()          const;
+
+		   // When enabled, the water refracts a copy of the opaque scene from the main pass,
+		   // instead of two extra scene passes clipped above and below the water.
+		   void            SetSceneRefraction(bool);
+		   bool            SceneRefraction()           const;
+
+		   void            SetCloudsQuality(CloudsQuality);
+		   CloudsQuality   GetCloudsQuality()          const;
+
+		   // When enabled, the terrain past the detailed chunks is drawn from the clipmap up to the horizon.
+		   void            SetLongRangeTerrain(bool);
+		   bool            LongRangeTerrain()          const;
+
+		   // The time the terrain may spend each frame on generating and uploading new chunks.
+		   void            SetChunkStreamingBudget(float);
+		   float           ChunkStreamingBudget()      const; // in milliseconds
+
 private:
 
 	RenderSettings();
@@ -29,5 +66,18 @@ private:
 	       bool            m_planeClippingEnabled;
 		   glm::vec4       m_clipPlane;
 
+		   float           m_reflectionResolutionScale;
+		   int             m_reflectionUpdateInterval;
+		   bool            m_reflectionFoliage;
+		   bool            m_reflectionClouds;
+
+		   bool            m_sceneRefraction;
+
+		   CloudsQuality   m_cloudsQuality;
+
+		   bool            m_longRangeTerrain;
+
+		   float           m_chunkStreamingBudget;
+
 	static RenderSettings* g_instance;
 };
\ No newline at end of file
@@ -81,6 +81,25 @@ void RenderTexture::Begin()
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
+// Binds the render texture as the render target without clearing it.
+void RenderTexture::Bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer);
+    glViewport(0, 0, m_width, m_height);
+}
+
+void RenderTexture::CopyTo(RenderTexture* target)
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_frameBuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target->m_frameBuffer);
+
+    glBlitFramebuffer(0, 0, m_width,         m_height,
+                      0, 0, target->m_width, target->m_height,
+                      GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
 Texture* RenderTexture::GetTexture() const
 {
     return m_texture;
@@ -10,6 +10,8 @@ public:
     ~RenderTexture();
 
     void     Begin();
+    void     Bind();
+    void     CopyTo(RenderTexture*);
     Texture* GetTexture()      const;
     Texture* GetDepthTexture() const;
 
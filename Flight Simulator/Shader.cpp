@@ -1,5 +1,6 @@
 #include <fstream>
 #include <iostream>
+#include <cassert>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "glad/glad.h"
@@ -237,6 +238,11 @@ void Shader::SetVec2(const string& name, const vec2& value)
     glUniform2f(GetUniformLocation(name), value.x, value.y);
 }
 
+void Shader::SetIVec2(const string& name, const ivec2& value)
+{
+    glUniform2i(GetUniformLocation(name), value.x, value.y);
+}
+
 void Shader::SetVec3(const string& name, const vec3& value)
 {
     glUniform3f(GetUniformLocation(name), value.x, value.y, value.z);
@@ -267,6 +273,13 @@ void Shader::SetTexture3D(const string& name, Texture3D* texture, int textureNum
     SetInt(name, textureNumber);
 }
 
+void Shader::SetTextureArray(const string& name, TextureArray* textureArray, int textureNumber)
+{
+    glActiveTexture(GL_TEXTURE0 + textureNumber);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray->GetTextureID());
+    SetInt(name, textureNumber);
+}
+
 void Shader::SetCubemap(const string& name, Cubemap* cubemap, int textureNumber)
 {
     glActiveTexture(GL_TEXTURE0 + textureNumber);
@@ -299,9 +312,12 @@ int Shader::SetMaterials(const string& texturesName, const string& normalTexture
 {
     int materialsCount = materials.size();
 
-    int* textureNumbers = new int[materialsCount];
-    int* normalTextureNumbers = new int[materialsCount];
-    int* specularTextureNumbers = new int[materialsCount];
+    assert(materialsCount <= MAX_MATERIALS_COUNT &&
+           "Too many materials for a single draw call, use a MaterialArray instead.");
+
+    int textureNumbers[MAX_MATERIALS_COUNT];
+    int normalTextureNumbers[MAX_MATERIALS_COUNT];
+    int specularTextureNumbers[MAX_MATERIALS_COUNT];
 
     for (int i = 0; i < materialsCount; i++)
         textureNumbers[i] = startingTextureNumber++;
@@ -328,23 +344,14 @@ int Shader::SetMaterials(const string& texturesName, const string& normalTexture
     glUniform1iv(GetUniformLocation(normalTexturesName), materialsCount, normalTextureNumbers);
     glUniform1iv(GetUniformLocation(specularTexturesName), materialsCount, specularTextureNumbers);
 
-    if (specularTextureNumbers)
-    {
-        delete[] specularTextureNumbers;
-        specularTextureNumbers = nullptr;
-    }
-
-    if (normalTextureNumbers)
-    {
-        delete[] normalTextureNumbers;
-        normalTextureNumbers = nullptr;
-    }
+    return startingTextureNumber;
+}
 
-    if (textureNumbers)
-    {
-        delete[] textureNumbers;
-        textureNumbers = nullptr;
-    }
+int Shader::SetMaterialArray(const string& texturesName, const string& normalTexturesName, const string& specularTexturesName, MaterialArray* materialArray, int startingTextureNumber)
+{
+    SetTextureArray(texturesName,         materialArray->GetTextureArray(),         startingTextureNumber++);
+    SetTextureArray(normalTexturesName,   materialArray->GetNormalTextureArray(),   startingTextureNumber++);
+    SetTextureArray(specularTexturesName, materialArray->GetSpecularTextureArray(), startingTextureNumber++);
 
     return startingTextureNumber;
 }
@@ -359,22 +366,47 @@ void Shader::SetShaderStorageBlockBinding(const string& name, int binding)
     glShaderStorageBlockBinding(m_programId, GetShaderStorageBlockIndex(name), binding);
 }
 
+// The #include "file" lines are replaced with the file, found next to the including one, so the
+// shaders can share code.
 string Shader::ReadFile(const string filename)
 {
+    string str;
+
     try
     {
         ifstream t(filename);
-        string str((istreambuf_iterator<char>(t)),
+        str = string((istreambuf_iterator<char>(t)),
             istreambuf_iterator<char>());
-
-        return str;
     }
     catch (ifstream::failure e)
     {
         cout << "ERROR::FILE::NOT_SUCCESFULLY_READ" << endl;
+        return "";
+    }
+
+    const string includeDirective = "#include \"";
+
+    string directory = filename.substr(0, filename.find_last_of("/\\") + 1);
+    size_t position  = str.find(includeDirective);
+
+    while (position != string::npos)
+    {
+        size_t nameStart = position + includeDirective.size();
+        size_t nameEnd   = str.find('"', nameStart);
+
+        if (nameEnd == string::npos)
+        {
+            cout << "ERROR::SHADER::INCLUDE::INVALID" << endl;
+            break;
+        }
+
+        string includedStr = ReadFile(directory + str.substr(nameStart, nameEnd - nameStart));
+
+        str.replace(position, nameEnd + 1 - position, includedStr);
+        position = str.find(includeDirective, position + includedStr.size());
     }
 
-    return "";
+    return str;
 }
 
 int Shader::GetUniformLocation(const string& name)
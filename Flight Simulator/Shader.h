@@ -6,6 +6,7 @@
 #include "Texture.h"
 #include "Cubemap.h"
 #include "Material.h"
+#include "MaterialArray.h"
 #include <unordered_map>
 
 #include "Light.h"
@@ -17,6 +18,7 @@ class Shader
 private:
 
     static const int SHADER_COMPILE_LOG_LENGTH = 512;
+    static const int MAX_MATERIALS_COUNT       = 16;
 
 public:
 
@@ -33,16 +35,19 @@ public:
     void SetInt(const std::string&, int);
     void SetFloat(const std::string&, float);
     void SetVec2(const std::string&, const glm::vec2&);
+    void SetIVec2(const std::string&, const glm::ivec2&);
     void SetVec3(const std::string&, const glm::vec3&);
     void SetVec4(const std::string&, const glm::vec4&);
     void SetMatrix4(const std::string&, glm::mat4&);
     void SetTexture(const std::string&, Texture*, int);
     void SetTexture3D(const std::string&, Texture3D*, int);
+    void SetTextureArray(const std::string&, TextureArray*, int);
     void SetCubemap(const std::string&, Cubemap*, int);
     void SetImage2D(const std::string&, Texture*, int, Texture::Format);
     void SetImage3D(const std::string&, Texture3D*, int, Texture::Format);
     void SetLight(Camera*, Light*);
     int  SetMaterials(const std::string&, const std::string&, const std::string&, const std::vector<Material*>&, int);
+    int  SetMaterialArray(const std::string&, const std::string&, const std::string&, MaterialArray*, int);
 
     void SetUniformBlockBinding(const std::string&, int);
     void SetShaderStorageBlockBinding(const std::string&, int);
@@ -34,6 +34,12 @@ ShaderManager::~ShaderManager()
 		m_hydraulicErosionShader = nullptr;
 	}
 
+	if (m_textureQuantizeShader)
+	{
+		delete m_textureQuantizeShader;
+		m_textureQuantizeShader = nullptr;
+	}
+
 	if (m_texture3DNormalizeShader)
 	{
 		delete m_texture3DNormalizeShader;
@@ -82,6 +88,30 @@ ShaderManager::~ShaderManager()
 		m_colorShader = nullptr;
 	}
 
+	if (m_cloudsOccupancyShader)
+	{
+		delete m_cloudsOccupancyShader;
+		m_cloudsOccupancyShader = nullptr;
+	}
+
+	if (m_cloudsLightVolumeShader)
+	{
+		delete m_cloudsLightVolumeShader;
+		m_cloudsLightVolumeShader = nullptr;
+	}
+
+	if (m_cloudsCompositeShader)
+	{
+		delete m_cloudsCompositeShader;
+		m_cloudsCompositeShader = nullptr;
+	}
+
+	if (m_cloudsTemporalShader)
+	{
+		delete m_cloudsTemporalShader;
+		m_cloudsTemporalShader = nullptr;
+	}
+
 	if (m_cloudsShader)
 	{
 		delete m_cloudsShader;
@@ -112,6 +142,18 @@ ShaderManager::~ShaderManager()
 		m_waterShader = nullptr;
 	}
 
+	if (m_terrainClipmapNoiseShader)
+	{
+		delete m_terrainClipmapNoiseShader;
+		m_terrainClipmapNoiseShader = nullptr;
+	}
+
+	if (m_terrainClipmapShader)
+	{
+		delete m_terrainClipmapShader;
+		m_terrainClipmapShader = nullptr;
+	}
+
 	if (m_terrainShader)
 	{
 		delete m_terrainShader;
@@ -141,6 +183,16 @@ Shader* ShaderManager::GetTerrainShader()            const
 	return m_terrainShader;				             
 }
 
+Shader* ShaderManager::GetTerrainClipmapShader()     const
+{
+	return m_terrainClipmapShader;
+}
+
+Shader* ShaderManager::GetTerrainClipmapNoiseShader() const
+{
+	return m_terrainClipmapNoiseShader;
+}
+
 Shader* ShaderManager::GetWaterShader()              const
 {
 	return m_waterShader;
@@ -165,6 +217,26 @@ Shader* ShaderManager::GetCloudsShader()             const
 {
 	return m_cloudsShader;
 }
+
+Shader* ShaderManager::GetCloudsTemporalShader()     const
+{
+	return m_cloudsTemporalShader;
+}
+
+Shader* ShaderManager::GetCloudsCompositeShader()    const
+{
+	return m_cloudsCompositeShader;
+}
+
+Shader* ShaderManager::GetCloudsLightVolumeShader()  const
+{
+	return m_cloudsLightVolumeShader;
+}
+
+Shader* ShaderManager::GetCloudsOccupancyShader()    const
+{
+	return m_cloudsOccupancyShader;
+}
 										             
 Shader* ShaderManager::GetColorShader()              const
 {
@@ -206,6 +278,11 @@ Shader* ShaderManager::GetTexture3DNormalizeShader() const
 	return m_texture3DNormalizeShader;
 }
 
+Shader* ShaderManager::GetTextureQuantizeShader()    const
+{
+	return m_textureQuantizeShader;
+}
+
 Shader* ShaderManager::GetHydraulicErosionShader() const
 {
 	return m_hydraulicErosionShader;
@@ -233,8 +310,9 @@ Shader* ShaderManager::GetGaussianBlurShader()       const
 
 ShaderManager::ShaderManager()
 {
-	m_terrainShader            = new Shader("Shaders/Terrain.vert",          "Shaders/Terrain.frag",
-		                                    "Shaders/Terrain.tesc",          "Shaders/Terrain.tese");
+	m_terrainShader            = new Shader("Shaders/Terrain.vert",          "Shaders/Terrain.frag");
+	m_terrainClipmapShader     = new Shader("Shaders/TerrainClipmap.vert",   "Shaders/Terrain.frag");
+	m_terrainClipmapNoiseShader = new Shader("Shaders/TerrainClipmap.comp");
 
 	m_waterShader              = new Shader("Shaders/Water.vert",            "Shaders/Water.frag",
 		                                    "Shaders/Water.tesc",            "Shaders/Water.tese",
@@ -245,6 +323,10 @@ ShaderManager::ShaderManager()
 
 	m_skyboxShader             = new Shader("Shaders/Skybox.vert",           "Shaders/Skybox.frag");
 	m_cloudsShader             = new Shader("Shaders/Clouds.vert",           "Shaders/Clouds.frag");
+	m_cloudsTemporalShader     = new Shader("Shaders/Clouds.vert",           "Shaders/CloudsTemporal.frag");
+	m_cloudsCompositeShader    = new Shader("Shaders/Clouds.vert",           "Shaders/CloudsComposite.frag");
+	m_cloudsLightVolumeShader  = new Shader("Shaders/CloudsLightVolume.comp");
+	m_cloudsOccupancyShader    = new Shader("Shaders/CloudsOccupancy.comp");
 
 	m_colorShader              = new Shader("Shaders/Color.vert",            "Shaders/Color.frag");
 	m_textureShader            = new Shader("Shaders/Texture.vert",          "Shaders/Texture.frag");
@@ -255,6 +337,7 @@ ShaderManager::ShaderManager()
 	m_worleyNoiseShader        = new Shader("Shaders/WorleyNoise.comp");
 	m_texture2DNormalizeShader = new Shader("Shaders/Texture2DNormalize.comp");
 	m_texture3DNormalizeShader = new Shader("Shaders/Texture3DNormalize.comp");
+	m_textureQuantizeShader    = new Shader("Shaders/TextureQuantize.comp");
 
 	m_hydraulicErosionShader   = new Shader("Shaders/HydraulicErosion.comp");
 
@@ -15,6 +15,8 @@ public:
 	static void           FreeInstance();
 
 	       Shader*        GetTerrainShader()            const;
+		   Shader*        GetTerrainClipmapShader()     const;
+		   Shader*        GetTerrainClipmapNoiseShader() const;
 		   Shader*        GetWaterShader()              const;
 											            
 		   Shader*        GetFolliageShader()           const;
@@ -22,6 +24,10 @@ public:
 
 		   Shader*        GetSkyboxShader()             const;
 		   Shader*        GetCloudsShader()             const;
+		   Shader*        GetCloudsTemporalShader()     const;
+		   Shader*        GetCloudsCompositeShader()    const;
+		   Shader*        GetCloudsLightVolumeShader()  const;
+		   Shader*        GetCloudsOccupancyShader()    const;
 
 		   Shader*        GetColorShader()              const;
 		   Shader*        GetTextureShader()            const;
@@ -32,6 +38,7 @@ public:
 		   Shader*        GetWorleyNoiseShader()        const;
 		   Shader*        GetTexture2DNormalizeShader() const;
 		   Shader*        GetTexture3DNormalizeShader() const;
+		   Shader*        GetTextureQuantizeShader()    const;
 
 		   Shader*        GetHydraulicErosionShader()   const;
 
@@ -47,6 +54,8 @@ private:
 private:
 
 	       Shader*        m_terrainShader;
+		   Shader*        m_terrainClipmapShader;
+		   Shader*        m_terrainClipmapNoiseShader;
 		   Shader*        m_waterShader;
 
 		   Shader*        m_folliageShader;
@@ -54,6 +63,10 @@ private:
 
 		   Shader*        m_skyboxShader;
 		   Shader*        m_cloudsShader;
+		   Shader*        m_cloudsTemporalShader;
+		   Shader*        m_cloudsCompositeShader;
+		   Shader*        m_cloudsLightVolumeShader;
+		   Shader*        m_cloudsOccupancyShader;
 
 		   Shader*        m_colorShader;
 		   Shader*        m_textureShader;
@@ -64,6 +77,7 @@ private:
 		   Shader*        m_worleyNoiseShader;
 		   Shader*        m_texture2DNormalizeShader;
 		   Shader*        m_texture3DNormalizeShader;
+		   Shader*        m_textureQuantizeShader;
 
 		   Shader*        m_hydraulicErosionShader;
 	       		          
@@ -4,55 +4,62 @@ in vec2 FSInputTexCoords;
 
 uniform sampler2D SceneTexture;
 uniform sampler2D DepthTexture;
-uniform sampler3D CloudsDensityTexture;
-uniform sampler3D DetailNoiseTexture;
-uniform sampler2D WeatherMap;
 
 uniform mat4      CameraMatrix;
 uniform float     AspectRatio;
 uniform float     Near;
 uniform float     Far;
+uniform float     DepthRangeSplit;
+uniform float     FarRangeNear;
+uniform float     FarRangeFar;
 uniform float     FovY;
 			      
-uniform vec3      BoundsMin;
-uniform vec3      BoundsMax;
-
-uniform vec3      CloudScale;
-uniform float     DetailNoiseScale;
-uniform vec3      CloudOffset;
-uniform vec3      DetailsOffset;
-uniform float     DensityMultiplier;
-uniform float     DarknessThreshold;
-uniform float     DensityOffset;
 uniform vec4      PhaseParams;
 uniform int       FocusedEyeSunExponent;
-uniform vec4      ShapeNoiseWeights;
-uniform vec4      DetailNoiseWeights;
-uniform float     LightAbsorbtionTowardSun;
 uniform float     LightAbsorptionThroughCloud;
-uniform float     DetailNoiseWeight;
 uniform float     RayMarchStepSize;
 			      
 uniform vec4      DiffuseColor;
-uniform vec3      LightDirection;
 
-uniform int       LightStepsCount;
+// Transmittance toward the sun baked over the cloud box, replaces the light march when set.
+uniform sampler3D LightVolume;
+uniform vec3      LightVolumeMin;
+uniform vec3      LightVolumeMax;
+uniform int       UseLightVolume;
+
+// Upper bounds of the density in coarse cells, the empty cells are crossed in a single step.
+uniform sampler3D OccupancyGrid;
+uniform vec3      OccupancyGridMin;
+uniform vec3      OccupancyGridMax;
+uniform int       UseOccupancyGrid;
 
 uniform int       UseGammaCorrection;
 
+// When set, the raw raymarch results are written for the reduced resolution path:
+// (light energy, transmittance, scene distance, clouds distance).
+uniform int       OutputCloudsData;
+uniform vec2      SampleOffset;
+
 out vec4 FSOutFragColor;
 
+#include "CloudsDensity.glsl"
+
 float linearizeDepth(float d,float zNear,float zFar)
 {
+    // The far terrain is drawn with its own projection, in the upper part of the depth range.
+    if (d >= DepthRangeSplit && DepthRangeSplit < 1.0)
+    {
+        d     = (d - DepthRangeSplit) / (1.0 - DepthRangeSplit);
+        zNear = FarRangeNear;
+        zFar  = FarRangeFar;
+    }
+    else
+        d /= DepthRangeSplit;
+
     float z_n = 2.0 * d - 1.0;
     return 2.0 * zNear * zFar / (zFar + zNear - z_n * (zFar - zNear));
 }
 
-float beer(float d)
-{
-	return exp(-d);
-}
-
 float hg(float a, float g) 
 {
     float g2 = g*g;
@@ -66,111 +73,39 @@ float phase(float a)
     return PhaseParams.z + hgBlend*PhaseParams.w;
 }
 
-float remap(float x, float oldMin, float oldMax, float newMin, float newMax)
+float sampleLightVolume(vec3 pos)
 {
-    float oldDiff = oldMax - oldMin;
-	x = (x - oldMin) / oldDiff;
-	return newMin + x * (newMax - newMin);
+	vec3 uvw = clamp((pos - LightVolumeMin) / (LightVolumeMax - LightVolumeMin), vec3(0.0, 0.0, 0.0), vec3(1.0, 1.0, 1.0));
+	return texture(LightVolume, uvw).x;
 }
 
-float saturate(float x)
+// Distance along the ray to the end of the empty occupancy cell that holds the position, 0 if the cell isn't empty.
+float emptySpaceDistance(vec3 position, vec3 rayDirection)
 {
-	return clamp(x, 0.0, 1.0);
-}
+	vec3 gridSize = OccupancyGridMax - OccupancyGridMin;
+	vec3 uvw      = (position - OccupancyGridMin) / gridSize;
 
-vec2 rayBoxDst(vec3 boundsMin, vec3 boundsMax, vec3 rayOrigin, vec3 rayDirection)
-{
-	vec3 inverseRayDir = 1.0 / rayDirection;
-	vec3 t0 = (boundsMin - rayOrigin) * inverseRayDir;
-	vec3 t1 = (boundsMax - rayOrigin) * inverseRayDir;
+	if (any(lessThan(uvw, vec3(0.0, 0.0, 0.0))) || any(greaterThanEqual(uvw, vec3(1.0, 1.0, 1.0))))
+		return 0.0;
 
-	vec3 tmin = min(t0, t1);
-	vec3 tmax = max(t0, t1);
+	ivec3 cellsCount = textureSize(OccupancyGrid, 0);
+	ivec3 cell       = ivec3(uvw * vec3(cellsCount));
 
-	float distA = max(max(tmin.x, tmin.y), tmin.z);
-	float distB = min(min(tmax.x, tmax.y), tmax.z);
+	if (texelFetch(OccupancyGrid, cell, 0).x > 0.0)
+		return 0.0;
 
-	float distToBox = max(0, distA);
-	float distInsideBox = max(0, distB - distToBox);
+	vec3 cellSize     = gridSize / vec3(cellsCount);
+	vec3 cellExit     = OccupancyGridMin + (vec3(cell) + step(vec3(0.0, 0.0, 0.0), rayDirection)) * cellSize;
+	vec3 exitDistance = (cellExit - position) / rayDirection;
 
-	return vec2(distToBox, distInsideBox);
-}
-
-float sampleDensity(vec3 position)
-{
-	vec3 size = BoundsMax - BoundsMin;
-	vec3 boundsCenter = (BoundsMin + BoundsMax) * 0.5;
-	vec3 uvw = (size * 0.5 + position) * CloudScale;
-	vec3 shapeSamplePos = uvw + CloudOffset;
-
-	float containerEdgeFadeDst = 50;
-	float dstFromEdgeX = min(containerEdgeFadeDst, min(position.x - BoundsMin.x, BoundsMax.x - position.x));
-	float dstFromEdgeZ = min(containerEdgeFadeDst, min(position.z - BoundsMin.z, BoundsMax.z - position.z));
-
-	float edgeWeight = min(dstFromEdgeX, dstFromEdgeZ) / containerEdgeFadeDst;
-
-	vec2 weatherUV = (size.xz * 0.5 + position.xz) / max(size.x, size.z);
-	float weatherMap = texture(WeatherMap, weatherUV).x;
-	float gMin = remap(weatherMap, 0, 1, 0.1, 0.5);
-	float gMax = remap(weatherMap, 0, 1, gMin, 0.9);
-	float heightPercentage = (position.y - BoundsMin.y) / size.y;
-	float heightGradient =  saturate(remap(heightPercentage, 0.0, gMin, 0, 1)) * saturate(remap(heightPercentage, 1, gMax, 0, 1));
-	heightGradient *= edgeWeight;
-
-	vec4 shapeNoise = texture(CloudsDensityTexture, shapeSamplePos);
-	vec4 normalizedShapeWeights = ShapeNoiseWeights / dot(ShapeNoiseWeights, vec4(1.0, 1.0, 1.0, 1.0));
-	float baseShapeRawDensity = dot(shapeNoise, normalizedShapeWeights) * heightGradient;
-	float baseShapeDensity = baseShapeRawDensity + DensityOffset;
-
-	if (baseShapeDensity > 0.0)
-	{
-		vec3 detailSamplePos = uvw * DetailNoiseScale + DetailsOffset;
-		vec4 detailNoise = texture(DetailNoiseTexture, detailSamplePos);
-		vec4 normalizedDetailWeights = DetailNoiseWeights / dot(DetailNoiseWeights, vec4(1.0, 1.0, 1.0, 1.0));
-		float detailRawIntensity = dot(detailNoise, normalizedDetailWeights);
-
-		float oneMinusShape = 1.0 - baseShapeRawDensity;
-		float detailErodeWeight = oneMinusShape * oneMinusShape * oneMinusShape;
-		float cloudDensity = baseShapeDensity - (1 - detailRawIntensity) * detailErodeWeight * DetailNoiseWeight;
-	
-		float finalDensity = cloudDensity * DensityMultiplier;
-		
-		return finalDensity;
-	}
-
-	return 0.0;
-}
-
-float lightMarch(vec3 pos)
-{
-	vec3  toLight = -normalize(LightDirection);
-	float distInsideBox = rayBoxDst(BoundsMin, BoundsMax, pos, toLight).y;
-
-	float stepSize = distInsideBox / float(LightStepsCount);
-	float distanceAccumulated = 0.0;
-	float maxDistance = distInsideBox;
-	float totalDensity = 0.0;
-
-	while (distanceAccumulated < maxDistance)
-	{
-		float density = sampleDensity(pos + toLight * distanceAccumulated);
-		totalDensity += max(0, density * stepSize);
-		distanceAccumulated = distanceAccumulated + stepSize;
-	}
-
-	float transmittance = beer(totalDensity * LightAbsorbtionTowardSun);
-
-	transmittance = DarknessThreshold + transmittance * (1.0 - DarknessThreshold);
-
-	return transmittance;
+	return max(min(min(exitDistance.x, exitDistance.y), exitDistance.z), 0.0);
 }
 
 void main()
 {
-	vec3 sceneColor = texture(SceneTexture, FSInputTexCoords).xyz;
-	vec3 invertedSceneColor = 1.0 - sceneColor;
+	vec2 texCoords = FSInputTexCoords + SampleOffset;
 
-	vec2 normalizeCoords = FSInputTexCoords * 2.0 - vec2(1.0, 1.0);
+	vec2 normalizeCoords = texCoords * 2.0 - vec2(1.0, 1.0);
 	normalizeCoords.x *= AspectRatio;
 	normalizeCoords *= tan(FovY * 0.5) * Near;
 
@@ -181,7 +116,7 @@ void main()
 	rayDirection = (CameraMatrix * vec4(rayDirection, 0.0)).xyz;
 	onCameraPoint = eye + rayDirection;
 
-	vec4 depthColor = texture(DepthTexture, FSInputTexCoords);
+	vec4 depthColor = texture(DepthTexture, texCoords);
 	float depth = linearizeDepth(depthColor.x, Near, Far) * (length(rayDirection) / Near);
 
 	rayDirection = normalize(rayDirection);
@@ -196,6 +131,7 @@ void main()
 
 	float transmittance = 1.0;
 	float lightEnergy = 0.0;
+	float cloudsDistance = -1.0;
 
 	vec3  toLight = -normalize(LightDirection);
 	float sunDot = dot(rayDirection, toLight);
@@ -205,11 +141,26 @@ void main()
 	{
 		vec3 currentPosition = onCameraPoint + rayDirection * (distToBox + distanceAccumulated);
 
+		if (UseOccupancyGrid != 0)
+		{
+			float skipDistance = emptySpaceDistance(currentPosition, rayDirection);
+
+			if (skipDistance > 0.0)
+			{
+				// The small bias moves the position past the cell border.
+				distanceAccumulated += skipDistance + 0.01;
+				continue;
+			}
+		}
+
 		float density = sampleDensity(currentPosition);
 
 		if (density > 0)
 		{
-			float lightTransmittance = lightMarch(currentPosition);
+			if (cloudsDistance < 0.0)
+				cloudsDistance = distToBox + distanceAccumulated;
+
+			float lightTransmittance = UseLightVolume != 0 ? sampleLightVolume(currentPosition) : lightMarch(currentPosition);
 			lightEnergy += density * transmittance * lightTransmittance * RayMarchStepSize * phaseVal;
 
 			transmittance *= exp(-density * RayMarchStepSize * LightAbsorptionThroughCloud);
@@ -221,6 +172,18 @@ void main()
 		distanceAccumulated += RayMarchStepSize;
 	}
 
+	if (OutputCloudsData != 0)
+	{
+		// Rays that don't hit any cloud are reprojected from the middle of their path through the box.
+		if (cloudsDistance < 0.0)
+			cloudsDistance = distToBox + max(maxDistance, 0.0) * 0.5;
+
+		FSOutFragColor = vec4(lightEnergy, transmittance, depth, cloudsDistance);
+		return;
+	}
+
+	vec3 sceneColor = texture(SceneTexture, texCoords).xyz;
+
 	float focusedEyeCos = pow(clamp(sunDot, 0.0, 1.0), FocusedEyeSunExponent);
 	float sun = clamp(hg(focusedEyeCos, 0.9995), 0.0, 1.0) * transmittance;
 
@@ -0,0 +1,108 @@
+#version 430 core
+
+in vec2 FSInputTexCoords;
+
+uniform sampler2D SceneTexture;
+uniform sampler2D DepthTexture;
+uniform sampler2D CloudsTexture;
+
+uniform mat4      CameraMatrix;
+uniform float     AspectRatio;
+uniform float     Near;
+uniform float     Far;
+uniform float     DepthRangeSplit;
+uniform float     FarRangeNear;
+uniform float     FarRangeFar;
+uniform float     FovY;
+
+uniform vec2      CloudsTexelSize;
+
+uniform vec4      DiffuseColor;
+uniform vec3      LightDirection;
+uniform int       FocusedEyeSunExponent;
+
+uniform int       UseGammaCorrection;
+
+out vec4 FSOutFragColor;
+
+float linearizeDepth(float d,float zNear,float zFar)
+{
+    // The far terrain is drawn with its own projection, in the upper part of the depth range.
+    if (d >= DepthRangeSplit && DepthRangeSplit < 1.0)
+    {
+        d     = (d - DepthRangeSplit) / (1.0 - DepthRangeSplit);
+        zNear = FarRangeNear;
+        zFar  = FarRangeFar;
+    }
+    else
+        d /= DepthRangeSplit;
+
+    float z_n = 2.0 * d - 1.0;
+    return 2.0 * zNear * zFar / (zFar + zNear - z_n * (zFar - zNear));
+}
+
+float hg(float a, float g) 
+{
+    float g2 = g*g;
+    return (1-g2) / (4*3.1415*pow(1+g2-2*g*(a), 1.5));
+}
+
+void main()
+{
+	vec3 sceneColor = texture(SceneTexture, FSInputTexCoords).xyz;
+
+	vec2 normalizeCoords = FSInputTexCoords * 2.0 - vec2(1.0, 1.0);
+	normalizeCoords.x *= AspectRatio;
+	normalizeCoords *= tan(FovY * 0.5) * Near;
+
+	vec3 rayDirection = (CameraMatrix * vec4(normalizeCoords.x, normalizeCoords.y, -Near, 0.0)).xyz;
+
+	float depth = linearizeDepth(texture(DepthTexture, FSInputTexCoords).x, Near, Far) * (length(rayDirection) / Near);
+
+	rayDirection = normalize(rayDirection);
+
+	// Bilinear upsample of the low resolution clouds, where the texels that saw
+	// a different surface than this pixel (e.g. across a mountain silhouette) get a lower weight.
+	vec2 lowResolutionPosition = FSInputTexCoords / CloudsTexelSize - vec2(0.5, 0.5);
+	vec2 basePosition          = floor(lowResolutionPosition);
+	vec2 fraction              = lowResolutionPosition - basePosition;
+
+	vec2  cloudsData  = vec2(0.0, 0.0);
+	float totalWeight = 0.0;
+
+	for (int i = 0; i < 4; i++)
+	{
+		vec2 offset  = vec2(i % 2, i / 2);
+		vec4 texel   = textureLod(CloudsTexture, (basePosition + offset + vec2(0.5, 0.5)) * CloudsTexelSize, 0.0);
+
+		vec2  bilinear    = mix(vec2(1.0, 1.0) - fraction, fraction, offset);
+		float depthWeight = 1.0 / (abs(texel.z - depth) / max(depth, 0.001) + 0.01);
+		float weight      = bilinear.x * bilinear.y * depthWeight;
+
+		cloudsData  += texel.xy * weight;
+		totalWeight += weight;
+	}
+
+	cloudsData /= max(totalWeight, 0.00001);
+
+	float lightEnergy   = cloudsData.x;
+	float transmittance = cloudsData.y;
+
+	vec3  toLight = -normalize(LightDirection);
+	float sunDot = dot(rayDirection, toLight);
+
+	float focusedEyeCos = pow(clamp(sunDot, 0.0, 1.0), FocusedEyeSunExponent);
+	float sun = clamp(hg(focusedEyeCos, 0.9995), 0.0, 1.0) * transmittance;
+
+	vec3 cloudCol = lightEnergy * DiffuseColor.xyz;
+	vec3 col = (sceneColor * transmittance) + cloudCol;
+	col = clamp(col, 0.0, 1.0) * (1 - sun) + DiffuseColor.xyz * sun;
+
+	FSOutFragColor = vec4(col, 1.0);
+
+	if (UseGammaCorrection != 0)
+	{
+		float gamma = 2.2;
+		FSOutFragColor.rgb = pow(FSOutFragColor.rgb, vec3(1.0/gamma));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+// The cloud density and the light march toward the sun, shared by the raymarch (Clouds.frag) and
+// the light volume bake (CloudsLightVolume.comp) so that both see the same clouds in the same box.
+// Included after the #version line, the uniforms are set by Clouds::SetDensityParameters.
+
+uniform sampler3D CloudsDensityTexture;
+uniform sampler3D DetailNoiseTexture;
+uniform sampler2D WeatherMap;
+
+uniform vec3      BoundsMin;
+uniform vec3      BoundsMax;
+
+uniform vec3      CloudScale;
+uniform float     DetailNoiseScale;
+uniform vec3      CloudOffset;
+uniform vec3      DetailsOffset;
+uniform float     DensityMultiplier;
+uniform float     DarknessThreshold;
+uniform float     DensityOffset;
+uniform vec4      ShapeNoiseWeights;
+uniform vec4      DetailNoiseWeights;
+uniform float     LightAbsorbtionTowardSun;
+uniform float     DetailNoiseWeight;
+
+uniform vec3      LightDirection;
+uniform int       LightStepsCount;
+
+float beer(float d)
+{
+	return exp(-d);
+}
+
+float remap(float x, float oldMin, float oldMax, float newMin, float newMax)
+{
+    float oldDiff = oldMax - oldMin;
+	x = (x - oldMin) / oldDiff;
+	return newMin + x * (newMax - newMin);
+}
+
+float saturate(float x)
+{
+	return clamp(x, 0.0, 1.0);
+}
+
+vec2 rayBoxDst(vec3 boundsMin, vec3 boundsMax, vec3 rayOrigin, vec3 rayDirection)
+{
+	vec3 inverseRayDir = 1.0 / rayDirection;
+	vec3 t0 = (boundsMin - rayOrigin) * inverseRayDir;
+	vec3 t1 = (boundsMax - rayOrigin) * inverseRayDir;
+
+	vec3 tmin = min(t0, t1);
+	vec3 tmax = max(t0, t1);
+
+	float distA = max(max(tmin.x, tmin.y), tmin.z);
+	float distB = min(min(tmax.x, tmax.y), tmax.z);
+
+	float distToBox = max(0, distA);
+	float distInsideBox = max(0, distB - distToBox);
+
+	return vec2(distToBox, distInsideBox);
+}
+
+float sampleDensity(vec3 position)
+{
+	vec3 size = BoundsMax - BoundsMin;
+	vec3 boundsCenter = (BoundsMin + BoundsMax) * 0.5;
+	vec3 uvw = (size * 0.5 + position) * CloudScale;
+	vec3 shapeSamplePos = uvw + CloudOffset;
+
+	float containerEdgeFadeDst = 50;
+	float dstFromEdgeX = min(containerEdgeFadeDst, min(position.x - BoundsMin.x, BoundsMax.x - position.x));
+	float dstFromEdgeZ = min(containerEdgeFadeDst, min(position.z - BoundsMin.z, BoundsMax.z - position.z));
+
+	float edgeWeight = min(dstFromEdgeX, dstFromEdgeZ) / containerEdgeFadeDst;
+
+	vec2 weatherUV = (size.xz * 0.5 + position.xz) / max(size.x, size.z);
+	float weatherMap = texture(WeatherMap, weatherUV).x;
+	float gMin = remap(weatherMap, 0, 1, 0.1, 0.5);
+	float gMax = remap(weatherMap, 0, 1, gMin, 0.9);
+	float heightPercentage = (position.y - BoundsMin.y) / size.y;
+	float heightGradient =  saturate(remap(heightPercentage, 0.0, gMin, 0, 1)) * saturate(remap(heightPercentage, 1, gMax, 0, 1));
+	heightGradient *= edgeWeight;
+
+	vec4 shapeNoise = texture(CloudsDensityTexture, shapeSamplePos);
+	vec4 normalizedShapeWeights = ShapeNoiseWeights / dot(ShapeNoiseWeights, vec4(1.0, 1.0, 1.0, 1.0));
+	float baseShapeRawDensity = dot(shapeNoise, normalizedShapeWeights) * heightGradient;
+	float baseShapeDensity = baseShapeRawDensity + DensityOffset;
+
+	if (baseShapeDensity > 0.0)
+	{
+		vec3 detailSamplePos = uvw * DetailNoiseScale + DetailsOffset;
+		vec4 detailNoise = texture(DetailNoiseTexture, detailSamplePos);
+		vec4 normalizedDetailWeights = DetailNoiseWeights / dot(DetailNoiseWeights, vec4(1.0, 1.0, 1.0, 1.0));
+		float detailRawIntensity = dot(detailNoise, normalizedDetailWeights);
+
+		float oneMinusShape = 1.0 - baseShapeRawDensity;
+		float detailErodeWeight = oneMinusShape * oneMinusShape * oneMinusShape;
+		float cloudDensity = baseShapeDensity - (1 - detailRawIntensity) * detailErodeWeight * DetailNoiseWeight;
+	
+		float finalDensity = cloudDensity * DensityMultiplier;
+		
+		return finalDensity;
+	}
+
+	return 0.0;
+}
+
+float lightMarch(vec3 pos)
+{
+	vec3  toLight = -normalize(LightDirection);
+	float distInsideBox = rayBoxDst(BoundsMin, BoundsMax, pos, toLight).y;
+
+	float stepSize = distInsideBox / float(LightStepsCount);
+	float distanceAccumulated = 0.0;
+	float maxDistance = distInsideBox;
+	float totalDensity = 0.0;
+
+	while (distanceAccumulated < maxDistance)
+	{
+		float density = sampleDensity(pos + toLight * distanceAccumulated);
+		totalDensity += max(0, density * stepSize);
+		distanceAccumulated = distanceAccumulated + stepSize;
+	}
+
+	float transmittance = beer(totalDensity * LightAbsorbtionTowardSun);
+
+	transmittance = DarknessThreshold + transmittance * (1.0 - DarknessThreshold);
+
+	return transmittance;
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#version 430 core
+
+in vec2 FSInputTexCoords;
+
+uniform sampler2D CurrentTexture;
+uniform sampler2D HistoryTexture;
+
+uniform mat4      CameraMatrix;
+uniform mat4      PreviousViewProjection;
+uniform float     AspectRatio;
+uniform float     Near;
+uniform float     FovY;
+
+uniform vec2      TexelSize;
+uniform float     HistoryWeight;
+uniform int       HistoryValid;
+
+out vec4 FSOutFragColor;
+
+void main()
+{
+	vec4 current = texture(CurrentTexture, FSInputTexCoords);
+
+	FSOutFragColor = current;
+
+	if (HistoryValid == 0)
+		return;
+
+	vec2 normalizeCoords = FSInputTexCoords * 2.0 - vec2(1.0, 1.0);
+	normalizeCoords.x *= AspectRatio;
+	normalizeCoords *= tan(FovY * 0.5) * Near;
+
+	vec3 eye = (CameraMatrix * vec4(0.0, 0.0, 0.0, 1.0)).xyz;
+	vec3 rayDirection = normalize((CameraMatrix * vec4(normalizeCoords.x, normalizeCoords.y, -Near, 0.0)).xyz);
+
+	// Find where the clouds seen through this pixel were on the screen in the previous frame.
+	vec3 cloudsPosition = eye + rayDirection * current.w;
+	vec4 previousClipCoords = PreviousViewProjection * vec4(cloudsPosition, 1.0);
+
+	if (previousClipCoords.w <= 0.0)
+		return;
+
+	vec2 previousTexCoords = previousClipCoords.xy / previousClipCoords.w * 0.5 + 0.5;
+
+	if (any(lessThan(previousTexCoords, vec2(0.0, 0.0))) || any(greaterThan(previousTexCoords, vec2(1.0, 1.0))))
+		return;
+
+	vec4 history = texture(HistoryTexture, previousTexCoords);
+
+	// The history is clamped to the current neighbourhood, so the clouds don't leave trails behind.
+	vec2 neighbourhoodMin = current.xy;
+	vec2 neighbourhoodMax = current.xy;
+
+	for (int y = -1; y <= 1; y++)
+	{
+		for (int x = -1; x <= 1; x++)
+		{
+			vec2 neighbour = texture(CurrentTexture, FSInputTexCoords + vec2(x, y) * TexelSize).xy;
+
+			neighbourhoodMin = min(neighbourhoodMin, neighbour);
+			neighbourhoodMax = max(neighbourhoodMax, neighbour);
+		}
+	}
+
+	history.xy = clamp(history.xy, neighbourhoodMin, neighbourhoodMax);
+
+	// Reject the history where the geometry in front of the clouds changed.
+	float depthChange = abs(history.z - current.z) / max(current.z, 0.001);
+	float weight      = depthChange < 0.1 ? HistoryWeight : 0.0;
+
+	FSOutFragColor = vec4(mix(current.xy, history.xy, weight), current.zw);
+}
\ No newline at end of file
@@ -14,6 +14,8 @@ uniform float TerrainWidth;
 uniform float GridWidth;
 uniform float GridHeight;
 uniform float TerrainAmplitude;
+uniform float HeightScale;
+uniform float HeightBias;
 
 uniform vec4  ClipPlane;
 
@@ -37,7 +39,7 @@ vec3 get3Dcoord(vec2 pos)
 {
     vec2 uv = getUv(pos);
 
-    float h = texture(NoiseTexture, uv).x;
+    float h = texture(NoiseTexture, uv).x * HeightScale + HeightBias;
     return vec3(pos.x, h * TerrainAmplitude, pos.y);
 }
 
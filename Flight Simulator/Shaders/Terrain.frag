@@ -1,7 +1,5 @@
 #version 430 core
 
-#define TERRAIN_MATERIALS_COUNT 6
-
 in vec3 FSInputWorldPosition;
 in vec2 FSInputTexCoords;
 in vec2 FSInputBiomeData;
@@ -21,20 +19,28 @@ uniform vec3 CameraPosition;
 
 uniform int BiomesCount;
 uniform int MaterialsPerBiome;
+uniform int TerrainMaterialsCount;
 
 uniform sampler2D BiomeMaterialsTexture;
 
-uniform sampler2D TerrainTextures[TERRAIN_MATERIALS_COUNT];
-uniform sampler2D TerrainNormalTextures[TERRAIN_MATERIALS_COUNT];
-uniform sampler2D TerrainSpecularTextures[TERRAIN_MATERIALS_COUNT];
+uniform sampler2DArray TerrainTextures;
+uniform sampler2DArray TerrainNormalTextures;
+uniform sampler2DArray TerrainSpecularTextures;
+
+uniform int       ExcludeResidentChunks; // set for the long-range terrain, which isn't drawn under the chunks
+uniform sampler2D ResidentChunksTexture;
+uniform vec2      ResidentChunksOrigin;
+uniform float     ResidentChunksSize;
 
 out vec4 FSOutFragColor;
 
 void sampleMaterial(int materialIndex, out vec4 texColor, out vec3 normal, out float specularStrength)
 {
-    texColor          = texture(TerrainTextures[materialIndex],         FSInputTexCoords);
-    normal            = texture(TerrainNormalTextures[materialIndex],   FSInputTexCoords).rgb;
-    specularStrength  = texture(TerrainSpecularTextures[materialIndex], FSInputTexCoords).r;
+    vec3 texCoords    = vec3(FSInputTexCoords, materialIndex);
+
+    texColor          = texture(TerrainTextures,         texCoords);
+    normal            = texture(TerrainNormalTextures,   texCoords).rgb;
+    specularStrength  = texture(TerrainSpecularTextures, texCoords).r;
 
     normal           *= 2.0f;
     normal           -= vec3(1.0, 1.0, 1.0);
@@ -73,7 +79,7 @@ void sampleMaterialCombined(out vec4 texColor, out vec3 normal, out float specul
     
     stepsGradient(MaterialsPerBiome, FSInputBiomeData.y, materialOrderIndex, materialOrderPercentage);
 
-    float materialsCount          = TERRAIN_MATERIALS_COUNT - 1;
+    float materialsCount          = TerrainMaterialsCount - 1;
     vec2  inputBiomeData          = vec2(float(biomeIndex)         / float(BiomesCount       - 1), 
                                          float(materialOrderIndex) / float(MaterialsPerBiome - 1)) * 
                                     vec2(1.0 - 1.0 / float(BiomesCount), 
@@ -108,8 +114,21 @@ void sampleMaterialCombined(out vec4 texColor, out vec3 normal, out float specul
     specularStrength     = mix(bottomSpecular, topSpecular, materialOrderPercentage);
 }
 
+bool isUnderResidentChunk(vec2 position)
+{
+    vec2 uv = (position - ResidentChunksOrigin) / ResidentChunksSize;
+
+    if (any(lessThan(uv, vec2(0.0, 0.0))) || any(greaterThanEqual(uv, vec2(1.0, 1.0))))
+        return false;
+
+    return texture(ResidentChunksTexture, uv).r > 0.5;
+}
+
 void main()
 {
+    if (ExcludeResidentChunks != 0 && isUnderResidentChunk(FSInputWorldPosition.xz))
+        discard;
+
     vec4 textureColor;
 
     vec3 normalData;
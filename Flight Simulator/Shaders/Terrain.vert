@@ -2,20 +2,118 @@
 layout (location = 0) in vec3 VSInputPosition;
 layout (location = 1) in vec2 VSInputTexCoords;
 layout (location = 2) in vec4 VSInputZoneRange;
+layout (location = 3) in vec2 VSInputMorphRange;
 
 uniform mat4 Model;
+uniform mat4 View;
+uniform mat4 Projection;
 
-out vec3 TCSInputWorldPosition;
-out vec3 TCSInputPosition;
-out vec2 TCSInputTexCoords;
+uniform vec3 CameraPosition;
+
+uniform float TerrainWidth;
+uniform float GridWidth;
+uniform float GridHeight;
+uniform float TerrainAmplitude;
+uniform float TexCoordsMultiplier;
+
+// The heights are quantized per chunk, height = texel * HeightScale + HeightBias.
+uniform float HeightScale;
+uniform float HeightBias;
+
+uniform sampler2D HeightTexture;
+uniform sampler2D BiomeTexture;
+
+uniform vec4 ClipPlane;
+
+out vec3 FSInputWorldPosition;
+out vec2 FSInputTexCoords;
+out vec2 FSInputBiomeData;
+
+out vec3 FSInputNormal;
+out vec3 FSInputBinormal;
+out vec3 FSInputTangent;
+
+vec2 getUv(vec2 pos)
+{
+    pos = (pos / TerrainWidth);
+    pos = vec2(pos.x * GridWidth, pos.y * GridHeight);
+    vec2 uv = vec2(pos.x + (GridWidth / 2.0), pos.y + (GridHeight / 2.0));
+    uv = vec2(uv.x / GridWidth, uv.y / GridHeight);
+    
+    return uv;
+}
+
+vec3 get3Dcoord(vec2 pos)
+{
+    vec2 uv = getUv(pos);
+
+    float h = texture(HeightTexture, uv).x * HeightScale + HeightBias;
+    return vec3(pos.x, h * TerrainAmplitude, pos.y);
+}
+
+void calculateNormal(vec3 currentPos, out vec3 normal, out vec3 binormal, out vec3 tangent)
+{
+    float offset     = 1.0 / 32.0;
+
+    vec2  posx       = currentPos.xz + vec2(offset, 0.0);
+    vec2  posxneg    = currentPos.xz - vec2(offset, 0.0);
+    vec2  posy       = currentPos.xz + vec2(0.0,    offset);
+    vec2  posyneg    = currentPos.xz - vec2(0.0,    offset);
+
+          currentPos = get3Dcoord(currentPos.xz);
+    vec3  right      = get3Dcoord(posx);
+    vec3  left       = get3Dcoord(posxneg);
+    vec3  top        = get3Dcoord(posy);
+    vec3  bottom     = get3Dcoord(posyneg);
+                    
+          tangent    = normalize(right - left);
+          binormal   = normalize(top - bottom);
+          normal     = normalize(cross(binormal, tangent));
+}
+
+vec2 calculateBiome(vec2 pos, float height)
+{
+    vec2 uv = getUv(pos);
+
+    float texColor = texture(BiomeTexture, uv).x;
+
+    return vec2(texColor, (height / TerrainAmplitude));
+}
+
+// Moves the odd vertices of the patch grid over their even neighbours, so at the end of the
+// morph range the patch has exactly the vertices of the coarser quadtree level.
+vec2 morphVertex(vec2 gridPosition, float morphFactor)
+{
+    vec2 gridDimensions = vec2(GridWidth, GridHeight);
+    vec2 fraction       = fract(gridPosition * gridDimensions * 0.5) * 2.0 / gridDimensions;
+
+    return gridPosition - fraction * morphFactor;
+}
 
 void main()
 {
-    vec2 bottomLeft       = VSInputZoneRange.xy;
-    vec2 topRight         = VSInputZoneRange.zw;
+    vec2  bottomLeft     = VSInputZoneRange.xy;
+    vec2  topRight       = VSInputZoneRange.zw;
+
+    vec2  inputPosition  = bottomLeft + VSInputPosition.xz * (topRight - bottomLeft);
+    vec3  worldPosition  = (Model * vec4(get3Dcoord(inputPosition), 1.0)).xyz;
+
+    float morphFactor    = clamp((distance(worldPosition, CameraPosition) - VSInputMorphRange.x) / 
+                                 (VSInputMorphRange.y - VSInputMorphRange.x), 0.0, 1.0);
+
+    vec2  rawPosition    = bottomLeft + morphVertex(VSInputPosition.xz, morphFactor) * (topRight - bottomLeft);
+    vec3  position       = get3Dcoord(rawPosition);
+
+          worldPosition  = (Model * vec4(position, 1.0)).xyz;
+
+    FSInputBiomeData     = calculateBiome(rawPosition, position.y);
+    FSInputWorldPosition = worldPosition;
+
+    gl_ClipDistance[0]   = dot(ClipPlane, vec4(FSInputWorldPosition, 1.0));
+
+    // The texture coordinates follow the chunk space, so they don't depend on the size of the patch.
+    FSInputTexCoords     = rawPosition * TexCoordsMultiplier;
+    gl_Position          = Projection * View * vec4(worldPosition, 1.0);
 
-    vec2 inputPosition    = bottomLeft + VSInputPosition.xz * (topRight - bottomLeft);
-    TCSInputWorldPosition = (Model * (vec4(inputPosition.x, VSInputPosition.y, inputPosition.y, 1.0))).xyz;
-    TCSInputPosition      = vec3(inputPosition.x, VSInputPosition.y, inputPosition.y);
-    TCSInputTexCoords     = VSInputTexCoords;
+    calculateNormal(position, FSInputNormal, FSInputBinormal, FSInputTangent);
 }
\ No newline at end of file
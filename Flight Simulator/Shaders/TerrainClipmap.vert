@@ -0,0 +1,82 @@
+#version 430 core
+layout (location = 0) in vec2 VSInputGridPosition;
+
+uniform mat4 View;
+uniform mat4 Projection;
+
+uniform vec2  LevelOrigin;     // world position of the first grid vertex
+uniform vec2  LevelCenter;
+uniform float LevelSpacing;
+uniform float GridCells;
+uniform float TransitionCells;
+uniform int   HasCoarserLevel;
+uniform float ClipmapSize;
+
+uniform float TerrainAmplitude;
+uniform float WaterLevel;
+uniform float TexCoordsMultiplier;
+
+uniform sampler2D HeightTexture;
+uniform sampler2D CoarserHeightTexture;
+
+uniform vec4 ClipPlane;
+
+out vec3 FSInputWorldPosition;
+out vec2 FSInputTexCoords;
+out vec2 FSInputBiomeData;
+
+out vec3 FSInputNormal;
+out vec3 FSInputBinormal;
+out vec3 FSInputTangent;
+
+vec2 sampleLevel(sampler2D levelTexture, vec2 position, float spacing)
+{
+    // The textures repeat, so the toroidally stored texels are read at their world coordinates.
+    return texture(levelTexture, (position / spacing + 0.5) / ClipmapSize).xy;
+}
+
+// Near the outer border the level blends into the coarser one, so its border vertices lie
+// exactly on the edges of the coarser ring around it.
+vec2 sampleTerrain(vec2 position, float transition)
+{
+    vec2 data = sampleLevel(HeightTexture, position, LevelSpacing);
+
+    if (HasCoarserLevel != 0)
+        data = mix(data, sampleLevel(CoarserHeightTexture, position, LevelSpacing * 2.0), transition);
+
+    return data;
+}
+
+// The distant water isn't drawn, the terrain under it is flattened at the water level instead.
+float getHeight(vec2 position, float transition)
+{
+    return max(sampleTerrain(position, transition).x * TerrainAmplitude, WaterLevel);
+}
+
+void main()
+{
+    vec2  position       = LevelOrigin + VSInputGridPosition * LevelSpacing;
+    vec2  toCenter       = abs(position - LevelCenter) / LevelSpacing;
+
+    float transition     = clamp((max(toCenter.x, toCenter.y) - (GridCells * 0.5 - TransitionCells)) / TransitionCells, 0.0, 1.0);
+
+    vec2  terrainData    = sampleTerrain(position, transition);
+    vec3  worldPosition  = vec3(position.x, max(terrainData.x * TerrainAmplitude, WaterLevel), position.y);
+
+    float right          = getHeight(position + vec2(LevelSpacing, 0.0), transition);
+    float left           = getHeight(position - vec2(LevelSpacing, 0.0), transition);
+    float top            = getHeight(position + vec2(0.0, LevelSpacing), transition);
+    float bottom         = getHeight(position - vec2(0.0, LevelSpacing), transition);
+
+    FSInputTangent       = normalize(vec3(2.0 * LevelSpacing, right - left, 0.0));
+    FSInputBinormal      = normalize(vec3(0.0, top - bottom, 2.0 * LevelSpacing));
+    FSInputNormal        = normalize(cross(FSInputBinormal, FSInputTangent));
+
+    FSInputBiomeData     = terrainData.yx;
+    FSInputWorldPosition = worldPosition;
+
+    gl_ClipDistance[0]   = dot(ClipPlane, vec4(FSInputWorldPosition, 1.0));
+
+    FSInputTexCoords     = position * TexCoordsMultiplier;
+    gl_Position          = Projection * View * vec4(worldPosition, 1.0);
+}
\ No newline at end of file
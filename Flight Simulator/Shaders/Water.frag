@@ -1,5 +1,4 @@
 #version 430 core
-#define MODEL_MATERIALS_COUNT 1
 
 in vec2 FSInputTexCoords;
 in vec4 FSInputReflectionPosition;
@@ -14,9 +13,9 @@ uniform sampler2D ReflectionTexture;
 uniform sampler2D RefractionDepthTexture;
 uniform sampler2D ReflectionDepthTexture;
 
-uniform sampler2D WaterTextures[MODEL_MATERIALS_COUNT];
-uniform sampler2D WaterNormalTextures[MODEL_MATERIALS_COUNT];
-uniform sampler2D WaterSpecularTextures[MODEL_MATERIALS_COUNT];
+uniform sampler2DArray WaterTextures;
+uniform sampler2DArray WaterNormalTextures;
+uniform sampler2DArray WaterSpecularTextures;
 
 uniform float FadeWaterDepth;
 			  
@@ -32,11 +31,24 @@ uniform mediump vec3 CameraPosition;
 
 uniform float Near;
 uniform float Far;
+uniform float DepthRangeSplit;
+uniform float FarRangeNear;
+uniform float FarRangeFar;
 
 out vec4 FSOutFragColor;
 
 float linearizeDepth(float d,float zNear,float zFar)
 {
+    // The far terrain is drawn with its own projection, in the upper part of the depth range.
+    if (d >= DepthRangeSplit && DepthRangeSplit < 1.0)
+    {
+        d     = (d - DepthRangeSplit) / (1.0 - DepthRangeSplit);
+        zNear = FarRangeNear;
+        zFar  = FarRangeFar;
+    }
+    else
+        d /= DepthRangeSplit;
+
     float z_n = 2.0 * d - 1.0;
     return 2.0 * zNear * zFar / (zFar + zNear - z_n * (zFar - zNear));
 }
@@ -59,17 +71,23 @@ void main()
 
 	vec2 clipTexCoords    = mix(realClipCoords, alteredClipCoords, disturbance);
 	vec2 refractTexCoords = clipTexCoords;
+
+	// The refraction may come from the full scene, don't let the distortion pick up geometry in front of the water.
+	float distortedDepth = min(linearizeDepth(texture(RefractionDepthTexture, refractTexCoords).x, Near, Far),
+	                           linearizeDepth(texture(ReflectionDepthTexture, refractTexCoords).x, Near, Far));
+	if (distortedDepth < currentDepth)
+		refractTexCoords = realClipCoords;
 	vec2 reflectTexCoords = vec2(clipTexCoords.x, 1.0 - clipTexCoords.y);
 
 	float finalAlpha = clamp(depthDifference / FadeWaterDepth, 0, 1);
 	
 	vec2 displacedTexCoords = FSInputTexCoords;
 
-	vec3 normalData       = texture(WaterNormalTextures[0], displacedTexCoords).rgb * 2.0 - vec3(1.0, 1.0, 1.0);
+	vec3 normalData       = texture(WaterNormalTextures, vec3(displacedTexCoords, 0.0)).rgb * 2.0 - vec3(1.0, 1.0, 1.0);
 	vec3 normal = (FSInputTangent * normalData.x) + (FSInputBinormal * normalData.y) + (FSInputNormal * normalData.z);
 	FSOutFragColor = AmbientColor;
 
-	float specularStrength  = texture(WaterSpecularTextures[0], displacedTexCoords).r;
+	float specularStrength  = texture(WaterSpecularTextures, vec3(displacedTexCoords, 0.0)).r;
 	
 	vec4 refractionColor = texture(RefractionTexture, refractTexCoords);
 	vec4 reflectionColor = texture(ReflectionTexture, reflectTexCoords);
@@ -80,7 +98,7 @@ void main()
 	reflectiveness = pow(reflectiveness, ReflectivePower);
 
 	vec4 albedo = mix(refractionColor, reflectionColor, clamp(1.0 - reflectiveness, 0.0, 1.0));
-	albedo = mix(albedo, texture(WaterTextures[0], displacedTexCoords), TextureMultiplier);
+	albedo = mix(albedo, texture(WaterTextures, vec3(displacedTexCoords, 0.0)), TextureMultiplier);
 
 	vec3 lightDir = normalize(-LightDirection);
     float lightIntensity = clamp(dot(normal, lightDir), 0.0, 1.0);
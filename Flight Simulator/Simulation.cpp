@@ -0,0 +1,130 @@
+#include <glm/gtc/constants.hpp>
+
+#include "Simulation.h"
+#include "Camera.h"
+#include "Profiler.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace glm;
+
+const double Simulation::FIXED_TIME_STEP          = 1.0 / 120.0; // seconds
+const float  Simulation::CAMERA_MOVE_SPEED        = 10.0f;
+const float  Simulation::CAMERA_ROTATE_SPEED      = 0.001f;
+const float  Simulation::MINIMUM_TRANSLATION_BIAS = 0.01f;
+
+Simulation::Simulation(const vec3& cameraPosition, const vec3& cameraRotation) :
+	m_startTime(steady_clock::now()),
+	m_running(true)
+{
+	m_input.MouseMoveDiff = vec2(0.0f, 0.0f);
+	m_input.Translation   = vec3(0.0f, 0.0f, 0.0f);
+
+	m_state.Time           = 0.0;
+	m_state.CameraPosition = cameraPosition;
+	m_state.CameraRotation = cameraRotation;
+
+	// Published before the thread starts, so the render thread always finds a state.
+	m_snapshots.GetBack().Previous = m_state;
+	m_snapshots.GetBack().Current  = m_state;
+	m_snapshots.Publish();
+
+	m_thread = thread(&Simulation::Run, this);
+}
+
+Simulation::~Simulation()
+{
+	m_running = false;
+
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+void Simulation::AddInput(const vec2& mouseMoveDiff, const vec3& translation)
+{
+	lock_guard<mutex> lock(m_inputMutex);
+
+	m_input.MouseMoveDiff += mouseMoveDiff;
+	m_input.Translation    = translation;
+}
+
+// The render thread is one step behind the simulation, so it always has the two states
+// around the time it shows.
+Simulation::State Simulation::GetInterpolatedState()
+{
+	const Snapshot& snapshot   = m_snapshots.GetFront();
+
+	double          renderTime = Now() - FIXED_TIME_STEP;
+	double          stepTime   = snapshot.Current.Time - snapshot.Previous.Time;
+	float           alpha      = stepTime > 0.0 ? (float)glm::clamp((renderTime - snapshot.Previous.Time) / stepTime, 0.0, 1.0) : 1.0f;
+
+	State state;
+
+	state.Time           = snapshot.Previous.Time + stepTime * alpha;
+	state.CameraPosition = mix(snapshot.Previous.CameraPosition, snapshot.Current.CameraPosition, alpha);
+	state.CameraRotation = mix(snapshot.Previous.CameraRotation, snapshot.Current.CameraRotation, alpha);
+
+	return state;
+}
+
+double Simulation::Now() const
+{
+	return duration<double>(steady_clock::now() - m_startTime).count();
+}
+
+void Simulation::Run()
+{
+	Profiler::GetInstance()->SetThreadName("Simulation thread");
+
+	while (m_running)
+	{
+		double currentTime = Now();
+		int    stepsCount  = 0;
+
+		while (m_state.Time + FIXED_TIME_STEP <= currentTime && stepsCount < MAX_STEPS_PER_UPDATE)
+		{
+			State previousState = m_state;
+
+			Step(FIXED_TIME_STEP);
+			stepsCount++;
+
+			Snapshot& snapshot = m_snapshots.GetBack();
+			snapshot.Previous  = previousState;
+			snapshot.Current   = m_state;
+			m_snapshots.Publish();
+		}
+
+		if (stepsCount == MAX_STEPS_PER_UPDATE)
+			m_state.Time = std::max(m_state.Time, currentTime - FIXED_TIME_STEP);
+
+		this_thread::sleep_for(duration<double>(m_state.Time + FIXED_TIME_STEP - Now()));
+	}
+}
+
+void Simulation::Step(double timeStep)
+{
+	ProfileZone profileZone("Simulation::Step");
+
+	Input input;
+
+	{
+		lock_guard<mutex> lock(m_inputMutex);
+
+		input                 = m_input;
+		m_input.MouseMoveDiff = vec2(0.0f, 0.0f);
+	}
+
+	m_state.Time += timeStep;
+
+	m_state.CameraRotation.x += input.MouseMoveDiff.y * CAMERA_ROTATE_SPEED;
+	m_state.CameraRotation.y += input.MouseMoveDiff.x * CAMERA_ROTATE_SPEED;
+	m_state.CameraRotation.x  = glm::clamp(m_state.CameraRotation.x, -half_pi<float>(), half_pi<float>());
+
+	if (length(input.Translation) < MINIMUM_TRANSLATION_BIAS)
+		return;
+
+	vec4 transformedTranslation = vec4(input.Translation, 0.0f) * Camera::GetRotationMatrix(m_state.CameraRotation);
+	vec4 normalizedTranslation  = normalize(transformedTranslation);
+
+	m_state.CameraPosition += vec3(normalizedTranslation.x, normalizedTranslation.y, normalizedTranslation.z) * (float)timeStep * CAMERA_MOVE_SPEED;
+}
\ No newline at end of file
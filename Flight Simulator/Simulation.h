@@ -0,0 +1,84 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <glm/glm.hpp>
+
+#include "TripleBuffer.h"
+
+// Runs the flight on its own thread, at a fixed time step measured with a double precision
+// monotonic clock. Every step publishes the previous and the current state through a triple
+// buffer; the render thread shows them interpolated one step behind, so a slow frame doesn't
+// slow down the simulation and a slow step doesn't stall the rendering.
+class Simulation
+{
+public:
+
+	struct State
+	{
+	public:
+
+		double    Time;           // in seconds, on the simulation clock
+		glm::vec3 CameraPosition;
+		glm::vec3 CameraRotation; // pitch, yaw, roll
+	};
+
+	struct Input
+	{
+	public:
+
+		glm::vec2 MouseMoveDiff;  // accumulated until the next step consumes it
+		glm::vec3 Translation;    // the movement keys, in camera space
+	};
+
+private:
+
+	static const double FIXED_TIME_STEP;
+	static const int    MAX_STEPS_PER_UPDATE = 8; // the simulation drops the time it can't catch up with
+
+	static const float  CAMERA_MOVE_SPEED;
+	static const float  CAMERA_ROTATE_SPEED;
+	static const float  MINIMUM_TRANSLATION_BIAS;
+
+	struct Snapshot
+	{
+	public:
+
+		State Previous;
+		State Current;
+	};
+
+public:
+
+	Simulation(const glm::vec3&, const glm::vec3&);
+	~Simulation();
+
+	Simulation(const Simulation&)     = delete;
+	void operator=(const Simulation&) = delete;
+
+	// Called by the render thread.
+	void   AddInput(const glm::vec2&, const glm::vec3&);
+	State  GetInterpolatedState();
+
+	double Now() const;
+
+private:
+
+	void   Run();
+	void   Step(double);
+
+private:
+
+	std::chrono::steady_clock::time_point m_startTime;
+
+	std::thread                           m_thread;
+	std::atomic<bool>                     m_running;
+
+	std::mutex                            m_inputMutex;
+	Input                                 m_input;
+
+	State                                 m_state;
+	TripleBuffer<Snapshot>                m_snapshots;
+};
\ No newline at end of file
@@ -51,9 +51,15 @@ void Skybox::Draw(Camera* camera)
 
 	skyboxShader->SetCubemap("Skybox", m_cubemap, 0);
 
+	// The skybox is the background, it doesn't write the depth: the far terrain is drawn behind the
+	// near part of the depth range it would be in.
+	glDepthMask(GL_FALSE);
+
 	glBindVertexArray(m_vao);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
 	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+
+	glDepthMask(GL_TRUE);
 }
 
 void Skybox::CreateCubeBuffers()
@@ -0,0 +1,140 @@
+#include "glad/glad.h"
+#include "StartupProfiler.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+
+using namespace std;
+using namespace std::chrono;
+
+StartupProfiler* StartupProfiler::g_instance = nullptr;
+
+StartupProfiler* StartupProfiler::GetInstance()
+{
+	if (!g_instance)
+		g_instance = new StartupProfiler();
+
+	return g_instance;
+}
+
+void StartupProfiler::FreeInstance()
+{
+	if (g_instance)
+	{
+		delete g_instance;
+		g_instance = nullptr;
+	}
+}
+
+void StartupProfiler::SetMode(Mode mode)
+{
+	m_mode = mode;
+}
+
+StartupProfiler::Mode StartupProfiler::GetMode() const
+{
+	return m_mode;
+}
+
+bool StartupProfiler::IsEnabled() const
+{
+	return m_mode != Mode::Disabled && !m_finished;
+}
+
+bool StartupProfiler::IsColdStart() const
+{
+	return m_mode == Mode::Cold;
+}
+
+void StartupProfiler::BeginPhase(const string& name)
+{
+	if (!IsEnabled())
+		return;
+
+	Phase phase;
+	phase.Name             = name;
+	phase.Depth            = (int)m_openPhases.size();
+	phase.BeginNanoseconds = GetElapsedNanoseconds();
+	phase.EndNanoseconds   = phase.BeginNanoseconds;
+
+	m_openPhases.push_back((int)m_phases.size());
+	m_phases.push_back(phase);
+}
+
+void StartupProfiler::EndPhase()
+{
+	if (!IsEnabled() || m_openPhases.empty())
+		return;
+
+	// Most of the startup work is submitted to the GPU, wait for it so it's
+	// accounted to the phase that issued it and not to the next one that stalls.
+	if (glFinish)
+		glFinish();
+
+	m_phases[m_openPhases.back()].EndNanoseconds = GetElapsedNanoseconds();
+	m_openPhases.pop_back();
+}
+
+void StartupProfiler::Finish()
+{
+	if (!IsEnabled())
+		return;
+
+	while (!m_openPhases.empty())
+		EndPhase();
+
+	WriteReport();
+
+	m_finished = true;
+}
+
+StartupProfiler::StartupProfiler() :
+	m_mode(Mode::Disabled),
+	m_finished(false),
+	m_startTime(steady_clock::now())
+{
+}
+
+long long StartupProfiler::GetElapsedNanoseconds() const
+{
+	return duration_cast<nanoseconds>(steady_clock::now() - m_startTime).count();
+}
+
+string StartupProfiler::GetReportFilename() const
+{
+	return IsColdStart() ? "StartupReport_Cold.txt" : "StartupReport_Warm.txt";
+}
+
+void StartupProfiler::WriteReport() const
+{
+	const double nanosecondsPerMs = 1000000.0;
+
+	double totalMs = GetElapsedNanoseconds() / nanosecondsPerMs;
+
+	ofstream report(GetReportFilename());
+
+	if (!report.is_open())
+	{
+		cout << "ERROR::STARTUP_PROFILER::REPORT_NOT_WRITTEN" << endl;
+		return;
+	}
+
+	report << "Startup mode: "        << (IsColdStart() ? "cold" : "warm") << endl;
+	report << "Time to first frame: " << fixed << setprecision(3) << totalMs << " ms" << endl << endl;
+
+	report << setw(12) << "Begin (ms)" << setw(14) << "Duration (ms)" << setw(10) << "Total %" << "  Phase" << endl;
+
+	for (auto& phase : m_phases)
+	{
+		double beginMs    = phase.BeginNanoseconds                          / nanosecondsPerMs;
+		double durationMs = (phase.EndNanoseconds - phase.BeginNanoseconds) / nanosecondsPerMs;
+
+		report << setw(12) << beginMs
+			   << setw(14) << durationMs
+			   << setw(10) << setprecision(1) << (totalMs > 0.0 ? 100.0 * durationMs / totalMs : 0.0) << setprecision(3)
+			   << "  " << string(phase.Depth * 2, ' ') << phase.Name << endl;
+	}
+
+	cout << "Time to first frame: " << totalMs << " ms, report written to " << GetReportFilename() << endl;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Records the nested phases of the application startup (up to the first presented frame)
+// and writes them as a report, so the time-to-first-frame can be tracked between builds.
+class StartupProfiler
+{
+public:
+
+	enum class Mode
+	{
+		Disabled,
+		Cold,     // the caches owned by the application are ignored and rebuilt
+		Warm      // the caches from a previous run are reused
+	};
+
+private:
+
+	struct Phase
+	{
+	public:
+
+		std::string Name;
+		int         Depth;
+		long long   BeginNanoseconds;
+		long long   EndNanoseconds;
+	};
+
+public:
+
+	StartupProfiler(const StartupProfiler&) = delete;
+	void operator=(const StartupProfiler&)  = delete;
+
+	static StartupProfiler* GetInstance();
+	static void             FreeInstance();
+
+	       void             SetMode(Mode);
+	       Mode             GetMode()     const;
+	       bool             IsEnabled()   const;
+	       bool             IsColdStart() const;
+
+	       void             BeginPhase(const std::string&);
+	       void             EndPhase();
+
+	       void             Finish();
+
+private:
+
+	StartupProfiler();
+
+	long long   GetElapsedNanoseconds() const;
+	std::string GetReportFilename()     const;
+	void        WriteReport()           const;
+
+private:
+
+	       Mode                                  m_mode;
+	       bool                                  m_finished;
+
+	       std::chrono::steady_clock::time_point m_startTime;
+	       std::vector<Phase>                    m_phases;
+	       std::vector<int>                      m_openPhases;
+
+	static StartupProfiler*                      g_instance;
+};
\ No newline at end of file
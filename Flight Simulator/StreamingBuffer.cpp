@@ -0,0 +1,222 @@
+#include <iostream>
+#include <cstring>
+#include <string>
+
+#include "glad/glad.h"
+#include <GLFW/glfw3.h>
+
+#include "StreamingBuffer.h"
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT   0x0080
+#endif
+
+using namespace std;
+
+// The context is created for OpenGL 4.3, glBufferStorage comes from GL_ARB_buffer_storage (core in 4.4).
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum, GLsizeiptr, const void*, GLbitfield);
+
+StreamingBuffer* StreamingBuffer::g_instance = nullptr;
+
+StreamingBuffer::~StreamingBuffer()
+{
+	for (auto& fence : m_fences)
+	{
+		if (fence)
+		{
+			glDeleteSync((GLsync)fence);
+			fence = nullptr;
+		}
+	}
+
+	FreeBuffer();
+}
+
+StreamingBuffer* StreamingBuffer::GetInstance()
+{
+	if (!g_instance)
+		g_instance = new StreamingBuffer();
+
+	return g_instance;
+}
+
+void StreamingBuffer::FreeInstance()
+{
+	if (g_instance)
+	{
+		delete g_instance;
+		g_instance = nullptr;
+	}
+}
+
+void StreamingBuffer::BeginFrame()
+{
+	if (m_regionFull)
+	{
+		// Every region may still be read by the GPU, wait for all of them before reallocating.
+		for (auto& fence : m_fences)
+		{
+			if (!fence)
+				continue;
+
+			while (glClientWaitSync((GLsync)fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+			{
+			}
+
+			glDeleteSync((GLsync)fence);
+			fence = nullptr;
+		}
+
+		while (m_regionSize < m_requiredSize)
+			m_regionSize *= 2;
+
+		FreeBuffer();
+		CreateBuffer();
+
+		m_regionFull = false;
+	}
+
+	m_currentRegion = (m_currentRegion + 1) % REGIONS_COUNT;
+	m_offset        = 0;
+	m_requiredSize  = 0;
+
+	GLsync fence = (GLsync)m_fences[m_currentRegion];
+
+	if (!fence)
+		return;
+
+	// Only waits when the CPU is REGIONS_COUNT frames ahead of the GPU.
+	while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+	{
+	}
+
+	glDeleteSync(fence);
+	m_fences[m_currentRegion] = nullptr;
+}
+
+void StreamingBuffer::EndFrame()
+{
+	m_fences[m_currentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+int StreamingBuffer::Write(const void* data, int count, int elementSize)
+{
+	size_t regionStart = m_regionSize * m_currentRegion;
+	size_t start       = regionStart + m_offset;
+	size_t padding     = (elementSize - start % elementSize) % elementSize;
+	size_t size        = (size_t)count * elementSize;
+
+	// Counts the dropped writes too (with the worst padding), so that a single growth is enough.
+	m_requiredSize += size + elementSize - 1;
+
+	if (m_offset + padding + size > m_regionSize)
+	{
+		if (!m_regionFull)
+			cout << "ERROR::STREAMING_BUFFER::REGION_FULL" << endl;
+
+		m_regionFull = true;
+
+		return -1;
+	}
+
+	start    += padding;
+	m_offset += padding + size;
+
+	if (m_mappedMemory)
+		memcpy(m_mappedMemory + start, data, size);
+	else
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+
+		void* memory = glMapBufferRange(GL_ARRAY_BUFFER, start, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		memcpy(memory, data, size);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	return (int)(start / elementSize);
+}
+
+void StreamingBuffer::BindVertexBuffer(int bindingIndex, int stride) const
+{
+	glBindVertexBuffer(bindingIndex, m_buffer, 0, stride);
+}
+
+StreamingBuffer::StreamingBuffer() :
+	m_mappedMemory(nullptr),
+	m_currentRegion(0),
+	m_offset(0),
+	m_regionSize(INITIAL_REGION_SIZE),
+	m_requiredSize(0),
+	m_regionFull(false)
+{
+	for (auto& fence : m_fences)
+		fence = nullptr;
+
+	CreateBuffer();
+}
+
+void StreamingBuffer::CreateBuffer()
+{
+	GLsizeiptr bufferSize = m_regionSize * REGIONS_COUNT;
+
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+
+	PFNGLBUFFERSTORAGEPROC bufferStorage = IsBufferStorageSupported() ? (PFNGLBUFFERSTORAGEPROC)glfwGetProcAddress("glBufferStorage") : nullptr;
+
+	if (bufferStorage)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		bufferStorage(GL_ARRAY_BUFFER, bufferSize, NULL, flags);
+		m_mappedMemory = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bufferSize, flags);
+	}
+	else
+		glBufferData(GL_ARRAY_BUFFER, bufferSize, NULL, GL_STREAM_DRAW);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void StreamingBuffer::FreeBuffer()
+{
+	glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+
+	if (m_mappedMemory)
+	{
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		m_mappedMemory = nullptr;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDeleteBuffers(1, &m_buffer);
+	m_buffer = 0;
+}
+
+bool StreamingBuffer::IsBufferStorageSupported() const
+{
+	int majorVersion = 0;
+	int minorVersion = 0;
+
+	glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+	glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+
+	if (majorVersion > 4 || (majorVersion == 4 && minorVersion >= 4))
+		return true;
+
+	int extensionsCount = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionsCount);
+
+	for (int i = 0; i < extensionsCount; i++)
+	{
+		if (string((const char*)glGetStringi(GL_EXTENSIONS, i)) == "GL_ARB_buffer_storage")
+			return true;
+	}
+
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+
+// One vertex buffer for the dynamic per-frame data (zone ranges, folliage transforms), used as a
+// ring of REGIONS_COUNT regions. Every frame writes its data in place, in its own region, and the
+// draws reach it through base-instance offsets; the fence placed at the end of the frame tells when
+// the GPU is done with the region, so nothing is reallocated or orphaned per frame. The buffer is mapped
+// once, persistently, when the driver supports buffer storage, otherwise every write maps its range
+// unsynchronized, the fences already keep the regions in use safe.
+// When a frame needs more than a region, the writes that don't fit are dropped for that frame only:
+// the next BeginFrame waits for the GPU and reallocates the buffer with larger regions. The buffer
+// name changes then, so the vertex arrays bind it at draw time (glBindVertexBuffer) and don't keep it.
+class StreamingBuffer
+{
+public:
+
+	static const int    REGIONS_COUNT       = 3;
+	static const size_t INITIAL_REGION_SIZE = 16 << 20;
+
+public:
+
+	StreamingBuffer(const StreamingBuffer&) = delete;
+	void operator=(const StreamingBuffer&)  = delete;
+
+	~StreamingBuffer();
+
+	static StreamingBuffer* GetInstance();
+	static void             FreeInstance();
+
+	       void             BeginFrame();
+	       void             EndFrame();
+
+	       // Returns the index of the first element in the buffer (the base instance of the draw),
+	       // -1 when the region of the frame is full (it is grown at the next BeginFrame).
+	       int              Write(const void*, int, int);
+
+	       // Binds the buffer to a vertex buffer binding of the current vertex array.
+	       void             BindVertexBuffer(int, int) const;
+
+private:
+
+	StreamingBuffer();
+
+	void CreateBuffer();
+	void FreeBuffer();
+
+	bool IsBufferStorageSupported() const;
+
+private:
+
+	       unsigned int            m_buffer;
+	       char*                   m_mappedMemory; // nullptr without buffer storage
+
+	       void*                   m_fences[REGIONS_COUNT]; // GLsync
+	       int                     m_currentRegion;
+	       size_t                  m_offset;       // in the current region
+	       size_t                  m_regionSize;
+	       size_t                  m_requiredSize; // by the writes of the frame, worst padding included
+	       bool                    m_regionFull;   // a write of the frame was dropped
+
+	static StreamingBuffer*        g_instance;
+};
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <glm/gtc/constants.hpp>
+
+#include "StreamingScheduler.h"
+#include "Terrain.h"
+#include "Chunk.h"
+
+using namespace std;
+using namespace glm;
+
+const float StreamingScheduler::VELOCITY_SMOOTHING  = 0.25f; // seconds
+const float StreamingScheduler::MAX_LOOK_AHEAD_TIME = 4.0f;  // seconds
+const float StreamingScheduler::TURN_SPEED          = 1.5f;  // radians per second
+const float StreamingScheduler::STEP_TIME_SMOOTHING = 0.25f;
+
+StreamingScheduler::StreamingScheduler(int maxChunks, int buildStagesCount) :
+	m_maxChunks(maxChunks),
+	m_position(0.0f, 0.0f, 0.0f),
+	m_velocity(0.0f, 0.0f, 0.0f),
+	m_forward(0.0f, 0.0f, 1.0f),
+	m_halfFieldOfViewX(0.0f),
+	m_hasPosition(false),
+	m_budget(0.0f),
+	m_budgetCredit(0.0f),
+	m_frameBuildTime(0.0f),
+	m_averageStepTimes(buildStagesCount, 0.0f)
+{
+	// The radius of the disc covered by maxChunks chunks.
+	m_visibleRadius = sqrt((float)m_maxChunks / pi<float>()) * GetChunkStride();
+}
+
+void StreamingScheduler::Update(Camera* camera, float deltaTime, float budget)
+{
+	vec3 position = camera->GetPosition();
+
+	if (m_hasPosition && deltaTime > 0.0f)
+	{
+		vec3  frameVelocity = (position - m_position) / deltaTime;
+		float blendFactor   = 1.0f - exp(-deltaTime / VELOCITY_SMOOTHING);
+
+		m_velocity = mix(m_velocity, frameVelocity, blendFactor);
+	}
+
+	m_position         = position;
+	m_forward          = camera->GetForward();
+	m_halfFieldOfViewX = atan(tan(camera->GetFieldOfViewY() / 2.0f) * camera->GetAspectRatio());
+	m_hasPosition      = true;
+
+	// The unused budget is kept for a few frames, so a stage that takes longer than a
+	// frame's budget runs once enough time was saved for it.
+	float longestStepTime = *max_element(m_averageStepTimes.begin(), m_averageStepTimes.end());
+
+	m_budget              = budget;
+	m_budgetCredit        = std::min(m_budgetCredit + budget, std::max(budget * MAX_CREDIT_FRAMES, longestStepTime));
+	m_frameBuildTime      = 0.0f;
+}
+
+void StreamingScheduler::GetTargetChunks(FrameVector<ChunkRequest>& requests) const
+{
+	float chunkStride       = GetChunkStride();
+	vec3  predictedPosition = m_position + m_velocity * MAX_LOOK_AHEAD_TIME;
+
+	// The candidates cover the visible disc around the camera and around its predicted position.
+	vec2  minPosition       = vec2(std::min(m_position.x, predictedPosition.x), std::min(m_position.z, predictedPosition.z)) - m_visibleRadius;
+	vec2  maxPosition       = vec2(std::max(m_position.x, predictedPosition.x), std::max(m_position.z, predictedPosition.z)) + m_visibleRadius;
+
+	int   minX              = (int)floor(minPosition.x / chunkStride);
+	int   minZ              = (int)floor(minPosition.y / chunkStride);
+	int   maxX              = (int)ceil(maxPosition.x  / chunkStride);
+	int   maxZ              = (int)ceil(maxPosition.y  / chunkStride);
+
+	requests.clear();
+	requests.reserve((maxX - minX + 1) * (maxZ - minZ + 1));
+
+	for (int z = minZ; z <= maxZ; z++)
+	{
+		for (int x = minX; x <= maxX; x++)
+		{
+			ChunkRequest request;
+
+			request.ChunkId  = make_pair(x, z);
+			request.Deadline = GetDeadline(request.ChunkId, request.Distance);
+
+			requests.push_back(request);
+		}
+	}
+
+	sort(requests.begin(), requests.end(), [](const ChunkRequest& a, const ChunkRequest& b)
+		{
+			if (a.Deadline != b.Deadline)
+				return a.Deadline < b.Deadline;
+
+			return a.Distance < b.Distance;
+		});
+
+	if ((int)requests.size() > m_maxChunks)
+		requests.resize(m_maxChunks);
+}
+
+float StreamingScheduler::GetDeadline(Vec2Int chunkId, float& distance) const
+{
+	vec3  chunkPosition = Chunk::GetPositionForChunkId(chunkId);
+	vec2  toChunk       = vec2(chunkPosition.x - m_position.x, chunkPosition.z - m_position.z);
+	vec2  velocity      = vec2(m_velocity.x, m_velocity.z);
+
+	float squaredRadius = m_visibleRadius * m_visibleRadius;
+	float timeToEnter   = 0.0f;
+
+	distance            = length(toChunk);
+
+	// Solves |toChunk - velocity * t| = visibleRadius for the moment the chunk enters the disc.
+	if (dot(toChunk, toChunk) > squaredRadius)
+	{
+		float a            = dot(velocity, velocity);
+		float b            = dot(toChunk, velocity);
+		float discriminant = b * b - a * (dot(toChunk, toChunk) - squaredRadius);
+
+		if (a < FLT_EPSILON || b <= 0.0f || discriminant < 0.0f)
+			return FLT_MAX;
+
+		timeToEnter = (b - sqrt(discriminant)) / a;
+	}
+
+	// The chunks behind the camera are needed later, the time it takes to turn towards them.
+	vec2  toPredictedChunk = toChunk - velocity * timeToEnter;
+	vec2  forward          = vec2(m_forward.x, m_forward.z);
+	float timeToTurn       = 0.0f;
+
+	if (length(forward) > FLT_EPSILON && length(toPredictedChunk) > GetChunkStride())
+	{
+		float angle = acos(glm::clamp(dot(normalize(forward), normalize(toPredictedChunk)), -1.0f, 1.0f));
+		timeToTurn  = std::max(angle - m_halfFieldOfViewX, 0.0f) / TURN_SPEED;
+	}
+
+	return std::max(timeToEnter, timeToTurn);
+}
+
+// A stage runs when enough budget was saved for it and it fits in what is left of this frame's
+// budget; a stage longer than the whole budget only runs alone in a frame.
+bool StreamingScheduler::CanBuildStep(int buildStage) const
+{
+	// A stage that never ran yet is assumed to take the whole budget.
+	float stepTime = m_averageStepTimes[buildStage] > 0.0f ? m_averageStepTimes[buildStage] : m_budget;
+
+	if (m_budget <= 0.0f || m_budgetCredit < stepTime)
+		return false;
+
+	return m_frameBuildTime <= 0.0f || m_frameBuildTime + stepTime <= m_budget;
+}
+
+void StreamingScheduler::AddBuildTime(int buildStage, float buildTime)
+{
+	float& averageStepTime = m_averageStepTimes[buildStage];
+
+	m_budgetCredit        -= buildTime;
+	m_frameBuildTime      += buildTime;
+	averageStepTime        = averageStepTime > 0.0f ? mix(averageStepTime, buildTime, STEP_TIME_SMOOTHING) : buildTime;
+}
+
+vec3 StreamingScheduler::GetVelocity() const
+{
+	return m_velocity;
+}
+
+float StreamingScheduler::GetChunkStride() const
+{
+	return Terrain::CHUNK_WIDTH - Chunk::CHUNK_CLOSE_BIAS;
+}
\ No newline at end of file
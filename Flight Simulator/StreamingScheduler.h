@@ -0,0 +1,68 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "Camera.h"
+#include "Utils.h"
+#include "FrameArena.h"
+
+// Decides which chunks the terrain should hold and in which order the missing ones are built.
+// The camera velocity is estimated from its movement, every chunk gets a deadline: the time
+// until the predicted camera gets close enough to see it (plus the time to turn towards it).
+// The chunks are built stage by stage, in the order of their deadlines, from a time budget
+// credited every frame.
+class StreamingScheduler
+{
+public:
+
+	struct ChunkRequest
+	{
+	public:
+
+		Vec2Int ChunkId;
+		float   Deadline; // in seconds, FLT_MAX when the chunk isn't approached
+		float   Distance;
+	};
+
+private:
+
+	static const float VELOCITY_SMOOTHING;
+	static const float MAX_LOOK_AHEAD_TIME;
+	static const float TURN_SPEED;
+	static const float STEP_TIME_SMOOTHING;
+	static const int   MAX_CREDIT_FRAMES = 4;
+
+public:
+
+	StreamingScheduler(int, int);
+
+	void                      Update(Camera*, float, float);
+
+	// The maxChunks chunks that are needed first, sorted by deadline.
+	void                      GetTargetChunks(FrameVector<ChunkRequest>&) const;
+	float                     GetDeadline(Vec2Int, float&) const;
+
+	bool                      CanBuildStep(int) const;
+	void                      AddBuildTime(int, float);
+
+	glm::vec3                 GetVelocity() const;
+
+private:
+
+	float                     GetChunkStride() const;
+
+private:
+
+	int                m_maxChunks;
+	float              m_visibleRadius;
+
+	glm::vec3          m_position;
+	glm::vec3          m_velocity;
+	glm::vec3          m_forward;
+	float              m_halfFieldOfViewX;
+	bool               m_hasPosition;
+
+	float              m_budget;
+	float              m_budgetCredit;
+	float              m_frameBuildTime;
+	std::vector<float> m_averageStepTimes; // in milliseconds, for every build stage
+};
\ No newline at end of file
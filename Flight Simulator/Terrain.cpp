@@ -1,7 +1,12 @@
+#include "glad/glad.h"
 #include "Terrain.h"
 
-#include <queue>
+#include <unordered_set>
 #include "ShaderManager.h"
+#include "StartupProfiler.h"
+#include "Profiler.h"
+#include "RenderSettings.h"
+#include "WorkerPool.h"
 
 using namespace std;
 using namespace glm;
@@ -9,8 +14,6 @@ using namespace glm;
 const float Terrain::CHUNK_WIDTH                                 = 64.0f;
 const float Terrain::TERRAIN_AMPLITUDE                           = 100.0f;
 const float Terrain::WATER_LEVEL                                 = 10.0f;
-const float Terrain::DISTANCE_FOR_DETAILS                        = 256.0f;
-const float Terrain::MAX_TESSELATION                             = 8.0f;
 const float Terrain::GAMMA                                       = 1.0f;
 
 const float Terrain::HEIGHT_FREQUENCY                            = 0.0125f;
@@ -38,16 +41,19 @@ const int   Terrain::FOLLIAGE_SELECTION_RANDOMNESS_OCTAVES_COUNT = 20;
 const float Terrain::WATER_MOVE_SPEED                            = 0.01f;
 
 Terrain::Terrain() : 
-	m_accumulatedCurrentChunksTime(0.0f),
 	m_firstFrame(true),
 	m_waterMoveFactor(0.0f),
-	m_waterTime(0.0f)
+	m_waterTime(0.0f),
+	m_currentView((int)View::Main)
 {
 	CreateTerrainObjects();
 }
 
 Terrain::~Terrain()
 {
+	for (auto& viewJobs : m_viewsJobs)
+		WorkerPool::GetInstance()->Wait(viewJobs.Counter);
+
 	for (auto& keyVal : m_chunks)
 	{
 		if (keyVal.second)
@@ -62,47 +68,157 @@ Terrain::~Terrain()
 	FreeTerrainObjects();
 }
 
-void Terrain::Udpate(Camera* camera, float deltaTime, bool renderDebug, bool renderFoliage)
+void Terrain::UpdateStreaming(Camera* camera, float deltaTime)
 {
-	UpdateCurrentChunks(camera, deltaTime);
+	ProfileZone profileZone("Terrain::UpdateStreaming");
 
-	for (auto& chunk : m_chunksList)
-		chunk->Update(camera, deltaTime, renderDebug, renderFoliage);
+	UpdateCurrentChunks(camera, deltaTime);
 
-	m_waterTime += deltaTime;
+	if (RenderSettings::GetInstance()->LongRangeTerrain())
+	{
+		ProfileZone clipmapProfileZone("Terrain::UpdateClipmap");
+		m_clipmap->Update(camera);
+	}
 
 	m_firstFrame = false;
 }
 
-void Terrain::UpdateWater(Camera* camera, float deltaTime, bool renderDebug)
+// The chunks are split in a few batches per worker, the chunks with folliage take longer. The
+// batches live in the frame arena and the parameters in m_viewsJobs, so nothing goes to the heap.
+void Terrain::BeginPrepareView(View view, const Camera::Snapshot& camera, bool renderDebug, bool renderFoliage, bool fillWater)
+{
+	ProfileZone profileZone("Terrain::BeginPrepareView");
+
+	int         viewIndex    = (int)view;
+	WorkerPool* workerPool   = WorkerPool::GetInstance();
+	int         batchesCount = std::min(workerPool->GetWorkersCount() * 2, (int)m_chunksList.size());
+	ViewJobs&   viewJobs     = m_viewsJobs[viewIndex];
+
+	viewJobs.CameraSnapshot = camera;
+	viewJobs.RenderDebug    = renderDebug;
+	viewJobs.RenderFoliage  = renderFoliage;
+	viewJobs.FillWater      = fillWater;
+
+	for (int batch = 0; batch < batchesCount; batch++)
+	{
+		PrepareViewBatch* batchData = static_cast<PrepareViewBatch*>(FrameArena::GetInstance()->Allocate(sizeof(PrepareViewBatch), alignof(PrepareViewBatch)));
+
+		batchData->Owner      = this;
+		batchData->ViewIndex  = viewIndex;
+		batchData->FirstChunk = batch;
+		batchData->ChunksStep = batchesCount;
+
+		workerPool->Submit(&Terrain::PrepareViewBatchJob, batchData, viewJobs.Counter);
+	}
+}
+
+void Terrain::PrepareViewBatchJob(void* data)
+{
+	ProfileZone       profileZone("Terrain::PrepareView");
+
+	PrepareViewBatch* batch    = static_cast<PrepareViewBatch*>(data);
+	Terrain*          terrain  = batch->Owner;
+	ViewJobs&         viewJobs = terrain->m_viewsJobs[batch->ViewIndex];
+
+	for (size_t i = batch->FirstChunk; i < terrain->m_chunksList.size(); i += batch->ChunksStep)
+		terrain->m_chunksList[i]->PrepareView(batch->ViewIndex, viewJobs.CameraSnapshot, viewJobs.RenderDebug, viewJobs.RenderFoliage, viewJobs.FillWater);
+}
+
+void Terrain::EndPrepareView(View view)
 {
+	ProfileZone profileZone("Terrain::EndPrepareView");
+
+	int         viewIndex = (int)view;
+
+	WorkerPool::GetInstance()->Wait(m_viewsJobs[viewIndex].Counter);
+
 	for (auto& chunk : m_chunksList)
-		chunk->UpdateWater(camera, deltaTime, renderDebug);
+		chunk->FinishView(viewIndex);
+
+	m_currentView = viewIndex;
+}
+
+// The visible water patches are gathered by Chunk::PrepareView, together with the terrain.
+void Terrain::UpdateWater(float deltaTime)
+{
+	m_waterTime += deltaTime;
 
 	m_waterMoveFactor += deltaTime * WATER_MOVE_SPEED;
 	if (m_waterMoveFactor >= 1.0f)
 		m_waterMoveFactor -= 1.0f;
 }
 
-void Terrain::Draw(Camera* camera, Light* light, bool renderFoliage, Texture* refractionTexture, Texture* reflectionTexture, Texture* refractionDepthTexture, Texture* reflectionDepthTexture)
+void Terrain::Draw(Camera* camera, Light* light, bool renderFoliage)
 {
+	ShaderManager* shaderManager = ShaderManager::GetInstance();
+	Shader*        terrainShader = shaderManager->GetTerrainShader();
+	Profiler*      profiler      = Profiler::GetInstance();
+
+	// The clipmap goes first, the chunks are drawn over its near range and it's discarded
+	// under them.
+	if (RenderSettings::GetInstance()->LongRangeTerrain())
+	{
+		profiler->BeginZone("Terrain::DrawClipmap");
+
+		// Behind the near range of the scene, the far terrain depth stays for the clouds and the water.
+		float depthRangeSplit = TerrainClipmap::GetDepthRangeSplit();
+
+		glDepthRange(depthRangeSplit, 1.0);
+		m_clipmap->Draw(camera, light, m_terrainMaterials, m_terrainBiomesData, true);
+		glDepthRange(0.0, depthRangeSplit);
+		m_clipmap->Draw(camera, light, m_terrainMaterials, m_terrainBiomesData, false);
+
+		profiler->EndZone();
+	}
+
+	profiler->BeginZone("Terrain::DrawTerrain");
+
+	Chunk::SetTerrainShaderParameters(terrainShader, camera, light, m_terrainMaterials, m_terrainBiomesData);
+
 	for (auto& chunk : m_chunksList)
-		chunk->DrawTerrain(camera, light, m_terrainMaterials, m_terrainBiomesData);
+		chunk->DrawTerrain(terrainShader, m_currentView);
 
-	if (refractionTexture && reflectionTexture && refractionDepthTexture && reflectionDepthTexture)
-		for (auto& chunk : m_chunksList)
-			chunk->DrawWater(camera, light, refractionTexture, reflectionTexture, refractionDepthTexture, reflectionDepthTexture, m_waterMoveFactor, m_waterMaterial, m_waterTime);
+	profiler->EndZone();
 	
 	if (renderFoliage)
+	{
+		profiler->BeginZone("Terrain::DrawFolliage");
+
 		for (auto& chunk : m_chunksList)
-			chunk->DrawFolliage(camera, light);
+			chunk->DrawFolliage(camera, light, m_currentView);
+
+		profiler->EndZone();
+	}
+}
+
+// The water is transparent, so it must be drawn after all the opaque geometry.
+void Terrain::DrawWater(Camera* camera, Light* light, Texture* refractionTexture, Texture* reflectionTexture, Texture* refractionDepthTexture, Texture* reflectionDepthTexture)
+{
+	ShaderManager* shaderManager = ShaderManager::GetInstance();
+	Shader*        waterShader   = shaderManager->GetWaterShader();
+
+	ProfileZone    profileZone("Terrain::DrawWater");
+
+	Chunk::SetWaterShaderParameters(waterShader, camera, light, refractionTexture, reflectionTexture, refractionDepthTexture, reflectionDepthTexture, m_waterMoveFactor, m_waterMaterial, m_waterTime);
+
+	for (auto& chunk : m_chunksList)
+		chunk->DrawWater(waterShader, m_currentView);
 }
 
 void Terrain::CreateTerrainObjects()
 {
+	StartupProfiler* startupProfiler = StartupProfiler::GetInstance();
+
+	startupProfiler->BeginPhase("Noise generators creation");
+
 	          m_noise                    = new PerlinNoise();
-			  m_hydraulicErosion         = new HydraulicErosion( {102400, 0, 3} );
+			  m_hydraulicErosion         = new HydraulicErosion( {102400, 0, 3, Chunk::MAX_TEXTURE_SIZE} );
 			  m_gaussianBlur             = new GaussianBlur(2.0f);
+			  m_clipmap                  = new TerrainClipmap(m_noise);
+			  m_streamingScheduler       = new StreamingScheduler(MAX_CHUNKS, Chunk::BUILD_STAGES_COUNT + Chunk::UPGRADE_STAGES_COUNT);
+
+	startupProfiler->EndPhase();
+	startupProfiler->BeginPhase("Materials decoding");
 
 	Material* snow2                      = new Material("Assets/snow_02_diff_1k.png",             "Assets/snow_02_nor_gl_1k.png",             "Assets/snow_02_spec_1k.png");
 	Material* medievalBlocks             = new Material("Assets/medieval_blocks_02_diff_1k.png",  "Assets/medieval_blocks_02_nor_gl_1k.png",  "Assets/medieval_blocks_02_spec_1k.png");
@@ -111,6 +227,9 @@ void Terrain::CreateTerrainObjects()
 	Material* snowFieldAerial            = new Material("Assets/snow_field_aerial_col_1k.png",    "Assets/snow_field_aerial_nor_gl_1k.png");
 	Material* snow3                      = new Material("Assets/snow_03_diff_1k.png",             "Assets/snow_03_nor_gl_1k.png",             "Assets/snow_03_spec_1k.png");
 
+	startupProfiler->EndPhase();
+	startupProfiler->BeginPhase("Foliage models loading");
+
 	ShaderManager* shaderManager = ShaderManager::GetInstance();
 
 	Biome::FolliageModel rockModel = Biome::FolliageModel(
@@ -158,22 +277,48 @@ void Terrain::CreateTerrainObjects()
 	forestBiome->AddTerrainLevel(medievalBlocks, { rockModel });
 	forestBiome->AddTerrainLevel(snow3, { rockModel });
 
+	startupProfiler->EndPhase();
+	startupProfiler->BeginPhase("Material arrays creation");
+
 	m_terrainBiomesData = Biome::CreateBiomesTexture();
-	m_terrainMaterials  = Biome::GetBiomesMaterials();
+	m_terrainMaterials  = new MaterialArray(Biome::GetBiomesMaterials());
+
+	Material* waterMaterial = new Material("Assets/Water/WaterColor.jpg", "Assets/Water/WaterNormal.jpg");
+	m_waterMaterial         = new MaterialArray({ waterMaterial });
+
+	delete waterMaterial;
 
-	m_waterMaterial = new Material("Assets/Water/WaterColor.jpg", "Assets/Water/WaterNormal.jpg");
+	startupProfiler->EndPhase();
 }
 
 void Terrain::FreeTerrainObjects()
 {
-	Biome::Free();
-
 	if (m_waterMaterial)
 	{
 		delete m_waterMaterial;
 		m_waterMaterial = nullptr;
 	}
 
+	if (m_terrainMaterials)
+	{
+		delete m_terrainMaterials;
+		m_terrainMaterials = nullptr;
+	}
+
+	Biome::Free();
+
+	if (m_streamingScheduler)
+	{
+		delete m_streamingScheduler;
+		m_streamingScheduler = nullptr;
+	}
+
+	if (m_clipmap)
+	{
+		delete m_clipmap;
+		m_clipmap = nullptr;
+	}
+
 	if (m_gaussianBlur)
 	{
 		delete m_gaussianBlur;
@@ -193,119 +338,179 @@ void Terrain::FreeTerrainObjects()
 	}
 }
 
-void Terrain::UpdateChunksVisibility(Camera* camera, float deltaTime, int diffSize)
+// Starts the missing chunks in the order of their deadlines, each one replacing the resident chunk
+// that is needed the latest, and advances the chunks under construction one stage at a time while
+// the scheduler allows it. Returns whether the set of drawable chunks changed.
+bool Terrain::UpdateChunksVisibility(bool buildAll)
 {
-	vec3                                         cameraPos         = camera->GetPosition();
-	vec3                                         cameraChunkOrigin = cameraPos - vec3((CHUNK_WIDTH - Chunk::CHUNK_CLOSE_BIAS) / 2.0f,
-                                                                                      0.0f,
-                                                                                      (CHUNK_WIDTH - Chunk::CHUNK_CLOSE_BIAS) / 2.0f);
-									             
-	Vec2Int                                      currentID         = make_pair(int(cameraChunkOrigin.x / (CHUNK_WIDTH - Chunk::CHUNK_CLOSE_BIAS)),
-		                                                                       int(cameraChunkOrigin.z / (CHUNK_WIDTH - Chunk::CHUNK_CLOSE_BIAS)));
-									             
-	queue<Vec2Int>                               exploreChunksQueue;
-	unordered_set<Vec2Int, HashHelper::HashPair> targetChunksSet;
-
-	exploreChunksQueue.push(currentID);
-	targetChunksSet.insert(currentID);
-
-	int dx[] = { -1, 0, 1, 0 };
-	int dy[] = { 0, -1, 0, 1 };
-	int directionsCount = sizeof(dx) / sizeof(int);
-
-	while (targetChunksSet.size() < MAX_CHUNKS)
-	{
-		Vec2Int currentChunk = exploreChunksQueue.front();
-		exploreChunksQueue.pop();
+	Profiler*                                        profiler = Profiler::GetInstance();
+
+	FrameVector<StreamingScheduler::ChunkRequest>    targetChunks;
+	FrameUnorderedSet<Vec2Int, HashHelper::HashPair> targetChunksSet;
+
+	m_streamingScheduler->GetTargetChunks(targetChunks);
+
+	for (auto& targetChunk : targetChunks)
+		targetChunksSet.insert(targetChunk.ChunkId);
+
+	FrameVector<StreamingScheduler::ChunkRequest> toErase;
 
-		for (int i = 0; i < directionsCount; i++)
+	for (auto& keyVal : m_chunks)
+	{
+		if (targetChunksSet.find(keyVal.first) == targetChunksSet.end())
 		{
-			if (targetChunksSet.size() >= MAX_CHUNKS)
-				break;
+			StreamingScheduler::ChunkRequest request;
 
-			Vec2Int neighbour = make_pair(currentChunk.first + dx[i],
-				                          currentChunk.second + dy[i]);
+			request.ChunkId  = keyVal.first;
+			request.Deadline = m_streamingScheduler->GetDeadline(keyVal.first, request.Distance);
 
-			if (targetChunksSet.find(neighbour) == targetChunksSet.end())
-			{
-				targetChunksSet.insert(neighbour);
-				exploreChunksQueue.push(neighbour);
-			}
+			toErase.push_back(request);
 		}
 	}
 
-	vector<Vec2Int> toErase;
-
-	sort(toErase.begin(), toErase.end(), [&](Vec2Int a, Vec2Int b)
+	sort(toErase.begin(), toErase.end(), [](const StreamingScheduler::ChunkRequest& a, const StreamingScheduler::ChunkRequest& b)
 		{
-			float distA = abs(currentID.first - a.first) + abs(currentID.second - a.second);
-			float distB = abs(currentID.first - b.first) + abs(currentID.second - b.second);
-			return distB < distA;
+			if (a.Deadline != b.Deadline)
+				return a.Deadline > b.Deadline;
+
+			return a.Distance > b.Distance;
 		});
 
+	int                 erasedCount   = 0;
+	bool                chunksChanged = false;
+	FrameVector<Chunk*> pendingChunks;
+	FrameVector<Chunk*> upgradedChunks;
+
+	// All the resident chunks under construction count, not only the ones met before in the loop.
+	size_t              pendingCount  = 0;
+
 	for (auto& keyVal : m_chunks)
 	{
-		if (targetChunksSet.find(keyVal.first) == targetChunksSet.end())
+		if (keyVal.second->GetBuildStage() != Chunk::BuildStage::Ready)
+			pendingCount++;
+	}
+
+	for (auto& targetChunk : targetChunks)
+	{
+		auto chunkIt = m_chunks.find(targetChunk.ChunkId);
+
+		int  textureSize = Chunk::GetTextureSizeForDistance(targetChunk.Distance);
+
+		if (chunkIt != m_chunks.end())
 		{
-			if (toErase.size() < diffSize)
-			{
-				delete keyVal.second;
-				keyVal.second = nullptr;
+			chunkIt->second->SetTargetTextureSize(textureSize);
 
-				toErase.push_back(keyVal.first);
-			}
+			if (chunkIt->second->GetBuildStage() != Chunk::BuildStage::Ready)
+				pendingChunks.push_back(chunkIt->second);
+			else if (chunkIt->second->NeedsUpgrade())
+				upgradedChunks.push_back(chunkIt->second);
+
+			continue;
 		}
-	}
 
-	for (auto& id : toErase)
-		m_chunks.erase(id);
+		if (!buildAll && pendingCount >= MAX_PENDING_CHUNKS)
+			continue;
 
+		if (m_chunks.size() >= MAX_CHUNKS && erasedCount < toErase.size())
+		{
+			Vec2Int chunkId = toErase[erasedCount++].ChunkId;
+			chunksChanged   = chunksChanged || m_chunks[chunkId]->IsDrawable();
+
+			if (m_chunks[chunkId]->GetBuildStage() != Chunk::BuildStage::Ready)
+				pendingCount--;
+
+			delete m_chunks[chunkId];
+			m_chunks.erase(chunkId);
+		}
 
-	vector<Vec2Int> targetChunks;
-	for (auto& targetChunk : targetChunksSet)
-		targetChunks.push_back(targetChunk);
+		Chunk* chunk                  = new Chunk(m_noise, m_hydraulicErosion, m_gaussianBlur, targetChunk.ChunkId, textureSize);
+		m_chunks[targetChunk.ChunkId] = chunk;
 
-	sort(targetChunks.begin(), targetChunks.end(), [&](Vec2Int a, Vec2Int b)
+		pendingChunks.push_back(chunk);
+		pendingCount++;
+	}
+
+	for (auto& chunk : pendingChunks)
+	{
+		while (chunk->GetBuildStage() != Chunk::BuildStage::Ready)
 		{
-			float distA = abs(currentID.first - a.first) + abs(currentID.second - a.second);
-			float distB = abs(currentID.first - b.first) + abs(currentID.second - b.second);
-			return distA < distB;
-		});
+			int buildStage = (int)chunk->GetBuildStage();
 
-	int additions = 0;
+			if (!buildAll && !m_streamingScheduler->CanBuildStep(buildStage))
+				return chunksChanged;
 
-	for (auto& targetChunk : targetChunks)
+			bool      wasDrawable = chunk->IsDrawable();
+			long long startTime   = profiler->Now();
+
+			chunk->BuildStep();
+
+			if (!buildAll)
+				m_streamingScheduler->AddBuildTime(buildStage, (profiler->Now() - startTime) / 1000000.0f);
+
+			chunksChanged = chunksChanged || (!wasDrawable && chunk->IsDrawable());
+		}
+	}
+
+	// The missing chunks go first, the budget left upgrades the textures of the resident chunks in
+	// the order of their deadlines.
+	for (auto& chunk : upgradedChunks)
 	{
-		if (m_chunks.find(targetChunk) == m_chunks.end())
+		bool upgraded = false;
+
+		while (!upgraded)
 		{
-			if (additions < diffSize)
-			{
-				Chunk* chunk = new Chunk(m_noise, m_hydraulicErosion, m_gaussianBlur, targetChunk);
-				m_chunks[targetChunk] = chunk;
+			int buildStage = Chunk::BUILD_STAGES_COUNT + (int)chunk->GetUpgradeStage();
 
-				additions++;
-			}
+			if (!m_streamingScheduler->CanBuildStep(buildStage))
+				return chunksChanged;
+
+			long long startTime = profiler->Now();
+
+			upgraded = chunk->UpgradeStep();
+
+			m_streamingScheduler->AddBuildTime(buildStage, (profiler->Now() - startTime) / 1000000.0f);
 		}
 	}
+
+	return chunksChanged;
 }
 
 void Terrain::UpdateCurrentChunks(Camera* camera, float deltaTime)
 {
-	m_accumulatedCurrentChunksTime += deltaTime;
-
-	if (m_accumulatedCurrentChunksTime < TIME_TO_UPDATE_CURRENT_CHUNKS && !m_firstFrame)
+	// The camera velocity can't be estimated from a frame where the simulation didn't advance.
+	if (deltaTime <= 0.0f && !m_firstFrame)
 		return;
 
-	m_accumulatedCurrentChunksTime -= m_firstFrame ? 0.0f : TIME_TO_UPDATE_CURRENT_CHUNKS;
+	m_streamingScheduler->Update(camera, deltaTime, RenderSettings::GetInstance()->ChunkStreamingBudget());
+
+	ProfileZone profileZone("Terrain::UpdateCurrentChunks");
+
+	if (m_firstFrame)
+		StartupProfiler::GetInstance()->BeginPhase("Chunks generation");
+
+	bool chunksChanged = UpdateChunksVisibility(m_firstFrame);
+
+	if (m_firstFrame)
+		StartupProfiler::GetInstance()->EndPhase();
 
-	UpdateChunksVisibility(camera, deltaTime, m_firstFrame ? MAX_CHUNKS : 1);
 	m_chunksList.clear();
 
+	FrameVector<Vec2Int> chunksIds;
+
 	for (auto& keyVal : m_chunks)
+	{
+		if (!keyVal.second->IsDrawable())
+			continue;
+
 		m_chunksList.push_back(keyVal.second);
+		chunksIds.push_back(keyVal.first);
+	}
+
+	if (chunksChanged)
+		m_clipmap->SetResidentChunks(chunksIds);
 
 	sort(m_chunksList.begin(), m_chunksList.end(), [&](Chunk* a, Chunk* b)
 		{
 			return distance(a->GetTranslation(), camera->GetPosition()) > distance(b->GetTranslation(), camera->GetPosition());
 		});
-}
+}
\ No newline at end of file
@@ -4,6 +4,9 @@
 #include "Chunk.h"
 #include "HydraulicErosion.h"
 #include "GaussianBlur.h"
+#include "TerrainClipmap.h"
+#include "StreamingScheduler.h"
+#include "WorkerPool.h"
 
 class Terrain
 {
@@ -12,8 +15,6 @@ public:
 	static const float CHUNK_WIDTH;
 	static const float TERRAIN_AMPLITUDE;
 	static const float WATER_LEVEL;
-	static const float DISTANCE_FOR_DETAILS;
-	static const float MAX_TESSELATION;
 	static const float GAMMA;
 
 	static const float HEIGHT_FREQUENCY;
@@ -40,26 +41,67 @@ public:
 
 	static const float WATER_MOVE_SPEED;
 
+	// The cameras a frame is prepared for, each has its own visibility lists in the chunks.
+	enum class View
+	{
+		Main,
+		Reflection
+	};
+
 private:
 
+	// What the jobs preparing a view need, kept until EndPrepareView.
+	struct ViewJobs
+	{
+	public:
+
+		Camera::Snapshot       CameraSnapshot;
+		bool                   RenderDebug;
+		bool                   RenderFoliage;
+		bool                   FillWater;
+
+		WorkerPool::JobCounter Counter;
+	};
+
+	// The data of one job, in the frame arena.
+	struct PrepareViewBatch
+	{
+	public:
+
+		Terrain*               Owner;
+		int                    ViewIndex;
+		int                    FirstChunk;
+		int                    ChunksStep; // the batches take every ChunksStep-th chunk
+	};
+
 	const int   MAX_CHUNKS                    = 54;
-	const float TIME_TO_UPDATE_CURRENT_CHUNKS = 0.5;
+	const int   MAX_PENDING_CHUNKS            = 2;  // the chunks under construction at the same time
 
 public:
 
 	Terrain();
 	~Terrain();
 
-	void Udpate(Camera*, float, bool, bool);
-	void UpdateWater(Camera*, float, bool);
-	void Draw(Camera*, Light*, bool, Texture* = nullptr, Texture* = nullptr, Texture* = nullptr, Texture* = nullptr);
+	void UpdateStreaming(Camera*, float);
+
+	// The view is prepared by the worker threads and EndPrepareView waits for them and makes it the
+	// view that gets drawn. Only the current frame is prepared: the workers overlap with the clouds
+	// volumes and the reflection pass, the main view is joined before the refraction passes.
+	void BeginPrepareView(View, const Camera::Snapshot&, bool, bool, bool);
+	void EndPrepareView(View);
+
+	void UpdateWater(float);
+	void Draw(Camera*, Light*, bool);
+	void DrawWater(Camera*, Light*, Texture*, Texture*, Texture*, Texture*);
 
 private:
 
 	void CreateTerrainObjects();
 	void FreeTerrainObjects();
 
-	void UpdateChunksVisibility(Camera*, float, int);
+	static void PrepareViewBatchJob(void*);
+
+	bool UpdateChunksVisibility(bool);
 	void UpdateCurrentChunks(Camera*, float);
 
 private:
@@ -67,17 +109,20 @@ private:
 
 	std::unordered_map<Vec2Int, Chunk*, HashHelper::HashPair> m_chunks;
 	std::vector<Chunk*>                                       m_chunksList;
+	ViewJobs                                                  m_viewsJobs[Chunk::VIEWS_COUNT];
+	int                                                       m_currentView;
 												              
 	PerlinNoise*                                              m_noise;
 	HydraulicErosion*                                         m_hydraulicErosion;
 	GaussianBlur*                                             m_gaussianBlur;
+	TerrainClipmap*                                           m_clipmap;
+	StreamingScheduler*                                       m_streamingScheduler;
 												              
-	std::vector<Material*>                                    m_terrainMaterials;
+	MaterialArray*                                            m_terrainMaterials;
 	Texture*                                                  m_terrainBiomesData;
 
-	Material*                                                 m_waterMaterial;
+	MaterialArray*                                            m_waterMaterial;
 												              
-	float                                                     m_accumulatedCurrentChunksTime;
 	float                                                     m_waterTime;
 												              
 	bool                                                      m_firstFrame;
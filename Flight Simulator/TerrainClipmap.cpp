@@ -0,0 +1,410 @@
+#include <cmath>
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+#include "glad/glad.h"
+
+#include "TerrainClipmap.h"
+#include "ShaderManager.h"
+#include "Terrain.h"
+#include "Chunk.h"
+#include "RenderSettings.h"
+
+using namespace std;
+using namespace glm;
+
+const float TerrainClipmap::BASE_SPACING          = 8.0f;
+const float TerrainClipmap::MAX_NOISE_FREQUENCY   = 0.5f; // cycles per texel, the finer octaves would alias
+const float TerrainClipmap::ALTITUDE_FACTOR       = 0.4f; // a level is skipped when the camera is higher than this part of its extent
+const float TerrainClipmap::NEAR_OVERLAP          = 0.9f;
+const float TerrainClipmap::DEPTH_RANGE_SPLIT     = 0.5f;
+const float TerrainClipmap::TEX_COORDS_MULTIPLIER = 0.2f;
+
+TerrainClipmap::TerrainClipmap(PerlinNoise* noise) :
+	m_finestLevel(0),
+	m_noise(noise),
+	m_residentChunksTexture(nullptr),
+	m_residentChunksOrigin(0.0f, 0.0f),
+	m_residentChunksSize(0.0f),
+	m_vbo(0),
+	m_ebo(0),
+	m_vao(0),
+	m_fullIndicesCount(0),
+	m_ringIndicesCount(0)
+{
+	for (int i = 0; i < LEVELS_COUNT; i++)
+	{
+		m_levels[i].HeightTexture = new Texture(CLIPMAP_SIZE, CLIPMAP_SIZE,
+		                                        Texture::Format::RG32F,
+		                                        Texture::Format::RG,
+		                                        Texture::Filter::Linear);
+		m_levels[i].HeightTexture->SetWrap(Texture::Wrap::Repeat);
+
+		m_levels[i].Center        = ivec2(0, 0);
+		m_levels[i].Valid         = false;
+	}
+
+	CreateBuffers();
+}
+
+TerrainClipmap::~TerrainClipmap()
+{
+	FreeBuffers();
+
+	if (m_residentChunksTexture)
+	{
+		delete m_residentChunksTexture;
+		m_residentChunksTexture = nullptr;
+	}
+
+	for (int i = 0; i < LEVELS_COUNT; i++)
+	{
+		if (m_levels[i].HeightTexture)
+		{
+			delete m_levels[i].HeightTexture;
+			m_levels[i].HeightTexture = nullptr;
+		}
+	}
+}
+
+void TerrainClipmap::Update(Camera* camera)
+{
+	vec3 cameraPosition = camera->GetPosition();
+
+	m_finestLevel = GetFinestLevel(cameraPosition.y);
+
+	for (int i = 0; i < LEVELS_COUNT; i++)
+	{
+		float spacing = GetSpacing(i);
+
+		// The centers move in steps of two texels, so the border of every level lies on the
+		// vertices of the next coarser one.
+		ivec2 center  = ivec2((int)floor(cameraPosition.x / (2.0f * spacing)) * 2,
+		                      (int)floor(cameraPosition.z / (2.0f * spacing)) * 2);
+
+		UpdateLevel(i, center);
+	}
+}
+
+// The chunks are marked in a small mask around them, the clipmap isn't drawn under the marked ones.
+void TerrainClipmap::SetResidentChunks(const FrameVector<Vec2Int>& chunksIds)
+{
+	if (m_residentChunksTexture)
+	{
+		delete m_residentChunksTexture;
+		m_residentChunksTexture = nullptr;
+	}
+
+	if (chunksIds.empty())
+		return;
+
+	Vec2Int minId = chunksIds[0];
+	Vec2Int maxId = chunksIds[0];
+
+	for (auto& chunkId : chunksIds)
+	{
+		minId = make_pair(std::min(minId.first, chunkId.first),  std::min(minId.second, chunkId.second));
+		maxId = make_pair(std::max(maxId.first, chunkId.first),  std::max(maxId.second, chunkId.second));
+	}
+
+	Vec2Int firstId = make_pair((minId.first  + maxId.first)  / 2 - RESIDENT_CHUNKS_SIZE / 2,
+	                            (minId.second + maxId.second) / 2 - RESIDENT_CHUNKS_SIZE / 2);
+
+	float*  maskData = new float[RESIDENT_CHUNKS_SIZE * RESIDENT_CHUNKS_SIZE];
+	fill(maskData, maskData + RESIDENT_CHUNKS_SIZE * RESIDENT_CHUNKS_SIZE, 0.0f);
+
+	for (auto& chunkId : chunksIds)
+	{
+		int x = chunkId.first  - firstId.first;
+		int y = chunkId.second - firstId.second;
+
+		if (x >= 0 && x < RESIDENT_CHUNKS_SIZE && y >= 0 && y < RESIDENT_CHUNKS_SIZE)
+			maskData[y * RESIDENT_CHUNKS_SIZE + x] = 1.0f;
+	}
+
+	m_residentChunksTexture = new Texture(RESIDENT_CHUNKS_SIZE, RESIDENT_CHUNKS_SIZE,
+	                                      Texture::Format::R8,
+	                                      Texture::Format::RED,
+	                                      Texture::Filter::Point,
+	                                      maskData);
+
+	float chunkStride       = Terrain::CHUNK_WIDTH - Chunk::CHUNK_CLOSE_BIAS;
+	vec3  firstChunkCenter  = Chunk::GetPositionForChunkId(firstId);
+
+	m_residentChunksOrigin  = vec2(firstChunkCenter.x, firstChunkCenter.z) - vec2(chunkStride / 2.0f, chunkStride / 2.0f);
+	m_residentChunksSize    = chunkStride * RESIDENT_CHUNKS_SIZE;
+
+	if (maskData)
+	{
+		delete[] maskData;
+		maskData = nullptr;
+	}
+}
+
+void TerrainClipmap::Draw(Camera* camera, Light* light, MaterialArray* terrainMaterials, Texture* terrainBiomesData, bool farRange)
+{
+	ShaderManager* shaderManager  = ShaderManager::GetInstance();
+	Shader*        clipmapShader  = shaderManager->GetTerrainClipmapShader();
+
+	vec3           cameraPosition = camera->GetPosition();
+
+	float          nearDistance   = farRange ? camera->GetFar() * NEAR_OVERLAP : camera->GetNear();
+	float          farDistance    = farRange ? GetFarDistance()              : camera->GetFar();
+
+	Chunk::SetTerrainShaderParameters(clipmapShader, camera, light, terrainMaterials, terrainBiomesData);
+
+	if (farRange)
+	{
+		mat4 projection = perspective(camera->GetFieldOfViewY(), camera->GetAspectRatio(), nearDistance, farDistance);
+		clipmapShader->SetMatrix4("Projection", projection);
+	}
+
+	clipmapShader->SetFloat("WaterLevel",          Terrain::WATER_LEVEL);
+	clipmapShader->SetFloat("TexCoordsMultiplier", TEX_COORDS_MULTIPLIER);
+	clipmapShader->SetFloat("ClipmapSize",         CLIPMAP_SIZE);
+	clipmapShader->SetFloat("GridCells",           GRID_CELLS);
+	clipmapShader->SetFloat("TransitionCells",     TRANSITION_CELLS);
+
+	clipmapShader->SetInt("ExcludeResidentChunks", m_residentChunksTexture ? 1 : 0);
+
+	if (m_residentChunksTexture)
+	{
+		clipmapShader->SetTexture("ResidentChunksTexture", m_residentChunksTexture, 6);
+		clipmapShader->SetVec2("ResidentChunksOrigin",     m_residentChunksOrigin);
+		clipmapShader->SetFloat("ResidentChunksSize",      m_residentChunksSize);
+	}
+
+	glBindVertexArray(m_vao);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+
+	for (int i = m_finestLevel; i < LEVELS_COUNT; i++)
+	{
+		float  spacing         = GetSpacing(i);
+
+		// The levels entirely out of the depth range of this pass are skipped.
+		float  innerDistance   = i == m_finestLevel ? 0.0f : (GRID_CELLS / 4 - 2) * spacing;
+		float  outerDistance   = (GRID_CELLS / 2 + 2) * spacing * sqrt(2.0f) + abs(cameraPosition.y) + Terrain::TERRAIN_AMPLITUDE;
+
+		if (outerDistance < nearDistance || innerDistance > farDistance)
+			continue;
+
+		Level& level           = m_levels[i];
+		bool   hasCoarserLevel = i + 1 < LEVELS_COUNT;
+		vec2   center          = vec2((float)level.Center.x, (float)level.Center.y) * spacing;
+
+		clipmapShader->SetVec2("LevelCenter",              center);
+		clipmapShader->SetVec2("LevelOrigin",              center - vec2(GRID_CELLS / 2, GRID_CELLS / 2) * spacing);
+		clipmapShader->SetFloat("LevelSpacing",            spacing);
+		clipmapShader->SetInt("HasCoarserLevel",           hasCoarserLevel ? 1 : 0);
+
+		clipmapShader->SetTexture("HeightTexture",         level.HeightTexture,                                    0);
+		clipmapShader->SetTexture("CoarserHeightTexture",  m_levels[hasCoarserLevel ? i + 1 : i].HeightTexture, 1);
+
+		int firstIndex   = 0;
+		int indicesCount = m_fullIndicesCount;
+
+		// The finest drawn level is a full grid, the others leave a hole where the finer level is.
+		if (i != m_finestLevel)
+		{
+			ivec2 holePosition = m_levels[i - 1].Center / 2 - level.Center; // 0 or 1 on each axis
+
+			firstIndex   = m_fullIndicesCount + (holePosition.y * 2 + holePosition.x) * m_ringIndicesCount;
+			indicesCount = m_ringIndicesCount;
+		}
+
+		glDrawElements(GL_TRIANGLES, indicesCount, GL_UNSIGNED_INT, (void*)(firstIndex * sizeof(unsigned int)));
+	}
+
+	glBindVertexArray(0);
+}
+
+float TerrainClipmap::GetFarDistance()
+{
+	return (GRID_CELLS / 2) * BASE_SPACING * (float)(1 << (LEVELS_COUNT - 1)) * sqrt(2.0f);
+}
+
+float TerrainClipmap::GetDepthRangeSplit()
+{
+	return RenderSettings::GetInstance()->LongRangeTerrain() ? DEPTH_RANGE_SPLIT : 1.0f;
+}
+
+void TerrainClipmap::SetDepthRangeParameters(Shader* shader, Camera* camera)
+{
+	shader->SetFloat("DepthRangeSplit", GetDepthRangeSplit());
+	shader->SetFloat("FarRangeNear",    camera->GetFar() * NEAR_OVERLAP);
+	shader->SetFloat("FarRangeFar",     GetFarDistance());
+}
+
+// All the levels share a grid of vertices, the index buffer holds the full grid followed by the
+// rings for the HOLE_POSITIONS_COUNT positions the finer level can have inside a level.
+void TerrainClipmap::CreateBuffers()
+{
+	int          verticesWidth = GRID_CELLS + 1;
+	vector<vec2> vertices;
+
+	vertices.reserve(verticesWidth * verticesWidth);
+
+	for (int z = 0; z < verticesWidth; z++)
+		for (int x = 0; x < verticesWidth; x++)
+			vertices.push_back(vec2(x, z));
+
+	vector<unsigned int> indices;
+
+	AddGridIndices(indices, -1, -1);
+	m_fullIndicesCount = (int)indices.size();
+
+	for (int holePosition = 0; holePosition < HOLE_POSITIONS_COUNT; holePosition++)
+		AddGridIndices(indices, GRID_CELLS / 4 + holePosition % 2, GRID_CELLS / 4 + holePosition / 2);
+
+	m_ringIndicesCount = ((int)indices.size() - m_fullIndicesCount) / HOLE_POSITIONS_COUNT;
+
+	glGenVertexArrays(1, &m_vao);
+	glBindVertexArray(m_vao);
+
+	glGenBuffers(1, &m_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), (void*)0);
+
+	glGenBuffers(1, &m_ebo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), indices.data(), GL_STATIC_DRAW);
+
+	glBindVertexArray(0);
+}
+
+void TerrainClipmap::FreeBuffers()
+{
+	glBindVertexArray(m_vao);
+
+	glDisableVertexAttribArray(0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDeleteBuffers(1, &m_vbo);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glDeleteBuffers(1, &m_ebo);
+
+	glBindVertexArray(0);
+	glDeleteVertexArrays(1, &m_vao);
+}
+
+// Adds the cells of the grid, except the GRID_CELLS / 2 wide hole starting at (holeX, holeZ).
+void TerrainClipmap::AddGridIndices(vector<unsigned int>& indices, int holeX, int holeZ)
+{
+	int verticesWidth = GRID_CELLS + 1;
+
+	for (int z = 0; z < GRID_CELLS; z++)
+	{
+		for (int x = 0; x < GRID_CELLS; x++)
+		{
+			bool insideHole = holeX >= 0 && x >= holeX && x < holeX + GRID_CELLS / 2 &&
+			                  holeZ >= 0 && z >= holeZ && z < holeZ + GRID_CELLS / 2;
+
+			if (insideHole)
+				continue;
+
+			int pivot       = z * verticesWidth + x;
+			int right       = pivot + 1;
+			int bottom      = pivot + verticesWidth;
+			int bottomRight = bottom + 1;
+
+			indices.push_back(pivot);
+			indices.push_back(bottom);
+			indices.push_back(right);
+
+			indices.push_back(right);
+			indices.push_back(bottom);
+			indices.push_back(bottomRight);
+		}
+	}
+}
+
+void TerrainClipmap::UpdateLevel(int levelIndex, ivec2 center)
+{
+	Level& level    = m_levels[levelIndex];
+	int    halfSize = CLIPMAP_SIZE / 2;
+	ivec2  offset   = center - level.Center;
+
+	if (!level.Valid || abs(offset.x) >= CLIPMAP_SIZE || abs(offset.y) >= CLIPMAP_SIZE)
+		RenderRegion(levelIndex, center - ivec2(halfSize, halfSize), ivec2(CLIPMAP_SIZE, CLIPMAP_SIZE));
+	else
+	{
+		// Only the columns and the rows that came into range are generated, the other texels
+		// stay where they are.
+		if (offset.x > 0)
+			RenderRegion(levelIndex, ivec2(level.Center.x + halfSize, center.y - halfSize), ivec2(offset.x, CLIPMAP_SIZE));
+		else if (offset.x < 0)
+			RenderRegion(levelIndex, ivec2(center.x - halfSize, center.y - halfSize),       ivec2(-offset.x, CLIPMAP_SIZE));
+
+		if (offset.y > 0)
+			RenderRegion(levelIndex, ivec2(center.x - halfSize, level.Center.y + halfSize), ivec2(CLIPMAP_SIZE, offset.y));
+		else if (offset.y < 0)
+			RenderRegion(levelIndex, ivec2(center.x - halfSize, center.y - halfSize),       ivec2(CLIPMAP_SIZE, -offset.y));
+	}
+
+	level.Center = center;
+	level.Valid  = true;
+}
+
+void TerrainClipmap::RenderRegion(int levelIndex, ivec2 regionStart, ivec2 regionSize)
+{
+	ShaderManager* shaderManager = ShaderManager::GetInstance();
+	Shader*        noiseShader   = shaderManager->GetTerrainClipmapNoiseShader();
+
+	float          spacing       = GetSpacing(levelIndex);
+
+	noiseShader->Use();
+
+	noiseShader->SetImage2D("ImgOutput",           m_levels[levelIndex].HeightTexture, 0, Texture::Format::RG32F);
+	m_noise->SetNoiseValues(noiseShader);
+
+	noiseShader->SetIVec2("RegionStart",           regionStart);
+	noiseShader->SetIVec2("RegionSize",            regionSize);
+	noiseShader->SetFloat("TexelSpacing",          spacing);
+
+	noiseShader->SetFloat("HeightFrequency",       Terrain::HEIGHT_FREQUENCY);
+	noiseShader->SetFloat("HeightFudgeFactor",     Terrain::HEIGHT_FUDGE_FACTOR);
+	noiseShader->SetFloat("HeightExponent",        Terrain::HEIGHT_EXPONENT);
+	noiseShader->SetInt("HeightOctavesCount",      Terrain::HEIGHT_OCTAVES_COUNT);
+	noiseShader->SetInt("HeightEvaluatedOctaves",  GetEvaluatedOctaves(Terrain::HEIGHT_FREQUENCY, Terrain::HEIGHT_OCTAVES_COUNT, spacing));
+
+	noiseShader->SetFloat("BiomeFrequency",        Terrain::BIOME_FREQUENCY);
+	noiseShader->SetFloat("BiomeFudgeFactor",      Terrain::BIOME_FUDGE_FACTOR);
+	noiseShader->SetFloat("BiomeExponent",         Terrain::BIOME_EXPONENT);
+	noiseShader->SetInt("BiomeOctavesCount",       Terrain::BIOME_OCTAVES_COUNT);
+	noiseShader->SetInt("BiomeEvaluatedOctaves",   GetEvaluatedOctaves(Terrain::BIOME_FREQUENCY, Terrain::BIOME_OCTAVES_COUNT, spacing));
+
+	glDispatchCompute(Texture::GetComputeShaderGroupsCount(regionSize.x, COMPUTE_SHADER_BLOCKS_COUNT),
+	                  Texture::GetComputeShaderGroupsCount(regionSize.y, COMPUTE_SHADER_BLOCKS_COUNT), 1);
+
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+float TerrainClipmap::GetSpacing(int levelIndex) const
+{
+	return BASE_SPACING * (float)(1 << levelIndex);
+}
+
+// Seen from high above, the finest levels would only add triangles smaller than a pixel.
+int TerrainClipmap::GetFinestLevel(float altitude) const
+{
+	int finestLevel = 0;
+
+	while (finestLevel < LEVELS_COUNT - 1 && (GRID_CELLS / 2) * GetSpacing(finestLevel) * ALTITUDE_FACTOR < altitude)
+		finestLevel++;
+
+	return finestLevel;
+}
+
+// The octave i of the noise has frequency * 2^i cycles per unit.
+int TerrainClipmap::GetEvaluatedOctaves(float frequency, int octavesCount, float spacing) const
+{
+	int evaluatedOctaves = 1;
+
+	while (evaluatedOctaves < octavesCount && frequency * (float)(1 << evaluatedOctaves) * spacing <= MAX_NOISE_FREQUENCY)
+		evaluatedOctaves++;
+
+	return evaluatedOctaves;
+}
\ No newline at end of file
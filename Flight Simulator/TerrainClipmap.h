@@ -0,0 +1,95 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "Texture.h"
+#include "Shader.h"
+#include "Camera.h"
+#include "Light.h"
+#include "PerlinNoise.h"
+#include "MaterialArray.h"
+#include "Utils.h"
+#include "FrameArena.h"
+
+// The terrain past the detailed chunks, up to the horizon. It's made of LEVELS_COUNT nested square
+// rings of GRID_CELLS cells, each level twice as coarse as the previous one. Every level keeps its
+// heights and biome values in a CLIPMAP_SIZE texture stored toroidally around the camera, when the
+// camera moves only the texels that came into range are generated, so the memory and the cost of
+// the updates don't depend on the view distance.
+class TerrainClipmap
+{
+private:
+
+	struct Level
+	{
+	public:
+
+		Texture*   HeightTexture; // (height, biome)
+		glm::ivec2 Center;        // in texels of the level, always even
+		bool       Valid;
+	};
+
+	static const int   COMPUTE_SHADER_BLOCKS_COUNT = 8;
+
+	static const int   LEVELS_COUNT                = 6;
+	static const int   CLIPMAP_SIZE                = 128; // must be a power of 2
+	static const int   GRID_CELLS                  = 96;  // must be a multiple of 4, smaller than CLIPMAP_SIZE
+	static const int   TRANSITION_CELLS            = 10;
+	static const int   HOLE_POSITIONS_COUNT        = 4;
+
+	static const int   RESIDENT_CHUNKS_SIZE        = 16;  // chunks along x and z
+
+	static const float BASE_SPACING;
+	static const float MAX_NOISE_FREQUENCY;
+	static const float ALTITUDE_FACTOR;
+	static const float NEAR_OVERLAP;
+	static const float DEPTH_RANGE_SPLIT;
+	static const float TEX_COORDS_MULTIPLIER;
+
+public:
+
+	TerrainClipmap(PerlinNoise*);
+	~TerrainClipmap();
+
+	       void  Update(Camera*);
+	       void  SetResidentChunks(const FrameVector<Vec2Int>&);
+	       // The far range is drawn first, with its own projection past the far plane of the camera,
+	       // in the [GetDepthRangeSplit(), 1] part of the depth range; the rest of the scene is drawn
+	       // in front of it, in [0, GetDepthRangeSplit()], so the depth buffer keeps both ranges.
+	       void  Draw(Camera*, Light*, MaterialArray*, Texture*, bool);
+
+	static float GetFarDistance();
+	static float GetDepthRangeSplit(); // 1 without the long range terrain
+	       // For the shaders reading the depth buffer back (linearizeDepth).
+	static void  SetDepthRangeParameters(Shader*, Camera*);
+
+private:
+
+	void  CreateBuffers();
+	void  FreeBuffers();
+	void  AddGridIndices(std::vector<unsigned int>&, int, int);
+
+	void  UpdateLevel(int, glm::ivec2);
+	void  RenderRegion(int, glm::ivec2, glm::ivec2);
+
+	float GetSpacing(int)                        const;
+	int   GetFinestLevel(float)                  const;
+	int   GetEvaluatedOctaves(float, int, float) const;
+
+private:
+
+	Level        m_levels[LEVELS_COUNT];
+	int          m_finestLevel;
+
+	PerlinNoise* m_noise;
+
+	Texture*     m_residentChunksTexture;
+	glm::vec2    m_residentChunksOrigin;
+	float        m_residentChunksSize;
+
+	unsigned int m_vbo;
+	unsigned int m_ebo;
+	unsigned int m_vao;
+
+	int          m_fullIndicesCount;
+	int          m_ringIndicesCount;
+};
\ No newline at end of file
@@ -0,0 +1,736 @@
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <mutex>
+#include <xmmintrin.h>
+
+#include "TerrainQuery.h"
+#include "Terrain.h"
+#include "Chunk.h"
+
+using namespace std;
+using namespace glm;
+
+TerrainQuery* TerrainQuery::g_instance = nullptr;
+
+// Up to PACKET_SIZE ray segments in SoA layout, one ray per SSE lane. The empty lanes have an
+// empty distance range, so they never hit anything.
+struct TerrainQuery::RayPacket
+{
+public:
+
+	__m128 OriginX;
+	__m128 OriginY;
+	__m128 OriginZ;
+
+	__m128 DirectionX;
+	__m128 DirectionY;
+	__m128 DirectionZ;
+
+	__m128 InverseDirectionX;
+	__m128 InverseDirectionY;
+	__m128 InverseDirectionZ;
+
+	__m128 MinDistance;
+	__m128 MaxDistance; // shrinks to the closest hit found so far
+
+	__m128 NormalX;
+	__m128 NormalY;
+	__m128 NormalZ;
+};
+
+static inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+TerrainQuery::~TerrainQuery()
+{
+	for (auto& keyVal : m_chunks)
+	{
+		if (keyVal.second)
+		{
+			delete keyVal.second;
+			keyVal.second = nullptr;
+		}
+	}
+
+	m_chunks.clear();
+}
+
+TerrainQuery* TerrainQuery::GetInstance()
+{
+	if (!g_instance)
+		g_instance = new TerrainQuery();
+
+	return g_instance;
+}
+
+void TerrainQuery::FreeInstance()
+{
+	if (g_instance)
+	{
+		delete g_instance;
+		g_instance = nullptr;
+	}
+}
+
+// The values are the normalized heights of the chunk, averaged over width x width cells.
+void TerrainQuery::AddChunkHeights(Vec2Int chunkId, float** heightValues, int width)
+{
+	vec3       chunkCenter = Chunk::GetPositionForChunkId(chunkId);
+
+	ChunkData* chunkData   = new ChunkData();
+
+	chunkData->Width       = width;
+	chunkData->Spacing     = Terrain::CHUNK_WIDTH / (float)width;
+	chunkData->Origin      = vec2(chunkCenter.x, chunkCenter.z) - vec2(Terrain::CHUNK_WIDTH / 2.0f) + vec2(chunkData->Spacing / 2.0f);
+
+	float minHeight = heightValues[0][0];
+	float maxHeight = heightValues[0][0];
+
+	for (int x = 0; x < width; x++)
+	{
+		for (int z = 0; z < width; z++)
+		{
+			minHeight = std::min(minHeight, heightValues[x][z]);
+			maxHeight = std::max(maxHeight, heightValues[x][z]);
+		}
+	}
+
+	chunkData->HeightBias  = minHeight * Terrain::TERRAIN_AMPLITUDE;
+	chunkData->HeightScale = (maxHeight - minHeight) * Terrain::TERRAIN_AMPLITUDE / (float)UINT16_MAX;
+
+	chunkData->Heights.resize(width * width);
+
+	for (int x = 0; x < width; x++)
+	{
+		for (int z = 0; z < width; z++)
+		{
+			float height = heightValues[x][z] * Terrain::TERRAIN_AMPLITUDE;
+			float value  = chunkData->HeightScale > 0.0f ? (height - chunkData->HeightBias) / chunkData->HeightScale : 0.0f;
+
+			chunkData->Heights[z * width + x] = (uint16_t)std::min(std::max(round(value), 0.0f), (float)UINT16_MAX);
+		}
+	}
+
+	BuildHeightPyramid(chunkData);
+
+	chunkData->ObstacleCells.resize(OBSTACLE_CELLS_COUNT * OBSTACLE_CELLS_COUNT);
+
+	unique_lock<shared_timed_mutex> lock(m_mutex);
+
+	auto chunkIt = m_chunks.find(chunkId);
+
+	// The heights of a chunk are added again when its textures are upgraded, its obstacles stay.
+	if (chunkIt != m_chunks.end())
+	{
+		if (chunkIt->second)
+		{
+			chunkData->ObstacleCells.swap(chunkIt->second->ObstacleCells);
+			delete chunkIt->second;
+		}
+
+		chunkIt->second = chunkData;
+	}
+	else
+		m_chunks[chunkId] = chunkData;
+}
+
+void TerrainQuery::AddChunkObstacles(Vec2Int chunkId, const vector<vec3>& obstacles)
+{
+	vec3  chunkCenter = Chunk::GetPositionForChunkId(chunkId);
+	vec2  chunkCorner = vec2(chunkCenter.x, chunkCenter.z) - vec2(Terrain::CHUNK_WIDTH / 2.0f);
+	float cellWidth   = Terrain::CHUNK_WIDTH / (float)OBSTACLE_CELLS_COUNT;
+
+	unique_lock<shared_timed_mutex> lock(m_mutex);
+
+	auto chunkIt = m_chunks.find(chunkId);
+
+	if (chunkIt == m_chunks.end())
+		return;
+
+	auto& obstacleCells = chunkIt->second->ObstacleCells;
+
+	for (auto& obstacleCell : obstacleCells)
+		obstacleCell.clear();
+
+	for (auto& obstacle : obstacles)
+	{
+		int cellX = std::min(std::max((int)floor((obstacle.x - chunkCorner.x) / cellWidth), 0), OBSTACLE_CELLS_COUNT - 1);
+		int cellZ = std::min(std::max((int)floor((obstacle.z - chunkCorner.y) / cellWidth), 0), OBSTACLE_CELLS_COUNT - 1);
+
+		obstacleCells[cellZ * OBSTACLE_CELLS_COUNT + cellX].push_back(obstacle);
+	}
+}
+
+void TerrainQuery::RemoveChunk(Vec2Int chunkId)
+{
+	unique_lock<shared_timed_mutex> lock(m_mutex);
+
+	auto chunkIt = m_chunks.find(chunkId);
+
+	if (chunkIt == m_chunks.end())
+		return;
+
+	if (chunkIt->second)
+	{
+		delete chunkIt->second;
+		chunkIt->second = nullptr;
+	}
+
+	m_chunks.erase(chunkIt);
+}
+
+TerrainQuery::TerrainSample TerrainQuery::Sample(const vec2& position) const
+{
+	shared_lock<shared_timed_mutex> lock(m_mutex);
+
+	return SampleUnlocked(position);
+}
+
+// The lock is taken once for the whole batch.
+void TerrainQuery::Sample(const vector<vec2>& positions, vector<TerrainSample>& samples) const
+{
+	shared_lock<shared_timed_mutex> lock(m_mutex);
+
+	samples.resize(positions.size());
+
+	for (int i = 0; i < positions.size(); i++)
+		samples[i] = SampleUnlocked(positions[i]);
+}
+
+bool TerrainQuery::GetHeight(const vec2& position, float& height) const
+{
+	shared_lock<shared_timed_mutex> lock(m_mutex);
+
+	return GetHeightUnlocked(position, height);
+}
+
+bool TerrainQuery::GetNormal(const vec2& position, vec3& normal) const
+{
+	TerrainSample sample = Sample(position);
+	normal               = sample.Normal;
+
+	return sample.Valid;
+}
+
+bool TerrainQuery::GetSlope(const vec2& position, float& slope) const
+{
+	TerrainSample sample = Sample(position);
+	slope                = sample.Slope;
+
+	return sample.Valid;
+}
+
+bool TerrainQuery::IsUnderWater(const vec2& position) const
+{
+	float height = 0.0f;
+
+	return GetHeight(position, height) && height < Terrain::WATER_LEVEL;
+}
+
+bool TerrainQuery::FindNearestObstacle(const vec3& position, float maxDistance, vec3& nearestObstacle) const
+{
+	float   cellWidth       = Terrain::CHUNK_WIDTH / (float)OBSTACLE_CELLS_COUNT;
+
+	// The chunks overlap their neighbours, so one more chunk is checked on every side.
+	Vec2Int minChunkId      = GetChunkId(vec2(position.x - maxDistance, position.z - maxDistance));
+	Vec2Int maxChunkId      = GetChunkId(vec2(position.x + maxDistance, position.z + maxDistance));
+
+	float   nearestDistance = maxDistance;
+	bool    found           = false;
+
+	shared_lock<shared_timed_mutex> lock(m_mutex);
+
+	for (int chunkX = minChunkId.first - 1; chunkX <= maxChunkId.first + 1; chunkX++)
+	{
+		for (int chunkZ = minChunkId.second - 1; chunkZ <= maxChunkId.second + 1; chunkZ++)
+		{
+			auto chunkIt = m_chunks.find(make_pair(chunkX, chunkZ));
+
+			if (chunkIt == m_chunks.end())
+				continue;
+
+			vec3 chunkCenter = Chunk::GetPositionForChunkId(chunkIt->first);
+			vec2 chunkCorner = vec2(chunkCenter.x, chunkCenter.z) - vec2(Terrain::CHUNK_WIDTH / 2.0f);
+
+			int  minCellX    = std::max((int)floor((position.x - maxDistance - chunkCorner.x) / cellWidth), 0);
+			int  minCellZ    = std::max((int)floor((position.z - maxDistance - chunkCorner.y) / cellWidth), 0);
+			int  maxCellX    = std::min((int)floor((position.x + maxDistance - chunkCorner.x) / cellWidth), OBSTACLE_CELLS_COUNT - 1);
+			int  maxCellZ    = std::min((int)floor((position.z + maxDistance - chunkCorner.y) / cellWidth), OBSTACLE_CELLS_COUNT - 1);
+
+			for (int cellZ = minCellZ; cellZ <= maxCellZ; cellZ++)
+			{
+				for (int cellX = minCellX; cellX <= maxCellX; cellX++)
+				{
+					for (auto& obstacle : chunkIt->second->ObstacleCells[cellZ * OBSTACLE_CELLS_COUNT + cellX])
+					{
+						float obstacleDistance = distance(position, obstacle);
+
+						if (obstacleDistance <= nearestDistance)
+						{
+							nearestDistance = obstacleDistance;
+							nearestObstacle = obstacle;
+							found           = true;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	return found;
+}
+
+TerrainQuery::RayHit TerrainQuery::CastRay(const Ray& ray) const
+{
+	vector<RayHit> rayHits;
+
+	CastRays({ ray }, rayHits);
+
+	return rayHits[0];
+}
+
+void TerrainQuery::CastRays(const vector<Ray>& rays, vector<RayHit>& rayHits) const
+{
+	rayHits.resize(rays.size());
+
+	for (auto& rayHit : rayHits)
+	{
+		rayHit.Hit      = false;
+		rayHit.Distance = FLT_MAX;
+		rayHit.Position = vec3(0.0f, 0.0f, 0.0f);
+		rayHit.Normal   = vec3(0.0f, 1.0f, 0.0f);
+	}
+
+	shared_lock<shared_timed_mutex> lock(m_mutex);
+
+	unordered_map<Vec2Int, vector<RaySegment>, HashHelper::HashPair> chunksSegments;
+
+	for (int i = 0; i < rays.size(); i++)
+		AddRaySegments(rays[i], i, chunksSegments);
+
+	// The chunks closer to the origins of the rays go first, so the hits found there shorten the
+	// segments further away.
+	vector<pair<float, const Vec2Int*>> chunksOrder;
+
+	for (auto& keyVal : chunksSegments)
+	{
+		float enterDistance = FLT_MAX;
+
+		for (auto& segment : keyVal.second)
+			enterDistance = std::min(enterDistance, segment.EnterDistance);
+
+		chunksOrder.push_back(make_pair(enterDistance, &keyVal.first));
+	}
+
+	sort(chunksOrder.begin(), chunksOrder.end(), [](const pair<float, const Vec2Int*>& a, const pair<float, const Vec2Int*>& b)
+		{
+			return a.first < b.first;
+		});
+
+	for (auto& chunkOrder : chunksOrder)
+	{
+		const vector<RaySegment>& segments  = chunksSegments[*chunkOrder.second];
+		const ChunkData*          chunkData = m_chunks.find(*chunkOrder.second)->second;
+
+		for (int first = 0; first < segments.size(); first += PACKET_SIZE)
+		{
+			int   count = std::min((int)segments.size() - first, PACKET_SIZE);
+
+			alignas(16) float values[14][PACKET_SIZE];
+
+			for (int lane = 0; lane < PACKET_SIZE; lane++)
+			{
+				// The empty lanes repeat the last segment of the packet with an empty range.
+				const RaySegment& segment = segments[first + std::min(lane, count - 1)];
+				const Ray&        ray     = rays[segment.RayIndex];
+
+				values[0][lane]  = ray.Origin.x;
+				values[1][lane]  = ray.Origin.y;
+				values[2][lane]  = ray.Origin.z;
+
+				values[3][lane]  = ray.Direction.x;
+				values[4][lane]  = ray.Direction.y;
+				values[5][lane]  = ray.Direction.z;
+
+				for (int axis = 0; axis < 3; axis++)
+				{
+					float direction         = values[3 + axis][lane];
+					values[6 + axis][lane]  = abs(direction) > FLT_EPSILON ? 1.0f / direction : (direction < 0.0f ? -1e30f : 1e30f);
+				}
+
+				values[9][lane]  = segment.EnterDistance;
+				values[10][lane] = lane < count ? std::min(segment.ExitDistance, rayHits[segment.RayIndex].Distance) : -1.0f;
+			}
+
+			RayPacket packet;
+
+			packet.OriginX           = _mm_load_ps(values[0]);
+			packet.OriginY           = _mm_load_ps(values[1]);
+			packet.OriginZ           = _mm_load_ps(values[2]);
+			packet.DirectionX        = _mm_load_ps(values[3]);
+			packet.DirectionY        = _mm_load_ps(values[4]);
+			packet.DirectionZ        = _mm_load_ps(values[5]);
+			packet.InverseDirectionX = _mm_load_ps(values[6]);
+			packet.InverseDirectionY = _mm_load_ps(values[7]);
+			packet.InverseDirectionZ = _mm_load_ps(values[8]);
+			packet.MinDistance       = _mm_load_ps(values[9]);
+			packet.MaxDistance       = _mm_load_ps(values[10]);
+			packet.NormalX           = _mm_setzero_ps();
+			packet.NormalY           = _mm_set1_ps(1.0f);
+			packet.NormalZ           = _mm_setzero_ps();
+
+			__m128 initialMaxDistance = packet.MaxDistance;
+
+			TraversePacket(chunkData, packet);
+
+			int hitMask = _mm_movemask_ps(_mm_cmplt_ps(packet.MaxDistance, initialMaxDistance));
+
+			_mm_store_ps(values[10], packet.MaxDistance);
+			_mm_store_ps(values[11], packet.NormalX);
+			_mm_store_ps(values[12], packet.NormalY);
+			_mm_store_ps(values[13], packet.NormalZ);
+
+			for (int lane = 0; lane < count; lane++)
+			{
+				RayHit& rayHit = rayHits[segments[first + lane].RayIndex];
+
+				if (!(hitMask & (1 << lane)) || values[10][lane] >= rayHit.Distance)
+					continue;
+
+				rayHit.Hit      = true;
+				rayHit.Distance = values[10][lane];
+				rayHit.Normal   = vec3(values[11][lane], values[12][lane], values[13][lane]);
+			}
+		}
+	}
+
+	for (int i = 0; i < rays.size(); i++)
+	{
+		if (rayHits[i].Hit)
+			rayHits[i].Position = rays[i].Origin + rays[i].Direction * rayHits[i].Distance;
+		else
+			rayHits[i].Distance = rays[i].MaxDistance;
+	}
+}
+
+TerrainQuery::TerrainQuery()
+{
+}
+
+TerrainQuery::TerrainSample TerrainQuery::SampleUnlocked(const vec2& position) const
+{
+	TerrainSample sample;
+
+	sample.Valid      = GetHeightUnlocked(position, sample.Height);
+	sample.Normal     = vec3(0.0f, 1.0f, 0.0f);
+	sample.Slope      = 0.0f;
+	sample.UnderWater = sample.Valid && sample.Height < Terrain::WATER_LEVEL;
+
+	if (!sample.Valid)
+		return sample;
+
+	// Central differences, one height sample apart. Past the built chunks the height of the
+	// position itself is used.
+	float offset       = m_chunks.find(GetChunkId(position))->second->Spacing;
+
+	float leftHeight   = sample.Height;
+	float rightHeight  = sample.Height;
+	float bottomHeight = sample.Height;
+	float topHeight    = sample.Height;
+
+	GetHeightUnlocked(position - vec2(offset, 0.0f), leftHeight);
+	GetHeightUnlocked(position + vec2(offset, 0.0f), rightHeight);
+	GetHeightUnlocked(position - vec2(0.0f, offset), bottomHeight);
+	GetHeightUnlocked(position + vec2(0.0f, offset), topHeight);
+
+	sample.Normal = normalize(vec3(leftHeight - rightHeight, 2.0f * offset, bottomHeight - topHeight));
+	sample.Slope  = acos(glm::clamp(sample.Normal.y, -1.0f, 1.0f));
+
+	return sample;
+}
+
+// Bilinear interpolation between the height samples of the chunk closest to the position.
+bool TerrainQuery::GetHeightUnlocked(const vec2& position, float& height) const
+{
+	auto chunkIt = m_chunks.find(GetChunkId(position));
+
+	if (chunkIt == m_chunks.end())
+		return false;
+
+	const ChunkData* chunkData      = chunkIt->second;
+	const uint16_t*  heights        = chunkData->Heights.data();
+	int              width          = chunkData->Width;
+
+	vec2             samplePosition = (position - chunkData->Origin) / chunkData->Spacing;
+
+	int              x              = std::min(std::max((int)floor(samplePosition.x), 0), width - 2);
+	int              z              = std::min(std::max((int)floor(samplePosition.y), 0), width - 2);
+
+	float            fractionX      = glm::clamp(samplePosition.x - (float)x, 0.0f, 1.0f);
+	float            fractionZ      = glm::clamp(samplePosition.y - (float)z, 0.0f, 1.0f);
+
+	float            bottomHeight   = mix((float)heights[z * width + x],       (float)heights[z * width + x + 1],       fractionX);
+	float            topHeight      = mix((float)heights[(z + 1) * width + x], (float)heights[(z + 1) * width + x + 1], fractionX);
+
+	height                          = mix(bottomHeight, topHeight, fractionZ) * chunkData->HeightScale + chunkData->HeightBias;
+
+	return true;
+}
+
+Vec2Int TerrainQuery::GetChunkId(const vec2& position) const
+{
+	float chunkStride = Terrain::CHUNK_WIDTH - Chunk::CHUNK_CLOSE_BIAS;
+
+	return make_pair((int)round(position.x / chunkStride), (int)round(position.y / chunkStride));
+}
+
+void TerrainQuery::BuildHeightPyramid(ChunkData* chunkData) const
+{
+	int width       = chunkData->Width;
+	int levelsCount = 1;
+
+	while ((1 << (levelsCount - 1)) < width)
+		levelsCount++;
+
+	chunkData->MinHeights.resize(levelsCount);
+	chunkData->MaxHeights.resize(levelsCount);
+
+	chunkData->MinHeights[0].resize(width * width);
+	chunkData->MaxHeights[0].resize(width * width);
+
+	for (int z = 0; z < width; z++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			int      nextX      = std::min(x + 1, width - 1);
+			int      nextZ      = std::min(z + 1, width - 1);
+
+			uint16_t corners[4] = { chunkData->Heights[z     * width + x], chunkData->Heights[z     * width + nextX],
+			                        chunkData->Heights[nextZ * width + x], chunkData->Heights[nextZ * width + nextX] };
+
+			chunkData->MinHeights[0][z * width + x] = *min_element(corners, corners + 4);
+			chunkData->MaxHeights[0][z * width + x] = *max_element(corners, corners + 4);
+		}
+	}
+
+	for (int level = 1; level < levelsCount; level++)
+	{
+		int levelWidth    = std::max(width >> level, 1);
+		int previousWidth = std::max(width >> (level - 1), 1);
+
+		chunkData->MinHeights[level].resize(levelWidth * levelWidth);
+		chunkData->MaxHeights[level].resize(levelWidth * levelWidth);
+
+		for (int z = 0; z < levelWidth; z++)
+		{
+			for (int x = 0; x < levelWidth; x++)
+			{
+				uint16_t minHeight = UINT16_MAX;
+				uint16_t maxHeight = 0;
+
+				for (int child = 0; child < 4; child++)
+				{
+					int childX = std::min(x * 2 + child % 2, previousWidth - 1);
+					int childZ = std::min(z * 2 + child / 2, previousWidth - 1);
+
+					minHeight  = std::min(minHeight, chunkData->MinHeights[level - 1][childZ * previousWidth + childX]);
+					maxHeight  = std::max(maxHeight, chunkData->MaxHeights[level - 1][childZ * previousWidth + childX]);
+				}
+
+				chunkData->MinHeights[level][z * levelWidth + x] = minHeight;
+				chunkData->MaxHeights[level][z * levelWidth + x] = maxHeight;
+			}
+		}
+	}
+}
+
+// Walks the chunks grid along the ray (2D DDA) and adds the part of the ray inside every built chunk.
+// Each chunk owns the positions closer to its center than to the other chunks' centers.
+void TerrainQuery::AddRaySegments(const Ray& ray, int rayIndex, unordered_map<Vec2Int, vector<RaySegment>, HashHelper::HashPair>& chunksSegments) const
+{
+	float chunkStride = Terrain::CHUNK_WIDTH - Chunk::CHUNK_CLOSE_BIAS;
+
+	float gridX       = ray.Origin.x / chunkStride + 0.5f;
+	float gridZ       = ray.Origin.z / chunkStride + 0.5f;
+
+	int   chunkX      = (int)floor(gridX);
+	int   chunkZ      = (int)floor(gridZ);
+
+	int   stepX       = ray.Direction.x > 0.0f ? 1 : -1;
+	int   stepZ       = ray.Direction.z > 0.0f ? 1 : -1;
+
+	float deltaX      = abs(ray.Direction.x) > FLT_EPSILON ? chunkStride / abs(ray.Direction.x) : FLT_MAX;
+	float deltaZ      = abs(ray.Direction.z) > FLT_EPSILON ? chunkStride / abs(ray.Direction.z) : FLT_MAX;
+
+	float nextX       = deltaX == FLT_MAX ? FLT_MAX : (ray.Direction.x > 0.0f ? (chunkX + 1 - gridX) : (gridX - chunkX)) * deltaX;
+	float nextZ       = deltaZ == FLT_MAX ? FLT_MAX : (ray.Direction.z > 0.0f ? (chunkZ + 1 - gridZ) : (gridZ - chunkZ)) * deltaZ;
+
+	float distance    = 0.0f;
+
+	while (distance < ray.MaxDistance)
+	{
+		float exitDistance = std::min(std::min(nextX, nextZ), ray.MaxDistance);
+		auto  chunkId      = make_pair(chunkX, chunkZ);
+
+		if (m_chunks.find(chunkId) != m_chunks.end())
+			chunksSegments[chunkId].push_back({ rayIndex, distance, exitDistance });
+
+		distance = exitDistance;
+
+		if (nextX < nextZ)
+		{
+			chunkX += stepX;
+			nextX  += deltaX;
+		}
+		else
+		{
+			chunkZ += stepZ;
+			nextZ  += deltaZ;
+		}
+	}
+}
+
+// Descends the min/max pyramid with all the rays of the packet at once: a node is visited when any
+// ray of the packet hits its box before the closest hit found so far. The children are visited
+// front to back, following the direction of the first ray, and the cells of the finest level are
+// intersected as the two triangles of the terrain mesh.
+void TerrainQuery::TraversePacket(const ChunkData* chunkData, RayPacket& packet) const
+{
+	struct NodeEntry
+	{
+		int Level;
+		int X;
+		int Z;
+	};
+
+	int       levelsCount = (int)chunkData->MinHeights.size();
+	int       width       = chunkData->Width;
+	float     spacing     = chunkData->Spacing;
+
+	NodeEntry stack[64];
+	int       stackSize   = 0;
+
+	alignas(16) float directions[2][PACKET_SIZE];
+	_mm_store_ps(directions[0], packet.DirectionX);
+	_mm_store_ps(directions[1], packet.DirectionZ);
+
+	bool      reverseX    = directions[0][0] < 0.0f;
+	bool      reverseZ    = directions[1][0] < 0.0f;
+
+	stack[stackSize++]    = { levelsCount - 1, 0, 0 };
+
+	while (stackSize > 0)
+	{
+		NodeEntry node       = stack[--stackSize];
+
+		int       levelWidth = std::max(width >> node.Level, 1);
+		int       cellsCount = 1 << node.Level;
+
+		float     minX       = chunkData->Origin.x + (float)(node.X * cellsCount)       * spacing;
+		float     maxX       = chunkData->Origin.x + (float)((node.X + 1) * cellsCount) * spacing;
+		float     minZ       = chunkData->Origin.y + (float)(node.Z * cellsCount)       * spacing;
+		float     maxZ       = chunkData->Origin.y + (float)((node.Z + 1) * cellsCount) * spacing;
+		float     minY       = chunkData->MinHeights[node.Level][node.Z * levelWidth + node.X] * chunkData->HeightScale + chunkData->HeightBias;
+		float     maxY       = chunkData->MaxHeights[node.Level][node.Z * levelWidth + node.X] * chunkData->HeightScale + chunkData->HeightBias;
+
+		__m128 nearX  = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(minX), packet.OriginX), packet.InverseDirectionX);
+		__m128 farX   = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(maxX), packet.OriginX), packet.InverseDirectionX);
+		__m128 nearY  = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(minY), packet.OriginY), packet.InverseDirectionY);
+		__m128 farY   = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(maxY), packet.OriginY), packet.InverseDirectionY);
+		__m128 nearZ  = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(minZ), packet.OriginZ), packet.InverseDirectionZ);
+		__m128 farZ   = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(maxZ), packet.OriginZ), packet.InverseDirectionZ);
+
+		__m128 enter  = _mm_max_ps(_mm_max_ps(_mm_min_ps(nearX, farX), _mm_min_ps(nearY, farY)),
+		                           _mm_max_ps(_mm_min_ps(nearZ, farZ), packet.MinDistance));
+		__m128 exit   = _mm_min_ps(_mm_min_ps(_mm_max_ps(nearX, farX), _mm_max_ps(nearY, farY)),
+		                           _mm_min_ps(_mm_max_ps(nearZ, farZ), packet.MaxDistance));
+
+		__m128 active = _mm_cmple_ps(enter, exit);
+
+		if (!_mm_movemask_ps(active))
+			continue;
+
+		if (node.Level > 0)
+		{
+			// Pushed back to front, so the front child is popped first.
+			for (int child = 3; child >= 0; child--)
+			{
+				int childX = node.X * 2 + ((child % 2) ^ (reverseX ? 1 : 0));
+				int childZ = node.Z * 2 + ((child / 2) ^ (reverseZ ? 1 : 0));
+
+				if (childX < (width >> (node.Level - 1)) && childZ < (width >> (node.Level - 1)))
+					stack[stackSize++] = { node.Level - 1, childX, childZ };
+			}
+
+			continue;
+		}
+
+		int   nextX     = std::min(node.X + 1, width - 1);
+		int   nextZ     = std::min(node.Z + 1, width - 1);
+
+		float height00  = chunkData->Heights[node.Z * width + node.X] * chunkData->HeightScale + chunkData->HeightBias;
+		float height10  = chunkData->Heights[node.Z * width + nextX]  * chunkData->HeightScale + chunkData->HeightBias;
+		float height01  = chunkData->Heights[nextZ  * width + node.X] * chunkData->HeightScale + chunkData->HeightBias;
+		float height11  = chunkData->Heights[nextZ  * width + nextX]  * chunkData->HeightScale + chunkData->HeightBias;
+
+		vec3  corner00  = vec3(minX, height00, minZ);
+		vec3  corner10  = vec3(maxX, height10, minZ);
+		vec3  corner01  = vec3(minX, height01, maxZ);
+		vec3  corner11  = vec3(maxX, height11, maxZ);
+
+		vec3  triangles[2][3] = { { corner00, corner01, corner10 },
+		                          { corner10, corner01, corner11 } };
+
+		for (auto& triangle : triangles)
+		{
+			// Moller-Trumbore, for the 4 rays at once.
+			vec3   edge1       = triangle[1] - triangle[0];
+			vec3   edge2       = triangle[2] - triangle[0];
+			vec3   normal      = normalize(cross(edge1, edge2));
+
+			__m128 edge1X      = _mm_set1_ps(edge1.x);
+			__m128 edge1Y      = _mm_set1_ps(edge1.y);
+			__m128 edge1Z      = _mm_set1_ps(edge1.z);
+			__m128 edge2X      = _mm_set1_ps(edge2.x);
+			__m128 edge2Y      = _mm_set1_ps(edge2.y);
+			__m128 edge2Z      = _mm_set1_ps(edge2.z);
+
+			__m128 pX          = _mm_sub_ps(_mm_mul_ps(packet.DirectionY, edge2Z), _mm_mul_ps(packet.DirectionZ, edge2Y));
+			__m128 pY          = _mm_sub_ps(_mm_mul_ps(packet.DirectionZ, edge2X), _mm_mul_ps(packet.DirectionX, edge2Z));
+			__m128 pZ          = _mm_sub_ps(_mm_mul_ps(packet.DirectionX, edge2Y), _mm_mul_ps(packet.DirectionY, edge2X));
+
+			__m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge1X, pX), _mm_mul_ps(edge1Y, pY)), _mm_mul_ps(edge1Z, pZ));
+			__m128 inverse     = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+
+			__m128 sX          = _mm_sub_ps(packet.OriginX, _mm_set1_ps(triangle[0].x));
+			__m128 sY          = _mm_sub_ps(packet.OriginY, _mm_set1_ps(triangle[0].y));
+			__m128 sZ          = _mm_sub_ps(packet.OriginZ, _mm_set1_ps(triangle[0].z));
+
+			__m128 u           = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sX, pX), _mm_mul_ps(sY, pY)), _mm_mul_ps(sZ, pZ)), inverse);
+
+			__m128 qX          = _mm_sub_ps(_mm_mul_ps(sY, edge1Z), _mm_mul_ps(sZ, edge1Y));
+			__m128 qY          = _mm_sub_ps(_mm_mul_ps(sZ, edge1X), _mm_mul_ps(sX, edge1Z));
+			__m128 qZ          = _mm_sub_ps(_mm_mul_ps(sX, edge1Y), _mm_mul_ps(sY, edge1X));
+
+			__m128 v           = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(packet.DirectionX, qX), _mm_mul_ps(packet.DirectionY, qY)), _mm_mul_ps(packet.DirectionZ, qZ)), inverse);
+			__m128 t           = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edge2X, qX), _mm_mul_ps(edge2Y, qY)), _mm_mul_ps(edge2Z, qZ)), inverse);
+
+			__m128 absoluteDeterminant = _mm_max_ps(determinant, _mm_sub_ps(_mm_setzero_ps(), determinant));
+
+			__m128 hit         = _mm_and_ps(active, _mm_cmpgt_ps(absoluteDeterminant, _mm_set1_ps(FLT_EPSILON)));
+			       hit         = _mm_and_ps(hit, _mm_cmpge_ps(u, _mm_setzero_ps()));
+			       hit         = _mm_and_ps(hit, _mm_cmpge_ps(v, _mm_setzero_ps()));
+			       hit         = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+			       hit         = _mm_and_ps(hit, _mm_cmpge_ps(t, packet.MinDistance));
+			       hit         = _mm_and_ps(hit, _mm_cmplt_ps(t, packet.MaxDistance));
+
+			packet.MaxDistance = Select(hit, t,                      packet.MaxDistance);
+			packet.NormalX     = Select(hit, _mm_set1_ps(normal.x), packet.NormalX);
+			packet.NormalY     = Select(hit, _mm_set1_ps(normal.y), packet.NormalY);
+			packet.NormalZ     = Select(hit, _mm_set1_ps(normal.z), packet.NormalZ);
+		}
+	}
+}
\ No newline at end of file
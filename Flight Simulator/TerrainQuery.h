@@ -0,0 +1,133 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <shared_mutex>
+#include <glm/glm.hpp>
+#include "Utils.h"
+
+// CPU copy of the terrain for the gameplay code (ground proximity, collisions, line of sight). Every
+// built chunk registers its heights, quantized to 16 bits, and its folliage placements; the queries
+// only take a shared lock, so they can run on any thread while the chunks are streamed in and out.
+class TerrainQuery
+{
+public:
+
+	struct TerrainSample
+	{
+	public:
+
+		bool      Valid;      // false when the chunk under the position isn't built yet
+		float     Height;
+		glm::vec3 Normal;
+		float     Slope;      // the angle between the normal and the up vector, in radians
+		bool      UnderWater; // the ground is below the water level
+	};
+
+	struct Ray
+	{
+	public:
+
+		glm::vec3 Origin;
+		glm::vec3 Direction;   // normalized
+		float     MaxDistance;
+	};
+
+	struct RayHit
+	{
+	public:
+
+		bool      Hit;
+		float     Distance;
+		glm::vec3 Position;
+		glm::vec3 Normal;
+	};
+
+private:
+
+	static const int PACKET_SIZE          = 4; // the rays traversing a chunk together, one per SSE lane
+
+	static const int OBSTACLE_CELLS_COUNT = 8; // the obstacles are bucketed in a grid of cells per chunk
+
+	struct ChunkData
+	{
+	public:
+
+		glm::vec2                           Origin;  // the world position of the first height sample
+		int                                 Width;
+		float                               Spacing;
+
+		std::vector<uint16_t>               Heights; // height = value * HeightScale + HeightBias
+		float                               HeightScale;
+		float                               HeightBias;
+
+		// Min/max pyramid over the cells between the height samples, level 0 has a cell per
+		// sample (the last row and column are clamped), every next level halves the resolution.
+		std::vector<std::vector<uint16_t>>  MinHeights;
+		std::vector<std::vector<uint16_t>>  MaxHeights;
+
+		std::vector<std::vector<glm::vec3>> ObstacleCells;
+	};
+
+	struct RaySegment
+	{
+	public:
+
+		int   RayIndex;
+		float EnterDistance;
+		float ExitDistance;
+	};
+
+	struct RayPacket;
+
+public:
+
+	TerrainQuery(const TerrainQuery&)   = delete;
+	void operator=(const TerrainQuery&) = delete;
+
+	~TerrainQuery();
+
+	static TerrainQuery* GetInstance(); // the instance is created by main, before any other thread uses it
+	static void          FreeInstance();
+
+	       // Called by the chunks, from the thread that streams them.
+	       void          AddChunkHeights(Vec2Int, float**, int);
+	       void          AddChunkObstacles(Vec2Int, const std::vector<glm::vec3>&);
+	       void          RemoveChunk(Vec2Int);
+
+	       TerrainSample Sample(const glm::vec2&)                                         const;
+	       void          Sample(const std::vector<glm::vec2>&, std::vector<TerrainSample>&) const;
+
+	       bool          GetHeight(const glm::vec2&, float&)                              const;
+	       bool          GetNormal(const glm::vec2&, glm::vec3&)                          const;
+	       bool          GetSlope(const glm::vec2&, float&)                               const;
+	       bool          IsUnderWater(const glm::vec2&)                                   const;
+
+	       // The closest folliage placement within the distance, false if there's none.
+	       bool          FindNearestObstacle(const glm::vec3&, float, glm::vec3&)         const;
+
+	       // The rays are split in segments per chunk and the segments crossing the same chunk
+	       // traverse its min/max pyramid in packets; only the built chunks are hit.
+	       RayHit        CastRay(const Ray&)                                              const;
+	       void          CastRays(const std::vector<Ray>&, std::vector<RayHit>&)           const;
+
+private:
+
+	TerrainQuery();
+
+	       TerrainSample SampleUnlocked(const glm::vec2&)                const;
+	       bool          GetHeightUnlocked(const glm::vec2&, float&)     const;
+
+	       Vec2Int       GetChunkId(const glm::vec2&)                    const;
+
+	       void          BuildHeightPyramid(ChunkData*)                  const;
+	       void          AddRaySegments(const Ray&, int, std::unordered_map<Vec2Int, std::vector<RaySegment>, HashHelper::HashPair>&) const;
+	       void          TraversePacket(const ChunkData*, RayPacket&)    const;
+
+private:
+
+	mutable std::shared_timed_mutex                               m_mutex;
+	std::unordered_map<Vec2Int, ChunkData*, HashHelper::HashPair> m_chunks;
+
+	static TerrainQuery*                                          g_instance;
+};
\ No newline at end of file
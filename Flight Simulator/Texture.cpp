@@ -128,6 +128,14 @@ int Texture::GetHeight() const
     return GetCurrentTextureInfo().Height;
 }
 
+void Texture::SetWrap(Wrap wrap)
+{
+    glBindTexture(GL_TEXTURE_2D, GetTextureID());
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GetGLParam(wrap));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GetGLParam(wrap));
+}
+
 float** Texture::GetDownscaleValues(DownscaleShaderProperties shaderProps, int levels)
 {
     int divisionsCount  = 1 << (levels - 1);
@@ -139,8 +147,8 @@ float** Texture::GetDownscaleValues(DownscaleShaderProperties shaderProps, int l
     assert(GetWidth() > divisionsCount && divisionsCount > 0 &&
         "The width of the noise texture must be greater than the width of the texture containing the downscaled image.");
 
-    assert(GetWidth() % levels == 0 && ((div2 & (div2 - 1)) == 0) &&
-        "Texture width has to be equal to levels * pow(2, k), where k > 1.");
+    assert(GetWidth() % divisionsCount == 0 && ((div2 & (div2 - 1)) == 0) &&
+        "Texture width has to be equal to pow(2, levels - 1) * pow(2, k), where k > 1.");
 
     Texture* currentTexture = this;
     Texture* newTexture     = nullptr;
@@ -219,20 +227,48 @@ float** Texture::GetPixelsInfo(Texture* texture)
     return result;
 }
 
+Texture* Texture::GetQuantizedTexture(Shader* quantizeShader, Format format, float scale, float bias)
+{
+    Texture* result = new Texture(GetWidth(), GetHeight(), format, Texture::Format::RED, Texture::Filter::Linear);
+
+    quantizeShader->Use();
+    quantizeShader->SetImage2D("ImageInput",  this,   0, Texture::Format::R32F);
+    quantizeShader->SetImage2D("ImageOutput", result, 1, format);
+    quantizeShader->SetFloat("Scale",         scale);
+    quantizeShader->SetFloat("Bias",          bias);
+
+    glDispatchCompute(GetComputeShaderGroupsCount(GetWidth(),  8),
+                      GetComputeShaderGroupsCount(GetHeight(), 8), 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    glBindTexture(GL_TEXTURE_2D, result->GetTextureID());
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    return result;
+}
+
 int Texture::GetGLFormat(Format format)
 {
     switch (format)
     {
     case Format::RGBA32F:
         return GL_RGBA32F;
+    case Format::RGBA8:
+        return GL_RGBA8;
     case Format::RGBA:
         return GL_RGBA;
     case Format::RED:
         return GL_RED;
     case Format::R8:
         return GL_R8;
+    case Format::R16:
+        return GL_R16;
     case Format::R32F:
         return GL_R32F;
+    case Format::RG:
+        return GL_RG;
+    case Format::RG32F:
+        return GL_RG32F;
     }
 
     cout << "ERROR::TEXTURE::INVALID::FORMAT" << endl;
@@ -255,6 +291,23 @@ int Texture::GetGLParam(Filter filter)
     return -1;
 }
 
+int Texture::GetGLParam(Wrap wrap)
+{
+    switch (wrap)
+    {
+    case Wrap::MirroredRepeat:
+        return GL_MIRRORED_REPEAT;
+    case Wrap::Repeat:
+        return GL_REPEAT;
+    case Wrap::ClampToEdge:
+        return GL_CLAMP_TO_EDGE;
+    }
+
+    cout << "ERROR::TEXTURE::INVALID::WRAP" << endl;
+
+    return -1;
+}
+
 uint32_t Texture::GetComputeShaderGroupsCount(const uint32_t size, const uint32_t numBlocks)
 {
     return (size + numBlocks - 1) / numBlocks;
@@ -12,10 +12,14 @@ public:
     enum class Format
     {
         RGBA32F,
+        RGBA8,
         RGBA,
         RED,
         R8,
-        R32F
+        R16,
+        R32F,
+        RG,
+        RG32F
     };
 
     enum class Filter
@@ -24,6 +28,13 @@ public:
         Point
     };
 
+    enum class Wrap
+    {
+        MirroredRepeat,
+        Repeat,
+        ClampToEdge
+    };
+
     struct DownscaleShaderProperties
     {
         Shader* Shader;
@@ -71,12 +82,18 @@ public:
            int          GetWidth()     const;
            int          GetHeight()    const;
 
-           // These two methods only work for grayscale images.
+           void         SetWrap(Wrap);
+
+           // These three methods only work for grayscale images.
            float**      GetDownscaleValues(DownscaleShaderProperties, int);
     static float**      GetPixelsInfo(Texture*);
 
+           // A copy of the R32F texture in a normalized format (R16, R8), storing (value - bias) / scale.
+           Texture*     GetQuantizedTexture(Shader*, Format, float, float);
+
     static int          GetGLFormat(Format);
     static int          GetGLParam(Filter);
+    static int          GetGLParam(Wrap);
     static uint32_t     GetComputeShaderGroupsCount(const uint32_t, const uint32_t);
 
     static unsigned int CreateMinMaxBuffer();
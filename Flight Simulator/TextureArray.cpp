@@ -0,0 +1,75 @@
+#include <cmath>
+#include <algorithm>
+
+#include "glad/glad.h"
+#include "TextureArray.h"
+
+using namespace std;
+
+TextureArray::TextureArray(int width, int height, int layersCount, Texture::Format internalFormat) :
+	m_width(width),
+	m_height(height),
+	m_layersCount(layersCount)
+{
+	int mipLevelsCount = 1 + (int)floor(log2((float)max(width, height)));
+
+	glGenTextures(1, &m_textureID);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureID);
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, mipLevelsCount, Texture::GetGLFormat(internalFormat), width, height, layersCount);
+}
+
+TextureArray::~TextureArray()
+{
+	glDeleteTextures(1, &m_textureID);
+}
+
+void TextureArray::SetLayer(int layer, Texture* texture)
+{
+	unsigned int frameBuffers[2];
+	glGenFramebuffers(2, frameBuffers);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, frameBuffers[0]);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture->GetTextureID(), 0);
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frameBuffers[1]);
+	glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_textureID, 0, layer);
+
+	glBlitFramebuffer(0, 0, texture->GetWidth(), texture->GetHeight(),
+		              0, 0, m_width,             m_height,
+		              GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(2, frameBuffers);
+}
+
+void TextureArray::GenerateMipmaps()
+{
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureID);
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+}
+
+unsigned int TextureArray::GetTextureID() const
+{
+	return m_textureID;
+}
+
+int TextureArray::GetWidth() const
+{
+	return m_width;
+}
+
+int TextureArray::GetHeight() const
+{
+	return m_height;
+}
+
+int TextureArray::GetLayersCount() const
+{
+	return m_layersCount;
+}
\ No newline at end of file
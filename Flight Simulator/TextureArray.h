@@ -0,0 +1,28 @@
+#pragma once
+#include "Texture.h"
+
+class TextureArray
+{
+public:
+
+	TextureArray(int, int, int,
+		         Texture::Format = Texture::Format::RGBA8);
+	~TextureArray();
+
+	void         SetLayer(int, Texture*); // the texture is rescaled to the size of the array
+	void         GenerateMipmaps();
+
+	unsigned int GetTextureID()   const;
+
+	int          GetWidth()       const;
+	int          GetHeight()      const;
+	int          GetLayersCount() const;
+
+private:
+
+	unsigned int m_textureID;
+
+	int          m_width;
+	int          m_height;
+	int          m_layersCount;
+};
\ No newline at end of file
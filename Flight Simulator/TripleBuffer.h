@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+
+// Hands the latest value written by a producer thread to a consumer thread without locks. The
+// producer fills the back slot and swaps it with the middle one, the consumer swaps the middle
+// slot with its front one only when a newer value was published; neither of them ever waits.
+template <class T>
+class TripleBuffer
+{
+private:
+
+	static const int INDEX_MASK = 3;
+	static const int FRESH_BIT  = 4;
+
+public:
+
+	TripleBuffer() :
+		m_backIndex(0),
+		m_middleIndex(1),
+		m_frontIndex(2)
+	{
+	}
+
+	TripleBuffer(const TripleBuffer&)   = delete;
+	void operator=(const TripleBuffer&) = delete;
+
+	// Producer side.
+	T& GetBack()
+	{
+		return m_slots[m_backIndex];
+	}
+
+	void Publish()
+	{
+		m_backIndex = m_middleIndex.exchange(m_backIndex | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	// Consumer side, the value stays valid until the next call.
+	const T& GetFront()
+	{
+		if (m_middleIndex.load(std::memory_order_acquire) & FRESH_BIT)
+			m_frontIndex = m_middleIndex.exchange(m_frontIndex, std::memory_order_acq_rel) & INDEX_MASK;
+
+		return m_slots[m_frontIndex];
+	}
+
+private:
+
+	T                m_slots[3];
+
+	int              m_backIndex;
+	std::atomic<int> m_middleIndex;
+	int              m_frontIndex;
+};
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include <string>
+#include <algorithm>
+
+#include "WorkerPool.h"
+#include "Profiler.h"
+
+using namespace std;
+
+WorkerPool* WorkerPool::g_instance = nullptr;
+
+WorkerPool::~WorkerPool()
+{
+	{
+		lock_guard<mutex> lock(m_jobsMutex);
+		m_running = false;
+	}
+
+	m_jobsCondition.notify_all();
+
+	for (auto& worker : m_workers)
+	{
+		if (worker.joinable())
+			worker.join();
+	}
+}
+
+WorkerPool* WorkerPool::GetInstance()
+{
+	if (!g_instance)
+		g_instance = new WorkerPool();
+
+	return g_instance;
+}
+
+void WorkerPool::FreeInstance()
+{
+	if (g_instance)
+	{
+		delete g_instance;
+		g_instance = nullptr;
+	}
+}
+
+void WorkerPool::Submit(JobFunction function, void* data, JobCounter& counter)
+{
+	Job  job    = { function, data, &counter };
+	bool queued = false;
+
+	counter.PendingCount.fetch_add(1);
+
+	{
+		lock_guard<mutex> lock(m_jobsMutex);
+
+		if (m_jobsCount < MAX_JOBS)
+		{
+			m_jobs[(m_firstJob + m_jobsCount) % MAX_JOBS] = job;
+			m_jobsCount++;
+
+			queued = true;
+		}
+	}
+
+	if (queued)
+		m_jobsCondition.notify_one();
+	else
+		RunJob(job);
+}
+
+void WorkerPool::Wait(JobCounter& counter)
+{
+	while (counter.PendingCount.load(memory_order_acquire) > 0)
+	{
+		Job  job;
+		bool hasJob;
+
+		{
+			lock_guard<mutex> lock(m_jobsMutex);
+			hasJob = PopJob(job);
+		}
+
+		if (hasJob)
+			RunJob(job);
+		else
+			this_thread::yield();
+	}
+}
+
+int WorkerPool::GetWorkersCount() const
+{
+	return (int)m_workers.size();
+}
+
+// The main and the simulation threads keep a core each.
+WorkerPool::WorkerPool() :
+	m_running(true),
+	m_firstJob(0),
+	m_jobsCount(0)
+{
+	int workersCount = max((int)thread::hardware_concurrency() - 2, 1);
+
+	for (int i = 0; i < workersCount; i++)
+		m_workers.push_back(thread(&WorkerPool::Run, this, i));
+}
+
+void WorkerPool::Run(int workerIndex)
+{
+	Profiler::GetInstance()->SetThreadName("Worker thread " + to_string(workerIndex));
+
+	while (true)
+	{
+		Job job;
+
+		{
+			unique_lock<mutex> lock(m_jobsMutex);
+			m_jobsCondition.wait(lock, [this]() { return !m_running || m_jobsCount > 0; });
+
+			if (!PopJob(job))
+				return;
+		}
+
+		RunJob(job);
+	}
+}
+
+bool WorkerPool::PopJob(Job& job)
+{
+	if (m_jobsCount == 0)
+		return false;
+
+	job        = m_jobs[m_firstJob];
+	m_firstJob = (m_firstJob + 1) % MAX_JOBS;
+	m_jobsCount--;
+
+	return true;
+}
+
+void WorkerPool::RunJob(const Job& job)
+{
+	job.Function(job.Data);
+	job.Counter->PendingCount.fetch_sub(1, memory_order_release);
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+
+// A fixed set of threads running the CPU only jobs of a frame (culling, instance building). The
+// jobs must not make GL calls, only the main thread owns the GL context. A job is a function and
+// a pointer to its data (usually in the FrameArena), queued in a fixed ring and counted down on a
+// JobCounter, so submitting and waiting never go to the heap.
+class WorkerPool
+{
+public:
+
+	static const int MAX_JOBS = 256; // the jobs submitted with a full queue run on the calling thread
+
+	typedef void (*JobFunction)(void*);
+
+	// The jobs of a batch still queued or running.
+	class JobCounter
+	{
+	public:
+
+		JobCounter() : PendingCount(0) {}
+
+		std::atomic<int> PendingCount;
+	};
+
+private:
+
+	struct Job
+	{
+	public:
+
+		JobFunction Function;
+		void*       Data;
+		JobCounter* Counter;
+	};
+
+public:
+
+	WorkerPool(const WorkerPool&)     = delete;
+	void operator=(const WorkerPool&) = delete;
+
+	~WorkerPool();
+
+	static WorkerPool* GetInstance();
+	static void        FreeInstance();
+
+	       void        Submit(JobFunction, void*, JobCounter&);
+	       // Runs the queued jobs on the calling thread until the ones of the counter are done.
+	       void        Wait(JobCounter&);
+	       int         GetWorkersCount() const;
+
+private:
+
+	WorkerPool();
+
+	void Run(int);
+	bool PopJob(Job&); // m_jobsMutex must be locked
+	void RunJob(const Job&);
+
+private:
+
+	       std::vector<std::thread>  m_workers;
+	       std::atomic<bool>         m_running;
+
+	       std::mutex                m_jobsMutex;
+	       std::condition_variable   m_jobsCondition;
+	       Job                       m_jobs[MAX_JOBS]; // ring
+	       int                       m_firstJob;
+	       int                       m_jobsCount;
+
+	static WorkerPool*               g_instance;
+};
\ No newline at end of file
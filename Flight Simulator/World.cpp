@@ -9,11 +9,17 @@
 #include <glm/ext/matrix_transform.hpp>
 #include "Biome.h"
 #include "RenderSettings.h"
+#include "StartupProfiler.h"
+#include "Profiler.h"
+#include "GpuProfiler.h"
 
 using namespace std;
 using namespace glm;
 
 World::World(int windowWidth, int windowHeight) :
+	m_reflectionAuxiliaryRenderTexture(nullptr),
+	m_reflectionRenderTexture(nullptr),
+	m_framesCount(0),
 	m_renderDebug(false),
 	m_renderFoliage(true)
 {
@@ -25,15 +31,28 @@ World::World(int windowWidth, int windowHeight) :
 
 	m_camera  = new Camera(radians(45.0f), (float)windowWidth, (float)windowHeight, 0.1f, 1000.0f);
 	m_reflectionCamera = new ReflectionCamera(m_camera, Terrain::WATER_LEVEL);
+
+	StartupProfiler* startupProfiler = StartupProfiler::GetInstance();
+
+	startupProfiler->BeginPhase("Skybox creation");
 	m_skybox  = new Skybox();
+	startupProfiler->EndPhase();
+
+	startupProfiler->BeginPhase("Terrain creation");
 	m_terrain = new Terrain();
+	startupProfiler->EndPhase();
+
+	startupProfiler->BeginPhase("Render textures creation");
 
 	m_auxilliaryRenderTexture               = new RenderTexture(windowWidth, windowHeight);
 	m_aboveRefractionAuxiliaryRenderTexture = new RenderTexture(windowWidth, windowHeight);
 	m_refractionAuxiliaryRenderTexture      = new RenderTexture(windowWidth, windowHeight);
-	m_reflectionRenderTexture               = new RenderTexture(windowWidth, windowHeight);
 	m_refractionRenderTexture               = new RenderTexture(windowWidth, windowHeight);
 	m_aboveRefractionRenderTexture          = new RenderTexture(windowWidth, windowHeight);
+	m_sceneCopyRenderTexture                = new RenderTexture(windowWidth, windowHeight);
+
+	CreateReflectionRenderTextures();
+	startupProfiler->EndPhase();
 
 	Clouds::CloudsProperties cloudsProperties;
 	cloudsProperties.OffsetVelocity = vec3(.01f, .02f, .03f);
@@ -41,17 +60,34 @@ World::World(int windowWidth, int windowHeight) :
 	cloudsProperties.CloudBoxExtents = vec2(200.0f, 200.0f);
 	cloudsProperties.CloudsAltitude = 125.0f;
 
+	startupProfiler->BeginPhase("Clouds creation");
 	m_clouds = new Clouds(cloudsProperties);
+	startupProfiler->EndPhase();
+
+	m_simulation     = new Simulation(m_camera->GetPosition(), m_camera->GetRotation());
+	m_simulationTime = 0.0;
 }
 
 World::~World()
 {
+	if (m_simulation)
+	{
+		delete m_simulation;
+		m_simulation = nullptr;
+	}
+
 	if (m_clouds)
 	{
 		delete m_clouds;
 		m_clouds = nullptr;
 	}
 
+	if (m_sceneCopyRenderTexture)
+	{
+		delete m_sceneCopyRenderTexture;
+		m_sceneCopyRenderTexture = nullptr;
+	}
+
 	if (m_aboveRefractionRenderTexture)
 	{
 		delete m_aboveRefractionRenderTexture;
@@ -64,11 +100,7 @@ World::~World()
 		m_refractionRenderTexture = nullptr;
 	}
 
-	if (m_reflectionRenderTexture)
-	{
-		delete m_reflectionRenderTexture;
-		m_reflectionRenderTexture = nullptr;
-	}
+	FreeReflectionRenderTextures();
 
 	if (m_refractionAuxiliaryRenderTexture)
 	{
@@ -124,16 +156,44 @@ void World::UpdateWindowSize(int width, int height)
 	m_camera->UpdateWindowSize(width, height);
 }
 
-void World::Update(float deltaTime)
+void World::Update()
 {
-	m_camera->Update(deltaTime);
+	ProfileZone   profileZone("World::Update");
+
+	Profiler*     profiler     = Profiler::GetInstance();
+	GpuProfiler*  gpuProfiler  = GpuProfiler::GetInstance();
+	InputWrapper* inputWrapper = InputWrapper::GetInstance();
+
+	vec3 translation = vec3(0.0f, 0.0f, 0.0f);
+
+	if (inputWrapper->GetKey(InputWrapper::Keys::Up))
+		translation.z -= 1.0f;
+
+	if (inputWrapper->GetKey(InputWrapper::Keys::Left))
+		translation.x -= 1.0f;
+
+	if (inputWrapper->GetKey(InputWrapper::Keys::Down))
+		translation.z += 1.0f;
+
+	if (inputWrapper->GetKey(InputWrapper::Keys::Right))
+		translation.x += 1.0f;
+
+	m_simulation->AddInput(inputWrapper->GetMouseMoveDiff(), translation);
+
+	// The frame advances by the simulation time it shows, the rest of the world animates with it.
+	Simulation::State simulationState = m_simulation->GetInterpolatedState();
+
+	float deltaTime  = (float)std::max(simulationState.Time - m_simulationTime, 0.0);
+	m_simulationTime = std::max(simulationState.Time, m_simulationTime);
+
+	m_camera->SetTransform(simulationState.CameraPosition, simulationState.CameraRotation);
 	m_reflectionCamera->Update(deltaTime);
 	m_clouds->Update(deltaTime);
 
-	if (InputWrapper::GetInstance()->GetKeyUp(InputWrapper::Keys::Debug))
+	if (inputWrapper->GetKeyUp(InputWrapper::Keys::Debug))
 		m_renderDebug = !m_renderDebug;
 
-	if (InputWrapper::GetInstance()->GetKeyUp(InputWrapper::Keys::Foliage))
+	if (inputWrapper->GetKeyUp(InputWrapper::Keys::Foliage))
 		m_renderFoliage = !m_renderFoliage;
 
 	if (m_renderDebug)
@@ -141,26 +201,82 @@ void World::Update(float deltaTime)
 
 	RenderSettings* renderSettings = RenderSettings::GetInstance();
 
-	m_terrain->Udpate(m_reflectionCamera, 0.0f, m_renderDebug, m_renderFoliage);
-	renderSettings->EnablePlaneClipping(vec4(0.0f, 1.0f, 0.0f, -Terrain::WATER_LEVEL));
-	RenderScene(m_auxilliaryRenderTexture, m_reflectionCamera, true, m_reflectionRenderTexture);
-	
-	m_terrain->Udpate(m_camera, deltaTime, m_renderDebug, m_renderFoliage);
+	// The reflection is only seen through the distorted water surface, so it's rendered
+	// at a lower resolution, without some of the content, and not necessarily every frame.
+	bool renderReflection  = m_framesCount++ % renderSettings->ReflectionUpdateInterval() == 0;
+	bool reflectionFoliage = m_renderFoliage && renderSettings->ReflectionFoliage();
+
+	m_terrain->UpdateStreaming(m_camera, deltaTime);
 
-	renderSettings->EnablePlaneClipping(vec4(0.0f, 1.0f, 0.0f, -Terrain::WATER_LEVEL));
-	RenderScene(m_aboveRefractionAuxiliaryRenderTexture, m_camera, false, m_aboveRefractionRenderTexture);
-	renderSettings->DisablePlaneClipping();
+	// The views are culled and their folliage instances built on the worker threads, while this
+	// thread submits the clouds volumes and the reflection pass.
+	m_terrain->BeginPrepareView(Terrain::View::Main, m_camera->GetSnapshot(), m_renderDebug, m_renderFoliage, true);
 
-	renderSettings->EnablePlaneClipping(vec4(0.0f, -1.0f, 0.0f, Terrain::WATER_LEVEL));
-	RenderScene(m_refractionAuxiliaryRenderTexture, m_camera, false, m_refractionRenderTexture);
-	renderSettings->DisablePlaneClipping();
+	if (renderReflection)
+	{
+		// Nothing under the water would be rasterized anyway, and the reflection never shows the water.
+		Camera::Snapshot reflectionSnapshot = m_reflectionCamera->GetSnapshot();
+		reflectionSnapshot.Frustum.SetClipPlane(vec4(0.0f, 1.0f, 0.0f, -Terrain::WATER_LEVEL));
+
+		m_terrain->BeginPrepareView(Terrain::View::Reflection, reflectionSnapshot, m_renderDebug, reflectionFoliage, false);
+	}
 
-	m_terrain->UpdateWater(m_camera, deltaTime, m_renderDebug);
+	profiler->BeginZone("Clouds volumes");
+	gpuProfiler->BeginZone("Clouds volumes");
+	m_clouds->UpdateOccupancyGrid(m_camera);
+	m_clouds->UpdateLightVolume(m_camera, m_light);
+	gpuProfiler->EndZone();
+	profiler->EndZone();
+
+	if (renderReflection)
+	{
+		if (m_reflectionResolutionScale != renderSettings->ReflectionResolutionScale())
+			CreateReflectionRenderTextures();
+
+		profiler->BeginZone("Reflection pass");
+		gpuProfiler->BeginZone("Reflection pass");
+		m_terrain->EndPrepareView(Terrain::View::Reflection);
+		renderSettings->EnablePlaneClipping(vec4(0.0f, 1.0f, 0.0f, -Terrain::WATER_LEVEL));
+		RenderScene(m_reflectionAuxiliaryRenderTexture, m_reflectionCamera, renderSettings->ReflectionClouds(), reflectionFoliage, m_reflectionRenderTexture);
+		renderSettings->DisablePlaneClipping();
+		gpuProfiler->EndZone();
+		profiler->EndZone();
+	}
+	
+	m_terrain->EndPrepareView(Terrain::View::Main);
+
+	// With scene refraction the final pass provides the refraction color and depth itself.
+	if (!renderSettings->SceneRefraction())
+	{
+		profiler->BeginZone("Above refraction pass");
+		gpuProfiler->BeginZone("Above refraction pass");
+		renderSettings->EnablePlaneClipping(vec4(0.0f, 1.0f, 0.0f, -Terrain::WATER_LEVEL));
+		RenderScene(m_aboveRefractionAuxiliaryRenderTexture, m_camera, false, m_renderFoliage, m_aboveRefractionRenderTexture);
+		renderSettings->DisablePlaneClipping();
+		gpuProfiler->EndZone();
+		profiler->EndZone();
+
+		profiler->BeginZone("Refraction pass");
+		gpuProfiler->BeginZone("Refraction pass");
+		renderSettings->EnablePlaneClipping(vec4(0.0f, -1.0f, 0.0f, Terrain::WATER_LEVEL));
+		RenderScene(m_refractionAuxiliaryRenderTexture, m_camera, false, m_renderFoliage, m_refractionRenderTexture);
+		renderSettings->DisablePlaneClipping();
+		gpuProfiler->EndZone();
+		profiler->EndZone();
+	}
+
+	m_terrain->UpdateWater(deltaTime);
 }
 
 void World::Draw()
 {
-	RenderScene(m_auxilliaryRenderTexture, m_camera, true, nullptr, m_refractionRenderTexture->GetTexture(), m_reflectionRenderTexture->GetTexture(), m_refractionAuxiliaryRenderTexture->GetDepthTexture(), m_aboveRefractionAuxiliaryRenderTexture->GetDepthTexture());
+	ProfileZone  profileZone("Final pass");
+
+	GpuProfiler* gpuProfiler = GpuProfiler::GetInstance();
+
+	gpuProfiler->BeginZone("Final pass");
+	RenderScene(m_auxilliaryRenderTexture, m_camera, true, m_renderFoliage, nullptr, m_refractionRenderTexture->GetTexture(), m_reflectionRenderTexture->GetTexture(), m_refractionAuxiliaryRenderTexture->GetDepthTexture(), m_aboveRefractionAuxiliaryRenderTexture->GetDepthTexture());
+	gpuProfiler->EndZone();
 	//glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	//DebugHelper::GetInstance()->DrawFullscreenTexture(m_reflectionRenderTexture->GetTexture());
 }
@@ -170,25 +286,97 @@ Camera* World::GetCamera() const
 	return m_camera;
 }
 
+void World::CreateReflectionRenderTextures()
+{
+	FreeReflectionRenderTextures();
+
+	m_reflectionResolutionScale = RenderSettings::GetInstance()->ReflectionResolutionScale();
+
+	int width  = max((int)(m_camera->GetWidth()  * m_reflectionResolutionScale), 1);
+	int height = max((int)(m_camera->GetHeight() * m_reflectionResolutionScale), 1);
+
+	m_reflectionAuxiliaryRenderTexture = new RenderTexture(width, height);
+	m_reflectionRenderTexture          = new RenderTexture(width, height);
+}
+
+void World::FreeReflectionRenderTextures()
+{
+	if (m_reflectionRenderTexture)
+	{
+		delete m_reflectionRenderTexture;
+		m_reflectionRenderTexture = nullptr;
+	}
+
+	if (m_reflectionAuxiliaryRenderTexture)
+	{
+		delete m_reflectionAuxiliaryRenderTexture;
+		m_reflectionAuxiliaryRenderTexture = nullptr;
+	}
+}
+
 // TODO: TOOO MANY ARGUMENTS HERE (also, inconsistency in naming the last argument)
-void World::RenderScene(RenderTexture* auxiliaryRenderTexture, Camera* camera, bool renderClouds, RenderTexture* targetTexture, Texture* refractionTexture, Texture* reflectionTexture, Texture* refractionDepthTexture, Texture* reflectionDepthTexture)
+void World::RenderScene(RenderTexture* auxiliaryRenderTexture, Camera* camera, bool renderClouds, bool renderFoliage, RenderTexture* targetTexture, Texture* refractionTexture, Texture* reflectionTexture, Texture* refractionDepthTexture, Texture* reflectionDepthTexture)
 {
+	Profiler*    profiler    = Profiler::GetInstance();
+	GpuProfiler* gpuProfiler = GpuProfiler::GetInstance();
+
 	auxiliaryRenderTexture->Begin();
 
+	// The scene is drawn in the near part of the depth range, the far terrain goes behind it.
+	glDepthRange(0.0, TerrainClipmap::GetDepthRangeSplit());
+
+	profiler->BeginZone("Skybox");
 	m_skybox->Draw(camera);
+	profiler->EndZone();
 
-	m_terrain->Draw(camera, m_light, m_renderFoliage, refractionTexture, reflectionTexture, refractionDepthTexture, reflectionDepthTexture);
+	m_terrain->Draw(camera, m_light, renderFoliage);
+
+	if (reflectionTexture)
+	{
+		if (RenderSettings::GetInstance()->SceneRefraction())
+		{
+			// The water can't sample the target it's drawn into, so it refracts a copy of the opaque scene.
+			profiler->BeginZone("Scene copy");
+			auxiliaryRenderTexture->CopyTo(m_sceneCopyRenderTexture);
+			auxiliaryRenderTexture->Bind();
+			profiler->EndZone();
+
+			refractionTexture      = m_sceneCopyRenderTexture->GetTexture();
+			refractionDepthTexture = m_sceneCopyRenderTexture->GetDepthTexture();
+			reflectionDepthTexture = m_sceneCopyRenderTexture->GetDepthTexture();
+		}
+
+		if (refractionTexture && refractionDepthTexture && reflectionDepthTexture)
+			m_terrain->DrawWater(camera, m_light, refractionTexture, reflectionTexture, refractionDepthTexture, reflectionDepthTexture);
+	}
 
 	if (m_renderDebug)
 		DebugHelper::GetInstance()->DrawRectangles(camera);
 
+	glDepthRange(0.0, 1.0);
+
+	if (renderClouds)
+	{
+		profiler->BeginZone("Clouds raymarch");
+		gpuProfiler->BeginZone("Clouds raymarch");
+		m_clouds->Render(camera, m_light, auxiliaryRenderTexture->GetDepthTexture());
+		gpuProfiler->EndZone();
+		profiler->EndZone();
+	}
+
 	if (targetTexture)
 		targetTexture->Begin();
 	else
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
 	if (renderClouds)
+	{
+		profiler->BeginZone("Clouds");
+		gpuProfiler->BeginZone("Clouds");
 		m_clouds->Draw(camera, m_light, auxiliaryRenderTexture->GetTexture(), auxiliaryRenderTexture->GetDepthTexture(), false);
+		gpuProfiler->EndZone();
+		profiler->EndZone();
+	}
 	else
 		DebugHelper::GetInstance()->DrawFullscreenTexture(auxiliaryRenderTexture->GetTexture());
 }
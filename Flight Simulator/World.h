@@ -15,6 +15,7 @@
 #include "WorleyNoise.h"
 #include "Clouds.h"
 #include "ReflectionCamera.h"
+#include "Simulation.h"
 
 class World
 {
@@ -25,14 +26,17 @@ public:
 
 	void    UpdateWindowSize(int, int);
 
-	void    Update(float);
+	void    Update();
 	void    Draw();
 
 	Camera* GetCamera() const;
 
 private:
 
-	void RenderScene(RenderTexture*, Camera*, bool, RenderTexture* = nullptr, Texture* = nullptr, Texture* = nullptr, Texture* = nullptr, Texture* = nullptr);
+	void CreateReflectionRenderTextures();
+	void FreeReflectionRenderTextures();
+
+	void RenderScene(RenderTexture*, Camera*, bool, bool, RenderTexture* = nullptr, Texture* = nullptr, Texture* = nullptr, Texture* = nullptr, Texture* = nullptr);
 
 private:
 
@@ -42,14 +46,22 @@ private:
 	Terrain*          m_terrain;
 	Skybox*           m_skybox;
 	Clouds*           m_clouds;
+
+	Simulation*       m_simulation;
+	double            m_simulationTime;
 				      
 	RenderTexture*    m_auxilliaryRenderTexture;
+	RenderTexture*    m_reflectionAuxiliaryRenderTexture;
 	RenderTexture*    m_aboveRefractionAuxiliaryRenderTexture;
 	RenderTexture*    m_refractionAuxiliaryRenderTexture;
 	RenderTexture*    m_reflectionRenderTexture;
 	RenderTexture*    m_refractionRenderTexture;
 	RenderTexture*    m_aboveRefractionRenderTexture;
+	RenderTexture*    m_sceneCopyRenderTexture;
 				      
+	float             m_reflectionResolutionScale;
+	int               m_framesCount;
+
 	bool              m_renderDebug;
 	bool              m_renderFoliage;
 };
\ No newline at end of file
@@ -1,8 +1,16 @@
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
 #include "WorleyNoise.h"
 #include "ShaderManager.h"
 #include "glad/glad.h"
 #include "MathHelper.h"
+#include "StartupProfiler.h"
 
+using namespace std;
 using namespace glm;
 
 WorleyNoise::WorleyNoise()
@@ -89,6 +97,254 @@ Texture3D* WorleyNoise::RenderNoise(NoiseParameters noiseParameters, Texture3D*
 	return noiseTexture;
 }
 
+Texture3D* WorleyNoise::GenerateNoise(const vector<NoiseParameters>& channelsParameters, unsigned int seed, const string& cacheFilename, vec4* maxValues)
+{
+	if (channelsParameters.empty())
+		return nullptr;
+
+	int                textureSize    = channelsParameters[0].TextureSize;
+	unsigned long long parametersHash = GetParametersHash(channelsParameters, seed);
+
+	vector<float>      data;
+
+	// A cold start measures the generation itself, so it never reads the cache.
+	bool               cacheLoaded    = !StartupProfiler::GetInstance()->IsColdStart() &&
+		                                LoadCache(cacheFilename, parametersHash, textureSize, data);
+
+	if (!cacheLoaded)
+	{
+		GenerateNoiseData(channelsParameters, seed, data);
+		SaveCache(cacheFilename, parametersHash, textureSize, data);
+	}
+
+	if (maxValues)
+	{
+		*maxValues = vec4(0.0f, 0.0f, 0.0f, 0.0f);
+
+		for (size_t i = 0; i < data.size(); i++)
+			(*maxValues)[i % 4] = max((*maxValues)[i % 4], data[i]);
+	}
+
+	return new Texture3D(textureSize, textureSize, textureSize,
+		                 Texture::Format::RGBA32F, Texture::Format::RGBA, Texture::Filter::Linear,
+		                 data.data());
+}
+
+void WorleyNoise::GenerateNoiseData(const vector<NoiseParameters>& channelsParameters, unsigned int seed, vector<float>& data)
+{
+	int           textureSize  = channelsParameters[0].TextureSize;
+	int           voxelsCount  = textureSize * textureSize * textureSize;
+	vector<float> channel;
+
+	data.assign(voxelsCount * 4, 0.0f);
+
+	for (int i = 0; i < (int)channelsParameters.size(); i++)
+	{
+		const NoiseParameters& noiseParameters = channelsParameters[i];
+
+		// Every channel gets its own feature points, but they only depend on the seed.
+		GenerateChannel(noiseParameters, seed + i * 7919, channel);
+
+		vec4 mask = noiseParameters.ChannelsMask;
+
+		for (int voxel = 0; voxel < voxelsCount; voxel++)
+		{
+			float* color = &data[voxel * 4];
+
+			for (int component = 0; component < 4; component++)
+				color[component] = color[component] * (1.0f - mask[component]) + channel[voxel] * mask[component];
+		}
+	}
+}
+
+void WorleyNoise::GenerateChannel(const NoiseParameters& noiseParameters, unsigned int seed, vector<float>& channel)
+{
+	mt19937      generator(seed);
+	vector<vec3> pointsA, pointsB, pointsC;
+
+	CreateSeededPointsSet(pointsA, noiseParameters.NumCellsA, generator);
+	CreateSeededPointsSet(pointsB, noiseParameters.NumCellsB, generator);
+	CreateSeededPointsSet(pointsC, noiseParameters.NumCellsC, generator);
+
+	int   textureSize = noiseParameters.TextureSize;
+	float persistance = noiseParameters.Persistance;
+	float weightsSum  = 1.0f + persistance + persistance * persistance;
+
+	channel.resize(textureSize * textureSize * textureSize);
+
+	atomic<int>    nextSlice(0);
+	int            threadsCount = max((int)thread::hardware_concurrency(), 1);
+	vector<thread> threads;
+
+	// The slices are handed out one by one, so the threads stay busy until the end.
+	auto generateSlices = [&]()
+	{
+		for (int z = nextSlice++; z < textureSize; z = nextSlice++)
+		{
+			for (int y = 0; y < textureSize; y++)
+			{
+				for (int x = 0; x < textureSize; x++)
+				{
+					// Dividing by the size (not size - 1) makes the last voxel continue into the first one.
+					vec3  position = vec3(x, y, z) / (float)textureSize * (float)noiseParameters.Tiles;
+					      position = position - floor(position);
+
+					float layerA   = Worley(pointsA, noiseParameters.NumCellsA, position);
+					float layerB   = Worley(pointsB, noiseParameters.NumCellsB, position);
+					float layerC   = Worley(pointsC, noiseParameters.NumCellsC, position);
+
+					float sum      = (layerA + layerB * persistance + layerC * persistance * persistance) / weightsSum;
+
+					channel[(z * textureSize + y) * textureSize + x] = 1.0f - sum;
+				}
+			}
+		}
+	};
+
+	for (int i = 0; i < threadsCount; i++)
+		threads.push_back(thread(generateSlices));
+
+	for (auto& currentThread : threads)
+		currentThread.join();
+}
+
+void WorleyNoise::CreateSeededPointsSet(vector<vec3>& points, int width, mt19937& generator)
+{
+	uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+	float slice = 1.0f / (float)width;
+
+	points.resize(width * width * width);
+
+	for (int z = 0; z < width; z++)
+		for (int y = 0; y < width; y++)
+			for (int x = 0; x < width; x++)
+				points[z * width * width + y * width + x] = vec3((x + distribution(generator)) * slice,
+					                                             (y + distribution(generator)) * slice,
+					                                             (z + distribution(generator)) * slice);
+}
+
+// Distance to the closest feature point, only the 27 cells around the position can hold it.
+// The cells outside the volume wrap around, with their points moved next to the position.
+float WorleyNoise::Worley(const vector<vec3>& points, int numCells, const vec3& position)
+{
+	int   cellX      = min((int)(position.x * numCells), numCells - 1);
+	int   cellY      = min((int)(position.y * numCells), numCells - 1);
+	int   cellZ      = min((int)(position.z * numCells), numCells - 1);
+
+	float minSqrDist = 1.0f;
+
+	for (int offsetZ = -1; offsetZ <= 1; offsetZ++)
+	{
+		for (int offsetY = -1; offsetY <= 1; offsetY++)
+		{
+			for (int offsetX = -1; offsetX <= 1; offsetX++)
+			{
+				int  x          = cellX + offsetX;
+				int  y          = cellY + offsetY;
+				int  z          = cellZ + offsetZ;
+
+				int  wrappedX   = (x + numCells) % numCells;
+				int  wrappedY   = (y + numCells) % numCells;
+				int  wrappedZ   = (z + numCells) % numCells;
+
+				vec3 wrapOffset = vec3((float)((x - wrappedX) / numCells),
+					                   (float)((y - wrappedY) / numCells),
+					                   (float)((z - wrappedZ) / numCells));
+
+				vec3 direction  = position - (points[(wrappedZ * numCells + wrappedY) * numCells + wrappedX] + wrapOffset);
+
+				minSqrDist = min(minSqrDist, dot(direction, direction));
+			}
+		}
+	}
+
+	return sqrt(minSqrDist);
+}
+
+unsigned long long WorleyNoise::GetParametersHash(const vector<NoiseParameters>& channelsParameters, unsigned int seed)
+{
+	// FNV-1a over everything that changes the generated values.
+	unsigned long long hash = 14695981039346656037ULL;
+
+	auto hashBytes = [&hash](const void* data, size_t size)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+	};
+
+	unsigned int version = CACHE_VERSION;
+
+	hashBytes(&version, sizeof(version));
+	hashBytes(&seed,    sizeof(seed));
+
+	for (auto& noiseParameters : channelsParameters)
+	{
+		hashBytes(&noiseParameters.TextureSize,  sizeof(noiseParameters.TextureSize));
+		hashBytes(&noiseParameters.Tiles,        sizeof(noiseParameters.Tiles));
+		hashBytes(&noiseParameters.Persistance,  sizeof(noiseParameters.Persistance));
+		hashBytes(&noiseParameters.NumCellsA,    sizeof(noiseParameters.NumCellsA));
+		hashBytes(&noiseParameters.NumCellsB,    sizeof(noiseParameters.NumCellsB));
+		hashBytes(&noiseParameters.NumCellsC,    sizeof(noiseParameters.NumCellsC));
+
+		for (int component = 0; component < 4; component++)
+		{
+			float mask = noiseParameters.ChannelsMask[component];
+			hashBytes(&mask, sizeof(mask));
+		}
+	}
+
+	return hash;
+}
+
+bool WorleyNoise::LoadCache(const string& cacheFilename, unsigned long long parametersHash, int textureSize, vector<float>& data)
+{
+	ifstream cacheFile(cacheFilename, ios::binary);
+
+	if (!cacheFile.is_open())
+		return false;
+
+	CacheHeader header;
+	cacheFile.read((char*)&header, sizeof(header));
+
+	if (!cacheFile ||
+		header.Magic          != CACHE_MAGIC   ||
+		header.Version        != CACHE_VERSION ||
+		header.ParametersHash != parametersHash ||
+		header.TextureSize    != textureSize)
+		return false;
+
+	data.resize((size_t)textureSize * textureSize * textureSize * 4);
+	cacheFile.read((char*)data.data(), data.size() * sizeof(float));
+
+	return (bool)cacheFile;
+}
+
+void WorleyNoise::SaveCache(const string& cacheFilename, unsigned long long parametersHash, int textureSize, const vector<float>& data)
+{
+	ofstream cacheFile(cacheFilename, ios::binary | ios::trunc);
+
+	if (!cacheFile.is_open())
+	{
+		cout << "ERROR::WORLEY_NOISE::COULD_NOT_WRITE_CACHE " << cacheFilename << endl;
+		return;
+	}
+
+	CacheHeader header;
+	header.Magic          = CACHE_MAGIC;
+	header.Version        = CACHE_VERSION;
+	header.ParametersHash = parametersHash;
+	header.TextureSize    = textureSize;
+
+	cacheFile.write((const char*)&header,     sizeof(header));
+	cacheFile.write((const char*)data.data(), data.size() * sizeof(float));
+}
+
 void WorleyNoise::CreatePointsPositions(vec4* points, const NoiseParameters& noiseParameters)
 {
 	int totalAPoints = noiseParameters.NumCellsA * noiseParameters.NumCellsA * noiseParameters.NumCellsA;
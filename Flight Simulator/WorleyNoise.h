@@ -1,5 +1,8 @@
 #pragma once
 
+#include <random>
+#include <string>
+#include <vector>
 #include <glm/glm.hpp>
 #include "Texture3D.h"
 
@@ -9,6 +12,19 @@ private:
 
 	const int COMPUTE_SHADER_BLOCKS_COUNT = 8;
 
+	static const unsigned int CACHE_MAGIC   = 0x434E5257; // "WRNC"
+	static const unsigned int CACHE_VERSION = 1;
+
+	struct CacheHeader
+	{
+	public:
+
+		unsigned int       Magic;
+		unsigned int       Version;
+		unsigned long long ParametersHash;
+		int                TextureSize;
+	};
+
 public:
 
 	struct NoiseParameters
@@ -31,8 +47,23 @@ public:
 
 	Texture3D* RenderNoise(NoiseParameters, Texture3D* = nullptr);
 
+	// Generates the channels of a volume on the CPU, on all the cores, from seeded feature points.
+	// The result is saved to the cache file and loaded from it the next time the same parameters
+	// are requested (except for cold starts). All the channels must have the same TextureSize.
+	// The largest value of every component is written to the optional output.
+	Texture3D* GenerateNoise(const std::vector<NoiseParameters>&, unsigned int, const std::string&, glm::vec4* = nullptr);
+
 private:
 
+	void               GenerateNoiseData(const std::vector<NoiseParameters>&, unsigned int, std::vector<float>&);
+	void               GenerateChannel(const NoiseParameters&, unsigned int, std::vector<float>&);
+	void               CreateSeededPointsSet(std::vector<glm::vec3>&, int, std::mt19937&);
+	float              Worley(const std::vector<glm::vec3>&, int, const glm::vec3&);
+
+	unsigned long long GetParametersHash(const std::vector<NoiseParameters>&, unsigned int);
+	bool               LoadCache(const std::string&, unsigned long long, int, std::vector<float>&);
+	void               SaveCache(const std::string&, unsigned long long, int, const std::vector<float>&);
+
 	void         CreatePointsPositions(glm::vec4*, const NoiseParameters&);
 	void         CreatePointsPositionsSet(glm::vec4*, int);
 	
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <fstream>
 #include <streambuf>
+#include <random>
 
 #include "World.h"
 #include "Skybox.h"
@@ -15,12 +16,20 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/constants.hpp>
 #include "DebugHelper.h"
 #include "InputWrapper.h"
 #include "TextureLoadHelper.h"
 #include "ShaderManager.h"
 #include "RenderSettings.h"
 #include "BenchmarkHelper.h"
+#include "StartupProfiler.h"
+#include "Profiler.h"
+#include "GpuProfiler.h"
+#include "TerrainQuery.h"
+#include "WorkerPool.h"
+#include "FrameArena.h"
+#include "StreamingBuffer.h"
 
 using namespace std;
 using namespace glm;
@@ -48,8 +57,110 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     InputWrapper::GetInstance()->KeyCallback(window, key, scancode, action, mods);
 }
 
+// Casts the same set of rays around the camera as a batch and one by one, the time per ray ends up
+// in the benchmark report as "CPU::RayCast::Packets" and "CPU::RayCast::Single", in nanoseconds.
+void run_ray_benchmark(int raysCount)
+{
+    TerrainQuery*                    terrainQuery    = TerrainQuery::GetInstance();
+    BenchmarkHelper*                 benchmarkHelper = BenchmarkHelper::GetInstance();
+
+    vec3                             cameraPosition  = g_world->GetCamera()->GetPosition();
+
+    // The same seed every frame, so the rays only change with the camera.
+    mt19937                          generator(0);
+    uniform_real_distribution<float> azimuthDistribution(0.0f, 2.0f * pi<float>());
+    uniform_real_distribution<float> elevationDistribution(-half_pi<float>() * 0.9f, -0.05f);
+
+    vector<TerrainQuery::Ray>        rays(raysCount);
+    vector<TerrainQuery::RayHit>     rayHits;
+
+    for (auto& ray : rays)
+    {
+        float azimuth   = azimuthDistribution(generator);
+        float elevation = elevationDistribution(generator);
+
+        ray.Origin      = cameraPosition;
+        ray.Direction   = vec3(cos(elevation) * cos(azimuth), sin(elevation), cos(elevation) * sin(azimuth));
+        ray.MaxDistance = 2000.0f;
+    }
+
+    auto packetsBeginTime = benchmarkHelper->Now();
+    terrainQuery->CastRays(rays, rayHits);
+    auto packetsEndTime   = benchmarkHelper->Now();
+
+    auto singleBeginTime  = benchmarkHelper->Now();
+    for (auto& ray : rays)
+        rayHits[0] = terrainQuery->CastRay(ray);
+    auto singleEndTime    = benchmarkHelper->Now();
+
+    benchmarkHelper->AddTimeSample("CPU::RayCast::Packets", chrono::duration_cast<chrono::nanoseconds>(packetsEndTime - packetsBeginTime).count() / raysCount);
+    benchmarkHelper->AddTimeSample("CPU::RayCast::Single",  chrono::duration_cast<chrono::nanoseconds>(singleEndTime  - singleBeginTime).count()  / raysCount);
+}
+
+// Records the zones back to back, nested like the frame zones are. The cost of a zone (the
+// BeginZone / EndZone pair) ends up in the benchmark report as "CPU::Profiler::Zone", in
+// nanoseconds; it should stay well under 50 ns.
+void run_profiler_benchmark(int zonesCount)
+{
+    Profiler*        profiler        = Profiler::GetInstance();
+    BenchmarkHelper* benchmarkHelper = BenchmarkHelper::GetInstance();
+
+    // The zones go by pairs, an odd count records one more.
+    int  pairsCount = (zonesCount + 1) / 2;
+
+    auto beginTime  = benchmarkHelper->Now();
+
+    for (int i = 0; i < pairsCount; i++)
+    {
+        profiler->BeginZone("ProfilerBenchmark::Outer");
+        profiler->BeginZone("ProfilerBenchmark::Inner");
+        profiler->EndZone();
+        profiler->EndZone();
+    }
+
+    auto endTime = benchmarkHelper->Now();
+
+    benchmarkHelper->AddTimeSample("CPU::Profiler::Zone", chrono::duration_cast<chrono::nanoseconds>(endTime - beginTime).count() / (2 * pairsCount));
+}
+
 int main(int argc, char const* argv[])
 {
+    StartupProfiler* startupProfiler     = StartupProfiler::GetInstance();
+    Profiler*        profiler            = Profiler::GetInstance();
+    bool             exitAfterFirstFrame = false;
+    string           benchmarkReport     = "";
+    int              rayBenchmarkCount   = 0;
+    int              zoneBenchmarkCount  = 0;
+
+    // --startup-report=cold|warm   writes the startup phases breakdown after the first frame.
+    // --exit-after-first-frame     closes the application as soon as the first frame is presented.
+    // --benchmark-report=<file>    writes the frame and stage times percentiles on exit (.csv or .json).
+    // --ray-benchmark=<rays>       casts the rays against the terrain every frame, batched and one by one.
+    // --profiler-benchmark=<zones> records the profiler zones every frame and reports their cost.
+    for (int i = 1; i < argc; i++)
+    {
+        string argument = argv[i];
+
+        if (argument == "--startup-report=cold")
+            startupProfiler->SetMode(StartupProfiler::Mode::Cold);
+        else if (argument == "--startup-report=warm")
+            startupProfiler->SetMode(StartupProfiler::Mode::Warm);
+        else if (argument == "--exit-after-first-frame")
+            exitAfterFirstFrame = true;
+        else if (argument.find("--benchmark-report=") == 0)
+            benchmarkReport = argument.substr(string("--benchmark-report=").size());
+        else if (argument.find("--ray-benchmark=") == 0)
+            rayBenchmarkCount = atoi(argument.substr(string("--ray-benchmark=").size()).c_str());
+        else if (argument.find("--profiler-benchmark=") == 0)
+            zoneBenchmarkCount = atoi(argument.substr(string("--profiler-benchmark=").size()).c_str());
+        else
+            cout << "Unknown argument: " << argument << endl;
+    }
+
+    profiler->SetThreadName("Main thread");
+
+    startupProfiler->BeginPhase("Window creation");
+
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -66,12 +177,17 @@ int main(int argc, char const* argv[])
 
     glfwMakeContextCurrent(window);
 
+    startupProfiler->EndPhase();
+    startupProfiler->BeginPhase("GLAD initialization");
+
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
     {
         cout << "Failed to initialize GLAD" << endl;
         return -1;
     }
 
+    startupProfiler->EndPhase();
+
     glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
@@ -96,30 +212,64 @@ int main(int argc, char const* argv[])
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetKeyCallback(window, key_callback);
 
-    float previousTime = (float)glfwGetTime();
-
     glEnable(GL_CULL_FACE);
     glCullFace(GL_BACK);
 
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     
+    startupProfiler->BeginPhase("Shaders compilation");
+    ShaderManager::GetInstance();
+    startupProfiler->EndPhase();
+
+    // Created before the worker threads can query it, GetInstance isn't synchronized.
+    TerrainQuery::GetInstance();
+
+    startupProfiler->BeginPhase("World creation");
     g_world = new World(WINDOW_WIDTH, WINDOW_HEIGHT);
+    startupProfiler->EndPhase();
+
+    bool firstFrame = true;
 
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
     while (!glfwWindowShouldClose(window))
     {
-        BenchmarkHelper::GetInstance()->Update();
+        if (firstFrame)
+            startupProfiler->BeginPhase("First frame");
+
+        profiler->BeginZone("Frame");
+        GpuProfiler::GetInstance()->BeginFrame();
 
-        float currentTime = (float)glfwGetTime();
-        float deltaTime = currentTime - previousTime;
+        // Nothing from the previous frame is still in use, its workers finished with the views.
+        FrameArena::GetInstance()->Reset();
+
+        // Waits for the GPU to be done with the region this frame writes its instance data in.
+        StreamingBuffer::GetInstance()->BeginFrame();
+
+        BenchmarkHelper::GetInstance()->Update();
 
         InputWrapper::GetInstance()->Update();
         if (InputWrapper::GetInstance()->GetKey(InputWrapper::Keys::Exit))
             glfwSetWindowShouldClose(window, true);
 
-        g_world->Update(deltaTime);
+        if (InputWrapper::GetInstance()->GetKeyUp(InputWrapper::Keys::Profile))
+            profiler->ExportChromeTrace("ProfilerTrace.json");
+
+        BenchmarkHelper* benchmarkHelper = BenchmarkHelper::GetInstance();
+        auto             updateBeginTime = benchmarkHelper->Now();
+
+        startupProfiler->BeginPhase("World update");
+        g_world->Update();
+        startupProfiler->EndPhase();
+
+        benchmarkHelper->AddTimeSample("CPU::Update", updateBeginTime, benchmarkHelper->Now());
+
+        if (rayBenchmarkCount > 0)
+            run_ray_benchmark(rayBenchmarkCount);
+
+        if (zoneBenchmarkCount > 0)
+            run_profiler_benchmark(zoneBenchmarkCount);
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
         glViewport(0, 0, (int)g_world->GetCamera()->GetWidth(), (int)g_world->GetCamera()->GetHeight());
@@ -127,27 +277,63 @@ int main(int argc, char const* argv[])
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        auto drawBeginTime = benchmarkHelper->Now();
+
+        startupProfiler->BeginPhase("World draw");
         g_world->Draw();
+        startupProfiler->EndPhase();
+
+        benchmarkHelper->AddTimeSample("CPU::Draw", drawBeginTime, benchmarkHelper->Now());
 
+        StreamingBuffer::GetInstance()->EndFrame();
+
+        startupProfiler->BeginPhase("Present");
+        profiler->BeginZone("Present");
         glfwSwapBuffers(window);
+        profiler->EndZone();
+        startupProfiler->EndPhase();
+
         glfwPollEvents();
 
-        previousTime = currentTime;
+        profiler->EndZone();
+
+        if (firstFrame)
+        {
+            startupProfiler->Finish();
+
+            if (exitAfterFirstFrame)
+                glfwSetWindowShouldClose(window, true);
+
+            firstFrame = false;
+        }
+
     }
 
-    RenderSettings::FreeInstance();
-    TextureLoadHelper::FreeInstance();
-    InputWrapper::FreeInstance();
-    DebugHelper::FreeInstance();
-    ShaderManager::FreeInstance();
-    BenchmarkHelper::FreeInstance();
+    if (!benchmarkReport.empty())
+        BenchmarkHelper::GetInstance()->ExportReport(benchmarkReport);
 
+    // The world goes first, its simulation thread and the workers still record profiler zones.
     if (g_world)
     {
         delete g_world;
         g_world = nullptr;
     }
 
+    WorkerPool::FreeInstance();
+    TerrainQuery::FreeInstance();
+    FrameArena::FreeInstance();
+    StreamingBuffer::FreeInstance();
+
+    RenderSettings::FreeInstance();
+    TextureLoadHelper::FreeInstance();
+    InputWrapper::FreeInstance();
+    DebugHelper::FreeInstance();
+    ShaderManager::FreeInstance();
+    BenchmarkHelper::FreeInstance();
+    StartupProfiler::FreeInstance();
+    GpuProfiler::FreeInstance();
+    Profiler::FreeInstance();
+
     glfwTerminate();
 
     return 0;